@@ -0,0 +1,51 @@
+// Screen space ambient occlusion, computed at half the render resolution by ambient_occlusion.comp and blurred by ao_blur.comp.
+// The result holds occlusion in r, 1 for open and 0 for fully occluded, and the view depth it was computed at in g.
+layout(binding = 10) uniform PerDispatch_AmbientOcclusion
+{
+    mat4 um4ViewToPreviousClip;
+    float ufAORadius;
+    float ufAOHistoryWeight;
+    int uiAOSampleCount;
+    int uiAOFrameIndex;
+    int uiAOBlurAxis;
+    bool ubAmbientOcclusionOn;
+};
+
+layout(binding = 13) uniform sampler2D u_AmbientOcclusiontex;
+
+const float c_fAODepthSharpness = 10.0f;    // Per unit of relative view distance.
+
+// View distance of a surface from its view space position, which is what the half resolution depth holds.
+float GetViewDistance(vec3 f3Position)
+{
+    return -f3Position.z;
+}
+
+// Occlusion for a full resolution pixel at view space f3Position. A joint bilateral upsample: of the four nearest half resolution
+// texels, those at a depth close to this pixel's count, so occlusion doesn't bleed across silhouettes.
+float SampleAmbientOcclusion(vec2 f2TexCoord, vec3 f3Position)
+{
+    if (!ubAmbientOcclusionOn)
+        return 1.0f;
+
+    ivec2 i2Size = textureSize(u_AmbientOcclusiontex, 0);
+    vec2 f2Position = (f2TexCoord * vec2(i2Size)) - 0.5f;
+    ivec2 i2Base = ivec2(floor(f2Position));
+    vec2 f2Fraction = f2Position - vec2(i2Base);
+    float fViewDistance = GetViewDistance(f3Position);
+
+    float fOcclusion = 0.0f, fTotalWeight = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 i2Offset = ivec2(i & 1, i >> 1);
+        vec2 f2Sample = texelFetch(u_AmbientOcclusiontex, clamp(i2Base + i2Offset, ivec2(0), GetRenderAreaSize(i2Size) - 1), 0).rg;
+
+        vec2 f2Bilinear = mix(1.0f - f2Fraction, f2Fraction, vec2(i2Offset));
+        float fWeight = (f2Bilinear.x * f2Bilinear.y) + 1e-3f;
+        fWeight /= 1.0f + (c_fAODepthSharpness * abs(f2Sample.g - fViewDistance) / fViewDistance);
+        fOcclusion += f2Sample.r * fWeight;
+        fTotalWeight += fWeight;
+    }
+
+    return fOcclusion / fTotalWeight;
+}
@@ -0,0 +1,9 @@
+// Bloom. bloom_downsample.comp keeps what's brighter than the threshold in level 0 of the colour pyramid and filters that into a
+// chain of ever smaller targets, and bloom_upsample.comp adds the chain back up, each level blurred a little on the way.
+layout(binding = 12) uniform PerDispatch_Bloom
+{
+    float ufBloomThreshold;
+    float ufBloomKnee;
+    float ufBloomScale;
+    bool ubBloomPrefilter;
+};
@@ -0,0 +1,40 @@
+// Lights assigned to view space clusters by LightClusterGrid on the CPU. Depends on ShaderCommon.glsl for the projection; the
+// lookup only needs a view space position, so it serves forward shaded surfaces as well as the G-buffer.
+
+// Grid dimensions, and slice = log(-z) * scale + bias; slices are spaced exponentially from near to far.
+layout(binding = 5) uniform PerFrame_Cluster
+{
+    int uiClusterCountX;
+    int uiClusterCountY;
+    int uiClusterCountZ;
+    float ufClusterSliceScale;
+    float ufClusterSliceBias;
+};
+
+// Offset into auClusterLightIndices and light count, per cluster. Mirrors LightClusterGrid::ClusterRange.
+layout(std430, binding = 4) readonly buffer ClusterLightRanges
+{
+    uvec2 au2ClusterLightRanges[];
+};
+
+// Indices into aLights (LightingCommon.glsl), every cluster's run packed back to back.
+layout(std430, binding = 5) readonly buffer ClusterLightIndices
+{
+    uint auClusterLightIndices[];
+};
+
+// Same layout as LightClusterGrid: x fastest, then y, then slice.
+int GetClusterIndex(vec3 f3ViewPosition)
+{
+    vec2 f2Ndc = vec2(um4Persp[0][0], um4Persp[1][1]) * f3ViewPosition.xy / -f3ViewPosition.z;
+    ivec2 i2Tile = ivec2(((f2Ndc * 0.5f) + 0.5f) * vec2(uiClusterCountX, uiClusterCountY));
+    int iSlice = int(floor((log(-f3ViewPosition.z) * ufClusterSliceScale) + ufClusterSliceBias));
+
+    ivec3 i3Cluster = clamp(ivec3(i2Tile, iSlice), ivec3(0), ivec3(uiClusterCountX, uiClusterCountY, uiClusterCountZ) - 1);
+    return (((i3Cluster.z * uiClusterCountY) + i3Cluster.y) * uiClusterCountX) + i3Cluster.x;
+}
+
+uvec2 GetClusterLightRange(vec3 f3ViewPosition)
+{
+    return au2ClusterLightRanges[GetClusterIndex(f3ViewPosition)];
+}
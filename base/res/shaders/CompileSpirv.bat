@@ -0,0 +1,25 @@
+@echo off
+rem Compiles every program stage in this directory to SPIR-V for GL_ARB_gl_spirv. GLProgram picks the modules up from .\spirv
+rem and falls back to the GLSL next to them when a module is missing or older than its source. Needs glslangValidator, either
+rem on the PATH or from the Vulkan SDK. Run it again after editing a shader; until then that program builds from GLSL.
+rem The visibility buffer shaders are left out: they use bindless textures, which only the GLSL path supports.
+setlocal
+
+set GLSLANG=glslangValidator
+if defined VULKAN_SDK set GLSLANG="%VULKAN_SDK%\Bin\glslangValidator.exe"
+
+pushd "%~dp0"
+if not exist spirv mkdir spirv
+
+set FAILED=0
+for %%S in (pass.vert pass.frag shadow.vert point_shadow.vert shade.vert diagnostic.frag ambient.frag point.vert point.frag light_volume.vert light_volume.frag stencil.frag depth_copy.frag single_pass_lighting.frag clustered_lighting.frag tiled_lighting.comp ao_downsample.comp ambient_occlusion.comp ao_blur.comp depth_pyramid.comp colour_pyramid.comp dof_prepare.comp dof_blur.comp bloom_downsample.comp bloom_upsample.comp post.comp lighting_downsample.frag lighting_upsample.frag) do (
+    %GLSLANG% -G -o spirv\%%S.spv %%S
+    if errorlevel 1 set FAILED=1
+)
+
+popd
+if %FAILED%==1 (
+    echo One or more shaders failed to compile to SPIR-V.
+    exit /b 1
+)
+endlocal
@@ -0,0 +1,29 @@
+// Depth of field at half the render resolution. dof_prepare.comp splits the scene into a near field, in front of the focal plane,
+// and a far field behind it, dof_blur.comp spreads each by its circle of confusion, and post.comp blends them over the sharp image.
+// Fields hold colour in rgb and circle of confusion in a, 0 for in focus and 1 for DOF_MAX_RADIUS texels.
+// The focal distance is the view distance under the focus point, read back to the CPU a frame or two late and eased towards.
+layout(binding = 11) uniform PerDispatch_DepthOfField
+{
+    int uiDOFBlurAxis;
+    float ufDOFFocalDistance;
+};
+
+layout(binding = 8) uniform sampler2D u_DOFNeartex;
+layout(binding = 9) uniform sampler2D u_DOFFartex;
+
+#define DOF_MAX_RADIUS 8    // Half resolution texels. Every pixel pays for this many taps either side, whatever its blur.
+
+const float c_fDOFStrength = 4.0f;  // Circle of confusion per unit of relative distance from the focal plane.
+
+// Signed circle of confusion, negative in front of the focal plane. Relative to the view distance, like a thin lens', so it grows
+// quickly towards the eye and levels off into the distance.
+float ComputeCircleOfConfusion(float fViewDistance, float fFocalDistance)
+{
+    return clamp(c_fDOFStrength * (fViewDistance - fFocalDistance) / max(fViewDistance, 1e-4f), -1.0f, 1.0f);
+}
+
+// Bilinear fetch of a field for a full resolution pixel, kept inside the rendered area.
+vec4 SampleDepthOfFieldField(sampler2D fieldTex, vec2 f2TexCoord)
+{
+    return texture(fieldTex, ClampToRenderArea(f2TexCoord, textureSize(fieldTex, 0)));
+}
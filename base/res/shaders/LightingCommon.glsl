@@ -1,8 +1,23 @@
-layout(binding = 1) uniform PerDraw_Light
+// Point lights that survived CPU culling this frame, in view space. Mirrors LightStore::ViewSpaceLight.
+struct PointLight
 {
-    vec4 uf4Light;
-    vec3 uf3LightCol;
-    float ufLightIl;
+    vec4 f4PositionRadius;
+    vec4 f4ColourIntensity;
+    uint uLight;
+    int iShadow;        // Into aPointShadows, or -1 for an unshadowed light.
+    uint uPadding0;
+    uint uPadding1;
+};
+
+layout(std430, binding = 3) readonly buffer LightList
+{
+    PointLight aLights[];
+};
+
+// How many of aLights to loop over, for passes that walk the whole list. Instanced draws have their own count.
+layout(binding = 4) uniform PerDispatch_Light
+{
+    int uiPointLightCount;
 };
 
 layout(binding = 2) uniform PerFrame_Light
@@ -10,4 +25,32 @@ layout(binding = 2) uniform PerFrame_Light
     vec4 uf4DirecLightDir;
     vec3 uf3DirecLightCol;
     vec3 uf3AmbientContrib;
-};
\ No newline at end of file
+};
+
+// Diffuse irradiance from one point light with linear falloff to zero at its radius. Everything in view space.
+vec3 ComputePointLightIrradiance(vec4 f4PositionRadius, vec4 f4ColourIntensity, vec3 f3Position, vec3 f3Normal)
+{
+    float fDistToLight = length(f4PositionRadius.xyz - f3Position);
+    float fDecay = max(1.0f - (fDistToLight / f4PositionRadius.w), 0.0f);
+    float fClampedDotPdt = clamp(dot(normalize(f3Normal), (f4PositionRadius.xyz - f3Position) / fDistToLight), 0.0f, 1.0f);
+
+    if (TOON)
+        fClampedDotPdt = floor(fClampedDotPdt * 5.0f) * 0.2f;   // Quantize to 0.2 steps.
+    return (f4ColourIntensity.rgb * f4ColourIntensity.a * fClampedDotPdt) * fDecay;
+}
+
+// Directional light and ambient on a surface of colour f3Colour. fShadow scales the directional term only; 1 is fully lit.
+// fOcclusion scales the ambient floor only; 1 is open. Toon shading also outlines silhouettes in black.
+vec3 ComputeDirectionalAndAmbientLighting(vec3 f3Colour, vec3 f3Position, vec3 f3Normal, float fShadow, float fOcclusion)
+{
+    float fDiffuse = max(0.0, dot(uf4DirecLightDir.xyz, f3Normal)) * fShadow;
+    if (TOON)
+    {
+        // Quantize to 0.2 steps and outline silhouettes.
+        fDiffuse = floor(min(fDiffuse, 1.0) * 5.0) * 0.2;
+        float dp = dot(normalize(f3Normal), normalize(-f3Position));
+        return f3Colour * clamp(vec3(uf4DirecLightDir.w * fDiffuse), uf3AmbientContrib * fOcclusion, vec3(1.0f)) * step(0.1, dp);
+    }
+
+    return f3Colour * clamp(vec3(uf4DirecLightDir.w * fDiffuse), uf3AmbientContrib * fOcclusion, vec3(1.0f));
+}
@@ -0,0 +1,19 @@
+// Mip chains built by depth_pyramid.comp after the G-buffer and colour_pyramid.comp after lighting, for effects to sample
+// instead of gathering wide neighbourhoods. Level 0 is half the render resolution, and each level after it halves again.
+layout(binding = 2) uniform sampler2D u_DepthPyramidtex;     // Nearest (r) and furthest (g) linear view distance.
+layout(binding = 15) uniform sampler2D u_ColourPyramidtex;
+
+// The lit scene averaged over about 2^(fLevel + 1) full resolution pixels a side, blending between levels for a fractional one.
+vec3 SampleColourPyramid(vec2 f2TexCoord, float fLevel)
+{
+    vec2 f2Clamped = ClampToRenderArea(f2TexCoord, textureSize(u_ColourPyramidtex, int(ceil(fLevel))));    // The smaller level's area.
+    return textureLod(u_ColourPyramidtex, f2Clamped, fLevel).rgb;
+}
+
+// Nearest and furthest view distance under a texel of iLevel. Not filtered: blended bounds would no longer bound anything.
+vec2 SampleDepthPyramid(vec2 f2TexCoord, int iLevel)
+{
+    ivec2 i2Size = textureSize(u_DepthPyramidtex, iLevel);
+    ivec2 i2Texel = min(ivec2(f2TexCoord * vec2(i2Size)), GetRenderAreaSize(i2Size) - 1);
+    return texelFetch(u_DepthPyramidtex, i2Texel, iLevel).rg;
+}
@@ -0,0 +1,69 @@
+// Point light shadows. Each shadowed light has a cube's worth of tiles in one depth atlas, packed by ShadowAtlas on the CPU.
+// A face's matrix takes a view space position straight to atlas coordinates and depth, all in [0, 1].
+struct PointLightShadow
+{
+    mat4 am4ViewToFace[6];
+    vec4 af4FaceBounds[6];      // The face's tile in atlas coordinates: min xy, max zw.
+};
+
+layout(std430, binding = 7) readonly buffer PointShadowList
+{
+    PointLightShadow aPointShadows[];
+};
+
+// Compared in hardware with linear filtering, so every tap is already a 2x2 PCF.
+layout(binding = 12) uniform sampler2DShadow u_PointShadowAtlastex;
+
+// How lit a view space surface is by one point light, from 0 (shadowed) to 1. iShadow comes from the light's PointLight.
+float SamplePointLightShadow(int iShadow, vec3 f3Position, vec3 f3Normal)
+{
+    if (iShadow < 0)
+        return 1.0f;
+
+    // The face a position falls on is the one it's furthest along, and that distance is each face's clip w.
+    int iFace = 0;
+    float fMaxW = -1.0f;
+    for (int i = 0; i < 6; ++i)
+    {
+        mat4 m4ViewToFace = aPointShadows[iShadow].am4ViewToFace[i];
+        float fW = dot(vec4(m4ViewToFace[0][3], m4ViewToFace[1][3], m4ViewToFace[2][3], m4ViewToFace[3][3]), vec4(f3Position, 1.0f));
+        if (fW > fMaxW)
+        {
+            fMaxW = fW;
+            iFace = i;
+        }
+    }
+
+    // A texel of a 90 degree face is 2w / size across. Push the lookup out along the normal by a texel or so, against acne.
+    vec4 f4Bounds = aPointShadows[iShadow].af4FaceBounds[iFace];
+    vec2 f2TexelSize = 1.0f / vec2(textureSize(u_PointShadowAtlastex, 0));
+    float fTexelWorldSize = (2.0f * fMaxW * f2TexelSize.x) / (f4Bounds.z - f4Bounds.x);
+    vec3 f3OffsetPosition = f3Position + (normalize(f3Normal) * (1.5f * fTexelWorldSize));
+    vec4 f4Shadow = aPointShadows[iShadow].am4ViewToFace[iFace] * vec4(f3OffsetPosition, 1.0f);
+    vec3 f3Shadow = f4Shadow.xyz / f4Shadow.w;
+
+    // Taps are kept a texel inside the tile; the filter would otherwise blend in whatever the neighbouring tile holds.
+    vec2 f2Min = f4Bounds.xy + f2TexelSize;
+    vec2 f2Max = f4Bounds.zw - f2TexelSize;
+    float fLit = 0.0f;
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            vec2 f2Offset = (vec2(x, y) - 0.5f) * f2TexelSize;
+            fLit += texture(u_PointShadowAtlastex, vec3(clamp(f3Shadow.xy + f2Offset, f2Min, f2Max), f3Shadow.z));
+        }
+    }
+
+    return fLit * 0.25f;
+}
+
+// ComputePointLightIrradiance with the light's shadow applied. Where the light doesn't reach, the shadow isn't looked up.
+vec3 ComputeShadowedPointLightIrradiance(vec4 f4PositionRadius, vec4 f4ColourIntensity, int iShadow, vec3 f3Position, vec3 f3Normal)
+{
+    vec3 f3Irradiance = ComputePointLightIrradiance(f4PositionRadius, f4ColourIntensity, f3Position, f3Normal);
+    if ((iShadow < 0) || all(equal(f3Irradiance, vec3(0.0f))))
+        return f3Irradiance;
+
+    return f3Irradiance * SamplePointLightShadow(iShadow, f3Position, f3Normal);
+}
@@ -1,4 +1,31 @@
-#version 430
+// Every program stage starts with #version and then includes this file. The #extension in that preamble is only seen by the
+// offline SPIR-V compiler, which needs it for #include; the driver's GLSL compiler gets sources with includes already resolved.
+
+// Feature keywords. From GLSL, GLProgram #defines the enabled ones to true and the rest default to false below; from SPIR-V they
+// are specialization constants set when the program is created. Either way shaders test them with a plain if (), which folds away.
+#ifdef GL_SPIRV
+layout(constant_id = 0) const bool TOON = false;
+layout(constant_id = 1) const bool DOF = false;
+layout(constant_id = 2) const bool DOF_DEBUG = false;
+layout(constant_id = 3) const bool HALF_RES = false;
+layout(constant_id = 4) const bool BLOOM = false;
+#else
+#ifndef TOON
+#define TOON false
+#endif
+#ifndef DOF
+#define DOF false
+#endif
+#ifndef DOF_DEBUG
+#define DOF_DEBUG false
+#endif
+#ifndef HALF_RES
+#define HALF_RES false
+#endif
+#ifndef BLOOM
+#define BLOOM false
+#endif
+#endif
 
 #define	DISPLAY_DEPTH 0
 #define	DISPLAY_NORMAL 1
@@ -6,26 +33,26 @@
 #define	DISPLAY_COLOR 3
 #define DISPLAY_LIGHTING 4
 #define	DISPLAY_TOTAL 5
+#define DISPLAY_LIGHT_CLUSTERS 6
 
 // Shader constants
 layout(binding = 0) uniform PerFrame
 {
     mat4 um4View;
     mat4 um4Persp;
+    mat4 um4InvPersp;
     float ufFar;
     float ufNear;
     float ufInvScrHeight;
     float ufInvScrWidth;
+    float ufViewportScaleX;
+    float ufViewportScaleY;
     float ufMouseTexX;
     float ufMouseTexY;
     float ufGlowmask;
     int uiDisplayType;
     int uiScreenWidth;
     int uiScreenHeight;
-    bool ubBloomOn;
-    bool ubToonOn;
-    bool ubDOFOn;
-    bool ubDOFDebug;
 };
 
 //Depth used in the Z buffer is not linearly related to distance from camera
@@ -40,11 +67,38 @@ vec3 SampleTexture(sampler2D textureSampler, vec2 texCoord)
     return texture(textureSampler, texCoord).xyz;
 }
 
+// Dynamic resolution: intermediate targets are allocated for the largest render resolution and only their lower left
+// corner, this fraction of each axis, is rendered to. Full-screen passes get texture coordinates already scaled into it.
+vec2 GetViewportScale()
+{
+    return vec2(ufViewportScaleX, ufViewportScaleY);
+}
+
+// Size in texels of the part of an intermediate target that holds this frame. Rounds the way the frame graph sizes its viewports.
+ivec2 GetRenderAreaSize(ivec2 allocatedSize)
+{
+    return max(ivec2((vec2(allocatedSize) * GetViewportScale()) + 0.5f), ivec2(1));
+}
+
+// Keeps bilinear taps from reaching texels outside the rendered area, which hold whatever an earlier frame left there.
+vec2 ClampToRenderArea(vec2 texCoord)
+{
+    vec2 f2HalfTexel = 0.5f * vec2(ufInvScrWidth, ufInvScrHeight) * GetViewportScale();
+    return min(texCoord, GetViewportScale() - f2HalfTexel);
+}
+
+// The same for a target of another size, such as a downsampled one.
+vec2 ClampToRenderArea(vec2 texCoord, ivec2 allocatedSize)
+{
+    return min(texCoord, (vec2(GetRenderAreaSize(allocatedSize)) - 0.5f) / vec2(allocatedSize));
+}
+
 //Get a random normal vector  given a screen-space texture coordinate
 //Actually accesses a texture of random vectors
 vec3 getRandomNormal(sampler2D randomNormalTex, vec2 texCoord) 
 {
     ivec2 sz = textureSize(randomNormalTex, 0);
+    texCoord /= GetViewportScale();
     return texture(randomNormalTex, vec2(texCoord.s* (uiScreenWidth)/sz.x, (texCoord.t)*(uiScreenHeight)/sz.y)).rgb;
 }
 
@@ -53,6 +107,7 @@ vec3 getRandomNormal(sampler2D randomNormalTex, vec2 texCoord)
 float getRandomScalar(sampler2D randomScalarTex, vec2 texCoord) 
 {
     ivec2 sz = textureSize(randomScalarTex,0);
+    texCoord /= GetViewportScale();
     return texture(randomScalarTex, vec2(texCoord.s*uiScreenWidth/sz.x, texCoord.t*uiScreenHeight/sz.y)).r;
 }
 
@@ -66,20 +121,51 @@ vec3 UnscaleAndUnbiasNormal(vec3 scaledAndBiasedNormal)    // To take normals fr
     return (scaledAndBiasedNormal * 2.0f) - 1.0f;
 }
 
+// Octahedral normal encoding: project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the upper, and keep xy.
+// Two 16 bit channels hold it with less error than the three 8 bit channels the G-buffer used before.
+vec2 OctahedralWrap(vec2 v)
+{
+    return (1.0f - abs(v.yx)) * vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 EncodeOctahedralNormal(vec3 normal)
+{
+    normal /= (abs(normal.x) + abs(normal.y) + abs(normal.z));
+    vec2 f2Encoded = (normal.z >= 0.0f) ? normal.xy : OctahedralWrap(normal.xy);
+    return (f2Encoded * 0.5f) + 0.5f;
+}
+
+vec3 DecodeOctahedralNormal(vec2 encodedNormal)
+{
+    vec2 f2Encoded = (encodedNormal * 2.0f) - 1.0f;
+    vec3 normal = vec3(f2Encoded, 1.0f - abs(f2Encoded.x) - abs(f2Encoded.y));
+    float fFold = clamp(-normal.z, 0.0f, 1.0f);
+    normal.xy += vec2(normal.x >= 0.0f ? -fFold : fFold, normal.y >= 0.0f ? -fFold : fFold);
+    return normalize(normal);
+}
+
 vec3 SampleFragmentNormal(sampler2D fragmentNormalTex, vec2 texCoord)
 {
-    return UnscaleAndUnbiasNormal(SampleTexture(fragmentNormalTex, texCoord));
+    return DecodeOctahedralNormal(texture(fragmentNormalTex, texCoord).xy);
+}
+
+vec2 StoreFragmentNormal(vec3 normal)
+{
+    return EncodeOctahedralNormal(normalize(normal));
 }
 
-vec3 StoreFragmentNormal(vec3 normal)
+// The G-buffer has no position target; view space position comes back from the depth buffer.
+vec3 ReconstructViewPosition(sampler2D depthTex, vec2 texCoord)
 {
-    return ScaleAndBiasNormal(normalize(normal));
+    float fDepth = texture(depthTex, texCoord).r;
+    vec4 f4Position = um4InvPersp * vec4((vec3(texCoord / GetViewportScale(), fDepth) * 2.0f) - 1.0f, 1.0f);
+    return f4Position.xyz / f4Position.w;
 }
 
 vec3 GetNormalMappedNormal(sampler2D normalMap, vec2 texCoord, vec3 tangent, vec3 bitangent, vec3 vertexNormal)
 {
     vec3 normal = SampleTexture(normalMap, texCoord);
-    normal = dot(normal, normal) > 1e-6 ? SampleFragmentNormal(normalMap, texCoord) : vec3(0, 0, 1);
+    normal = dot(normal, normal) > 1e-6 ? UnscaleAndUnbiasNormal(normal) : vec3(0, 0, 1);
     mat3 tangentSpaceToModelSpaceTransform = mat3(tangent, bitangent, vertexNormal);
     return tangentSpaceToModelSpaceTransform * normal;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+// Cascaded shadow maps for the directional light, fitted by ShadowCascades on the CPU. Each matrix takes a view space position
+// straight to its cascade's shadow map coordinates and depth, all in [0, 1].
+layout(binding = 7) uniform PerFrame_Shadow
+{
+    mat4 um4ViewToShadow0;
+    mat4 um4ViewToShadow1;
+    mat4 um4ViewToShadow2;
+    mat4 um4ViewToShadow3;
+    vec4 uf4ShadowSplits;
+    vec4 uf4ShadowTexelSizes;
+    bool ubShadowsOn;
+};
+
+// One layer per cascade. Compared in hardware with linear filtering, so every tap is already a 2x2 PCF.
+layout(binding = 11) uniform sampler2DArrayShadow u_ShadowMaptex;
+
+// uf4ShadowSplits holds the view distance each cascade ends at; uf4ShadowTexelSizes the world size of a texel in each.
+int GetShadowCascade(float fViewDistance)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        if (fViewDistance < uf4ShadowSplits[i])
+            return i;
+    }
+
+    return -1;
+}
+
+mat4 GetViewToShadow(int iCascade)
+{
+    if (iCascade == 0)
+        return um4ViewToShadow0;
+    else if (iCascade == 1)
+        return um4ViewToShadow1;
+    else if (iCascade == 2)
+        return um4ViewToShadow2;
+    return um4ViewToShadow3;
+}
+
+// How lit a view space surface is by the directional light, from 0 (shadowed) to 1. Past the last cascade everything is lit.
+float SampleDirectionalShadow(vec3 f3Position, vec3 f3Normal)
+{
+    if (!ubShadowsOn)
+        return 1.0f;
+
+    int iCascade = GetShadowCascade(-f3Position.z);
+    if (iCascade < 0)
+        return 1.0f;
+
+    // Pushing the lookup out along the normal by a texel or so keeps surfaces from shadowing themselves at grazing angles.
+    vec3 f3OffsetPosition = f3Position + (normalize(f3Normal) * (1.5f * uf4ShadowTexelSizes[iCascade]));
+    vec4 f4Shadow = GetViewToShadow(iCascade) * vec4(f3OffsetPosition, 1.0f);
+    vec3 f3Shadow = f4Shadow.xyz / f4Shadow.w;
+
+    vec2 f2TexelSize = 1.0f / vec2(textureSize(u_ShadowMaptex, 0).xy);
+    float fLit = 0.0f;
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            vec2 f2Offset = (vec2(x, y) - 0.5f) * f2TexelSize;
+            fLit += texture(u_ShadowMaptex, vec4(f3Shadow.xy + f2Offset, float(iCascade), f3Shadow.z));
+        }
+    }
+
+    return fLit * 0.25f;
+}
@@ -0,0 +1,62 @@
+// Shared by the visibility passes. A visibility texel packs the draw index above the triangle index; the split must match
+// c_visibilityTriangleBits in GLRenderer.cpp.
+#define VISIBILITY_TRIANGLE_BITS 20u
+#define VISIBILITY_TRIANGLE_MASK ((1u << VISIBILITY_TRIANGLE_BITS) - 1u)
+#define VISIBILITY_EMPTY 0xFFFFFFFFu
+
+// One per draw in the opaque list, in list order. Mirrors VisibilityDrawData in GLRenderer.cpp.
+struct DrawData
+{
+    mat4 m4ModelView;
+    mat4 m4InvTrans;
+    uvec2 u2DiffuseHandle;      // Bindless texture handles; zero when the draw has no such texture.
+    uvec2 u2NormalHandle;
+    uint uFirstIndex;           // Into auIndices. Indices already include the draw's base vertex.
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataList
+{
+    DrawData aDrawData[];
+};
+
+// Every mesh in the scene, concatenated, so one full-screen pass can reach any triangle. Vertices are tightly packed Vertex structs.
+layout(std430, binding = 1) readonly buffer SceneVertices
+{
+    float afVertices[];
+};
+
+layout(std430, binding = 2) readonly buffer SceneIndices
+{
+    uint auIndices[];
+};
+
+layout(binding = 3) uniform PerDraw_Visibility
+{
+    int uiDrawID;
+};
+
+#define SCENE_VERTEX_FLOATS 11u
+
+vec3 FetchScenePosition(uint uVertex)
+{
+    uint uBase = uVertex * SCENE_VERTEX_FLOATS;
+    return vec3(afVertices[uBase], afVertices[uBase + 1u], afVertices[uBase + 2u]);
+}
+
+vec3 FetchSceneNormal(uint uVertex)
+{
+    uint uBase = uVertex * SCENE_VERTEX_FLOATS + 3u;
+    return vec3(afVertices[uBase], afVertices[uBase + 1u], afVertices[uBase + 2u]);
+}
+
+vec3 FetchSceneTangent(uint uVertex)
+{
+    uint uBase = uVertex * SCENE_VERTEX_FLOATS + 6u;
+    return vec3(afVertices[uBase], afVertices[uBase + 1u], afVertices[uBase + 2u]);
+}
+
+vec2 FetchSceneTexcoord(uint uVertex)
+{
+    uint uBase = uVertex * SCENE_VERTEX_FLOATS + 9u;
+    return vec2(afVertices[uBase], afVertices[uBase + 1u]);
+}
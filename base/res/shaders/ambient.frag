@@ -1,56 +1,35 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 #include "LightingCommon.glsl"
+#include "ShadowCommon.glsl"
+#include "AmbientOcclusionCommon.glsl"
 
 // Textures
-uniform sampler2D u_Depthtex;
-uniform sampler2D u_Normaltex;
-uniform sampler2D u_Positiontex;
-uniform sampler2D u_Colortex;
-uniform sampler2D u_RandomNormaltex;
-uniform sampler2D u_RandomScalartex;
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+layout(binding = 4) uniform sampler2D u_RandomNormaltex;
+layout(binding = 5) uniform sampler2D u_RandomScalartex;
 
-in vec2 vo_f2TexCoord;
-out vec4 out_f4Colour;
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
 
-const float occlusion_strength = 1.5f;
 void main() 
 {
     float fLinearDepth = texture(u_Depthtex, vo_f2TexCoord).r;
     fLinearDepth = linearizeDepth(fLinearDepth);
 
     vec3 f3Normal = SampleFragmentNormal(u_Normaltex, vo_f2TexCoord);
-    vec3 f3Position = SampleTexture(u_Positiontex, vo_f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, vo_f2TexCoord);
     vec3 f3Colour = SampleTexture(u_Colortex, vo_f2TexCoord);
 	vec4 f4FinalColour = vec4(0.0, 0.0, 0.0, 1.0);
 
     if (fLinearDepth < 0.99f) 
-    {
-        float fDiffuse = max(0.0, dot(uf4DirecLightDir.xyz, f3Normal));
-		if (ubToonOn)
-		{
-			if (fDiffuse >= 1.0)
-				fDiffuse = 1.0;
-			else if (fDiffuse >= 0.8)
-				fDiffuse = 0.8;
-			else if (fDiffuse >= 0.6)
-				fDiffuse = 0.6;
-			else if (fDiffuse >= 0.4)
-				fDiffuse = 0.4;
-			else if (fDiffuse >= 0.2)
-				fDiffuse = 0.2;
-			else
-				fDiffuse = 0.0;
-
-			float dp = dot (normalize(f3Normal), normalize(-f3Position));
-			if (dp < 0.1)
-				f4FinalColour = vec4 (0.0, 0.0, 0.0, 1.0);
-			else
-				f4FinalColour = vec4(f3Colour * clamp(vec3(uf4DirecLightDir.w * fDiffuse), uf3AmbientContrib, vec3(1.0f)), 1.0f);
-		}
-		else
-			f4FinalColour = vec4(f3Colour * clamp(vec3(uf4DirecLightDir.w * fDiffuse), uf3AmbientContrib, vec3(1.0f)), 1.0f);
-		
-    }	
+		f4FinalColour = vec4(ComputeDirectionalAndAmbientLighting(f3Colour, f3Position, f3Normal, SampleDirectionalShadow(f3Position, f3Normal),
+            SampleAmbientOcclusion(vo_f2TexCoord, f3Position)), 1.0f);
 
 	out_f4Colour = f4FinalColour;
 }
@@ -0,0 +1,37 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "LightingCommon.glsl"
+#include "PointShadowCommon.glsl"
+#include "ClusterCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
+
+// Every point light in one full-screen pass: each pixel finds its cluster and loops over the lights assigned to it.
+void main() 
+{
+    if (texture(u_Depthtex, vo_f2TexCoord).r >= 1.0f)
+        discard;    // Background.
+
+    vec3 f3Normal = SampleFragmentNormal(u_Normaltex, vo_f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, vo_f2TexCoord);
+    vec3 f3Colour = SampleTexture(u_Colortex, vo_f2TexCoord);
+
+    uvec2 u2Range = GetClusterLightRange(f3Position);
+    vec3 f3Irradiance = vec3(0.0f);
+    for (uint i = 0u; i < u2Range.y; ++i)
+    {
+        PointLight light = aLights[auClusterLightIndices[u2Range.x + i]];
+        f3Irradiance += ComputeShadowedPointLightIrradiance(light.f4PositionRadius, light.f4ColourIntensity, light.iShadow, f3Position, f3Normal);
+    }
+
+    out_f4Colour = vec4(f3Colour * f3Irradiance, 1.0f);
+}
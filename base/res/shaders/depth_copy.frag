@@ -0,0 +1,14 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+
+// Copies the G-buffer depth into a depth/stencil target, which can't be done with a blit between the two formats.
+void main() 
+{
+    gl_FragDepth = texelFetch(u_Depthtex, ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -1,25 +1,37 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 #include "LightingCommon.glsl"
+#include "ClusterCommon.glsl"
 
 // Textures
-uniform sampler2D u_Depthtex;
-uniform sampler2D u_Normaltex;
-uniform sampler2D u_Positiontex;
-uniform sampler2D u_Colortex;
-uniform sampler2D u_RandomNormaltex;
-uniform sampler2D u_RandomScalartex;
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+layout(binding = 4) uniform sampler2D u_RandomNormaltex;
+layout(binding = 5) uniform sampler2D u_RandomScalartex;
 
-in vec2 vo_f2TexCoord;
-out vec4 out_f4Colour;
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
 
 const float occlusion_strength = 1.5f;
+
+// Blue through green and yellow to red as fLevel goes from 0 to 1.
+vec3 HeatMapColour(float fLevel)
+{
+    fLevel = clamp(fLevel, 0.0f, 1.0f) * 3.0f;
+    return clamp(vec3(fLevel - 1.0f, (fLevel < 2.0f) ? fLevel : (3.0f - fLevel), 1.0f - fLevel), 0.0f, 1.0f);
+}
+
 void main() 
 {
     float fLinearDepth = texture(u_Depthtex, vo_f2TexCoord).r;
     fLinearDepth = linearizeDepth(fLinearDepth);
 
-    vec3 f3Normal = SampleTexture(u_Normaltex, vo_f2TexCoord);
-    vec3 f3Position = SampleTexture(u_Positiontex, vo_f2TexCoord);
+    vec3 f3Normal = SampleFragmentNormal(u_Normaltex, vo_f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, vo_f2TexCoord);
     vec3 f3Colour = SampleTexture(u_Colortex, vo_f2TexCoord);
 
     switch (uiDisplayType) 
@@ -41,6 +53,14 @@ void main()
             break;
         case DISPLAY_TOTAL:
             break;
+        case DISPLAY_LIGHT_CLUSTERS:
+        {
+            // Lights in this pixel's cluster; 16 or more is full red. Empty clusters show the scene dimmed.
+            uint uLightCount = (fLinearDepth < 1.0f) ? GetClusterLightRange(f3Position).y : 0u;
+            vec3 f3Heat = (uLightCount > 0u) ? HeatMapColour(float(uLightCount) / 16.0f) : vec3(0.0f);
+            out_f4Colour = vec4(mix(f3Colour * 0.25f, f3Heat, (uLightCount > 0u) ? 0.75f : 0.0f), 1.0f);
+            break;
+        }
     }	
 }
 
@@ -1,16 +1,19 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 #include "LightingCommon.glsl"
 
 // Textures
-uniform sampler2D u_Depthtex;
-uniform sampler2D u_Normaltex;
-uniform sampler2D u_Positiontex;
-uniform sampler2D u_Colortex;
-uniform sampler2D u_RandomNormaltex;
-uniform sampler2D u_RandomScalartex;
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+layout(binding = 4) uniform sampler2D u_RandomNormaltex;
+layout(binding = 5) uniform sampler2D u_RandomScalartex;
 
-in vec2 vo_f2TexCoord;
-out vec4 out_f4Colour;
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
 
 const float occlusion_strength = 1.5f;
 void main() 
@@ -0,0 +1,30 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "LightingCommon.glsl"
+#include "PointShadowCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+
+layout(location = 1) flat in vec4 vo_f4Light;          // View space position, radius.
+layout(location = 2) flat in vec4 vo_f4LightColour;    // Colour, intensity.
+layout(location = 3) flat in int vo_iShadow;
+layout(location = 0) out vec4 out_f4Colour;
+
+// Runs for the pixels the stencil pass found inside the light's sphere. The volume is a mesh, so texture coordinates come from
+// the pixel position rather than from the vertices.
+void main() 
+{
+    vec2 f2TexCoord = gl_FragCoord.xy * vec2(ufInvScrWidth, ufInvScrHeight) * GetViewportScale();
+    vec3 f3Normal = SampleFragmentNormal(u_Normaltex, f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, f2TexCoord);
+    vec3 f3Colour = SampleTexture(u_Colortex, f2TexCoord);
+
+    vec3 f3Irradiance = ComputeShadowedPointLightIrradiance(vo_f4Light, vo_f4LightColour, vo_iShadow, f3Position, f3Normal);
+    out_f4Colour = vec4(f3Colour * f3Irradiance, 1.0f);
+}
@@ -0,0 +1,29 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "LightingCommon.glsl"
+
+layout(binding = 6) uniform PerDraw_LightVolume
+{
+    int uiLightIndex;
+};
+
+layout(location = 0) in vec3 in_f3Position;
+
+layout(location = 1) flat out vec4 vo_f4Light;          // View space position, radius.
+layout(location = 2) flat out vec4 vo_f4LightColour;    // Colour, intensity.
+layout(location = 3) flat out int vo_iShadow;
+
+// The sphere mesh, scaled and moved onto one light from the light list. Lights are already in view space.
+void main() 
+{
+    PointLight light = aLights[uiLightIndex];
+    vec3 f3Position = light.f4PositionRadius.xyz + (in_f3Position * light.f4PositionRadius.w);
+
+    vo_f4Light = light.f4PositionRadius;
+    vo_f4LightColour = light.f4ColourIntensity;
+    vo_iShadow = light.iShadow;
+    gl_Position = um4Persp * vec4(f3Position, 1.0f);
+}
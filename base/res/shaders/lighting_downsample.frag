@@ -0,0 +1,38 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+
+layout(location = 0) in vec2 vo_f2TexCoord;
+
+layout(location = 0) out float out_fDepth;
+layout(location = 1) out vec2 out_f2Normal;
+
+// Halves depth and normals for reduced resolution lighting. Averaging would invent surfaces that don't exist along edges, so one
+// of the four texels is kept whole: the nearest, which keeps thin foreground objects lit. Run twice for quarter resolution.
+void main()
+{
+    ivec2 i2MaxTexel = GetRenderAreaSize(textureSize(u_Depthtex, 0)) - 1;
+    ivec2 i2Texel = ivec2(gl_FragCoord.xy) * 2;
+
+    ivec2 i2Nearest = i2Texel;
+    float fNearestDepth = 2.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 i2Sample = min(i2Texel + ivec2(i & 1, i >> 1), i2MaxTexel);
+        float fDepth = texelFetch(u_Depthtex, i2Sample, 0).r;
+        if (fDepth < fNearestDepth)
+        {
+            fNearestDepth = fDepth;
+            i2Nearest = i2Sample;
+        }
+    }
+
+    out_fDepth = fNearestDepth;
+    out_f2Normal = texelFetch(u_Normaltex, i2Nearest, 0).xy;   // Still octahedral encoded.
+}
@@ -0,0 +1,67 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+layout(binding = 8) uniform sampler2D u_LowResDepthtex;
+layout(binding = 9) uniform sampler2D u_LowResNormaltex;
+layout(binding = 10) uniform sampler2D u_Irradiancetex;
+
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
+
+const float c_fDepthSharpness = 200.0f;     // In units of linearized depth.
+const float c_fNormalPower = 8.0f;
+
+// Joint bilateral upsample: the four nearest low resolution texels, weighted bilinearly and by how well their depth and normal
+// match this pixel, so irradiance doesn't bleed across silhouettes and creases.
+void main()
+{
+    ivec2 i2Texel = ivec2(gl_FragCoord.xy);
+    float fDepth = texelFetch(u_Depthtex, i2Texel, 0).r;
+    float fLinearDepth = linearizeDepth(fDepth);
+    vec3 f3Normal = DecodeOctahedralNormal(texelFetch(u_Normaltex, i2Texel, 0).xy);
+
+    ivec2 i2LowResSize = textureSize(u_Irradiancetex, 0);
+    vec2 f2LowResPosition = (gl_FragCoord.xy * vec2(i2LowResSize) / vec2(textureSize(u_Depthtex, 0))) - 0.5f;
+    ivec2 i2LowResBase = ivec2(floor(f2LowResPosition));
+    vec2 f2Fraction = f2LowResPosition - vec2(i2LowResBase);
+
+    vec3 f3Irradiance = vec3(0.0f);
+    float fTotalWeight = 0.0f;
+    vec3 f3BestIrradiance = vec3(0.0f);
+    float fBestDepthDifference = 1e6f;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 i2Offset = ivec2(i & 1, i >> 1);
+        ivec2 i2LowResTexel = clamp(i2LowResBase + i2Offset, ivec2(0), GetRenderAreaSize(i2LowResSize) - 1);
+
+        vec3 f3SampleIrradiance = texelFetch(u_Irradiancetex, i2LowResTexel, 0).rgb;
+        float fDepthDifference = abs(linearizeDepth(texelFetch(u_LowResDepthtex, i2LowResTexel, 0).r) - fLinearDepth);
+        vec3 f3SampleNormal = DecodeOctahedralNormal(texelFetch(u_LowResNormaltex, i2LowResTexel, 0).xy);
+
+        vec2 f2Bilinear = mix(1.0f - f2Fraction, f2Fraction, vec2(i2Offset));
+        float fWeight = f2Bilinear.x * f2Bilinear.y;
+        fWeight *= 1.0f / (1.0f + (fDepthDifference * c_fDepthSharpness));
+        fWeight *= pow(max(dot(f3SampleNormal, f3Normal), 0.0f), c_fNormalPower);
+
+        f3Irradiance += f3SampleIrradiance * fWeight;
+        fTotalWeight += fWeight;
+
+        if (fDepthDifference < fBestDepthDifference)
+        {
+            fBestDepthDifference = fDepthDifference;
+            f3BestIrradiance = f3SampleIrradiance;
+        }
+    }
+
+    // Nothing matched, e.g. a surface too small to survive the downsample: take the closest in depth.
+    f3Irradiance = (fTotalWeight > 1e-4f) ? (f3Irradiance / fTotalWeight) : f3BestIrradiance;
+
+    out_f4Colour = vec4(SampleTexture(u_Colortex, vo_f2TexCoord) * f3Irradiance, 1.0f);
+}
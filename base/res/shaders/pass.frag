@@ -1,3 +1,7 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 
 layout(binding = 1) uniform PerDraw_Object
@@ -7,19 +11,17 @@ layout(binding = 1) uniform PerDraw_Object
     vec3 uf3Color;
 };
 
-in vec3 vo_f3Normal;
-in vec4 vo_f4Position;
-in vec2 vo_f2Texcoord;
-in vec3 vo_f3Tangent;
-in vec3 vo_f3Bitangent;
+layout(location = 0) in vec3 vo_f3Normal;
+layout(location = 2) in vec2 vo_f2Texcoord;
+layout(location = 3) in vec3 vo_f3Tangent;
+layout(location = 4) in vec3 vo_f3Bitangent;
 
-out vec4 out_f4Normal;
-out vec4 out_f4Position;
-out vec4 out_f4Colour;
+layout(location = 1) out vec2 out_f2Normal;
+layout(location = 0) out vec4 out_f4Colour;
 
-uniform sampler2D t2DDiffuse;
-uniform sampler2D t2DNormal;
-uniform sampler2D t2DSpecular;
+layout(binding = 0) uniform sampler2D t2DDiffuse;
+layout(binding = 1) uniform sampler2D t2DNormal;
+layout(binding = 2) uniform sampler2D t2DSpecular;
 
 void main()
 {
@@ -27,7 +29,6 @@ void main()
     vec3 f3Bitangent = (dot(vo_f3Bitangent, vo_f3Bitangent) > 1e-6) ? normalize(vo_f3Bitangent) : vec3(0);
     vec3 f3Normal = GetNormalMappedNormal(t2DNormal, vo_f2Texcoord, f3Tangent, f3Bitangent, normalize(vo_f3Normal));
 
-    out_f4Normal = vec4(StoreFragmentNormal((um4InvTrans * vec4(f3Normal, 0.0f)).xyz), ufGlowmask);
-    out_f4Position = vo_f4Position;
-    out_f4Colour = texture(t2DDiffuse, vo_f2Texcoord);
+    out_f2Normal = StoreFragmentNormal((um4InvTrans * vec4(f3Normal, 0.0f)).xyz);
+    out_f4Colour = vec4(SampleTexture(t2DDiffuse, vo_f2Texcoord), ufGlowmask);
 }
@@ -1,3 +1,7 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 
 layout(binding = 1) uniform PerDraw_Object
@@ -7,22 +11,20 @@ layout(binding = 1) uniform PerDraw_Object
     vec3 uf3Color;
 };
 
-in vec3 in_f3Position;
-in vec3 in_f3Normal;
-in vec2 in_f2Texcoord;
-in vec3 in_f3Tangent;
+layout(location = 0) in vec3 in_f3Position;
+layout(location = 1) in vec3 in_f3Normal;
+layout(location = 2) in vec2 in_f2Texcoord;
+layout(location = 3) in vec3 in_f3Tangent;
 
-out vec3 vo_f3Normal;
-out vec4 vo_f4Position;
-out vec2 vo_f2Texcoord;
-out vec3 vo_f3Tangent;
-out vec3 vo_f3Bitangent;
+layout(location = 0) out vec3 vo_f3Normal;
+layout(location = 2) out vec2 vo_f2Texcoord;
+layout(location = 3) out vec3 vo_f3Tangent;
+layout(location = 4) out vec3 vo_f3Bitangent;
 
 void main() 
 {
     vo_f3Normal = in_f3Normal;
     vec4 f4Camera = um4View * um4Model * vec4(in_f3Position, 1.0);
-    vo_f4Position = f4Camera;
     vo_f2Texcoord = in_f2Texcoord;
     vo_f3Tangent = in_f3Tangent;
     vo_f3Bitangent = cross(in_f3Normal, in_f3Tangent);
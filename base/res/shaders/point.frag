@@ -1,46 +1,36 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 #include "LightingCommon.glsl"
+#include "PointShadowCommon.glsl"
 
 // Textures
-uniform sampler2D u_Depthtex;
-uniform sampler2D u_Normaltex;
-uniform sampler2D u_Positiontex;
-uniform sampler2D u_Colortex;
-uniform sampler2D u_RandomNormaltex;
-uniform sampler2D u_RandomScalartex;
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+layout(binding = 4) uniform sampler2D u_RandomNormaltex;
+layout(binding = 5) uniform sampler2D u_RandomScalartex;
 
-in vec2 vo_f2TexCoord;
-out vec4 out_f4Colour;
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 1) flat in vec4 vo_f4Light;          // View space position, radius.
+layout(location = 2) flat in vec4 vo_f4LightColour;    // Colour, intensity.
+layout(location = 3) flat in int vo_iShadow;
+layout(location = 0) out vec4 out_f4Colour;
 
-const float occlusion_strength = 1.5f;
 void main() 
 {
     vec3 f3Normal = SampleFragmentNormal(u_Normaltex, vo_f2TexCoord);
-    vec3 f3Position = SampleTexture(u_Positiontex, vo_f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, vo_f2TexCoord);
     vec3 f3Colour = SampleTexture(u_Colortex, vo_f2TexCoord);
 
     vec3 f3FinalColour = vec3(0.0f);
 
-	float fDistToLight = length(uf4Light.xyz - f3Position);
-	float fDecay = max(1.0f - (fDistToLight / uf4Light.w), 0.0f);
-	float fClampedDotPdt = clamp(dot(normalize(f3Normal), (uf4Light.xyz - f3Position)/fDistToLight), 0.0f, 1.0f);
+	vec3 f3Irradiance = ComputeShadowedPointLightIrradiance(vo_f4Light, vo_f4LightColour, vo_iShadow, f3Position, f3Normal);
 
-	if (ubToonOn)
-	{
-		if (fClampedDotPdt == 1.0f)
-			fClampedDotPdt = 1.0f;
-		else if (fClampedDotPdt >= 0.8f)
-			fClampedDotPdt = 0.8f;
-		else if (fClampedDotPdt >= 0.6f)
-			fClampedDotPdt = 0.6f;
-		else if (fClampedDotPdt >= 0.4f)
-			fClampedDotPdt = 0.4f;
-		else if (fClampedDotPdt >= 0.2f)
-			fClampedDotPdt = 0.2f;
-		else
-			fClampedDotPdt = 0.0f;
-	}
-	f3FinalColour = (f3Colour * uf3LightCol * ufLightIl * fClampedDotPdt) * fDecay;
+	// At reduced resolution only the irradiance is accumulated; lighting_upsample.frag applies full resolution albedo.
+	f3FinalColour = HALF_RES ? f3Irradiance : (f3Colour * f3Irradiance);
     
     out_f4Colour = vec4(f3FinalColour, 1.0);		// Because light and normal are both in view space.
 }
\ No newline at end of file
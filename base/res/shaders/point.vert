@@ -0,0 +1,48 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "LightingCommon.glsl"
+
+layout(location = 0) in vec3 in_f3Position;
+layout(location = 1) in vec2 in_f2Texcoord;
+
+layout(location = 0) out vec2 vo_f2TexCoord;
+layout(location = 1) flat out vec4 vo_f4Light;
+layout(location = 2) flat out vec4 vo_f4LightColour;
+layout(location = 3) flat out int vo_iShadow;
+
+// One instance per visible light. The full-screen quad shrinks to the screen rectangle around the light's sphere, so only pixels
+// the light can reach are shaded. A sphere that crosses the near plane keeps the whole screen.
+void main() 
+{
+    PointLight light = aLights[gl_InstanceID];
+    vec3 f3Centre = light.f4PositionRadius.xyz;
+    float fRadius = light.f4PositionRadius.w;
+
+    vec2 f2Min = vec2(-1.0f);
+    vec2 f2Max = vec2(1.0f);
+    if ((f3Centre.z + fRadius) < -ufNear)
+    {
+        // The corners of the sphere's bounding box are all in front of the eye, so their projections bound the sphere's.
+        f2Min = vec2(1.0f);
+        f2Max = vec2(-1.0f);
+        for (int i = 0; i < 8; ++i)
+        {
+            vec3 f3Corner = f3Centre + (fRadius * vec3(((i & 1) != 0) ? 1.0f : -1.0f, ((i & 2) != 0) ? 1.0f : -1.0f, ((i & 4) != 0) ? 1.0f : -1.0f));
+            vec4 f4Clip = um4Persp * vec4(f3Corner, 1.0f);
+            f2Min = min(f2Min, f4Clip.xy / f4Clip.w);
+            f2Max = max(f2Max, f4Clip.xy / f4Clip.w);
+        }
+        f2Min = clamp(f2Min, vec2(-1.0f), vec2(1.0f));
+        f2Max = clamp(f2Max, vec2(-1.0f), vec2(1.0f));
+    }
+
+    vec2 f2Position = mix(f2Min, f2Max, in_f2Texcoord);
+    vo_f2TexCoord = ((f2Position * 0.5f) + 0.5f) * GetViewportScale();
+    vo_f4Light = light.f4PositionRadius;
+    vo_f4LightColour = light.f4ColourIntensity;
+    vo_iShadow = light.iShadow;
+    gl_Position = vec4(f2Position, 0.0f, 1.0f);
+}
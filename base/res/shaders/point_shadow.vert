@@ -0,0 +1,40 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+// One face of a point light's shadow cube per instance, so a draw covers all six faces at once.
+struct PointShadowFace
+{
+    mat4 m4WorldToFace;
+    mat4 m4FaceToAtlas;     // Onto the face's tile. The viewport is the whole atlas.
+};
+
+layout(std430, binding = 6) readonly buffer PointShadowFaces
+{
+    PointShadowFace aShadowFaces[];
+};
+
+layout(binding = 9) uniform PerDraw_PointShadow
+{
+    mat4 um4PointShadowModel;
+    int uiFirstShadowFace;
+};
+
+layout(location = 0) in vec3 in_f3Position;
+
+out float gl_ClipDistance[4];
+
+// Depth only, into the shadow atlas. Clipping against the face's frustum keeps it inside its tile, off the neighbouring ones.
+void main() 
+{
+    PointShadowFace face = aShadowFaces[uiFirstShadowFace + gl_InstanceID];
+    vec4 f4Face = face.m4WorldToFace * (um4PointShadowModel * vec4(in_f3Position, 1.0f));
+
+    gl_ClipDistance[0] = f4Face.w - f4Face.x;
+    gl_ClipDistance[1] = f4Face.w + f4Face.x;
+    gl_ClipDistance[2] = f4Face.w - f4Face.y;
+    gl_ClipDistance[3] = f4Face.w + f4Face.y;
+    gl_Position = face.m4FaceToAtlas * f4Face;
+}
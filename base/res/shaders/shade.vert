@@ -1,12 +1,16 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
 #include "ShaderCommon.glsl"
 
-in vec3 in_f3Position;
-in vec2 in_f2Texcoord;
+layout(location = 0) in vec3 in_f3Position;
+layout(location = 1) in vec2 in_f2Texcoord;
 
-out vec2 vo_f2TexCoord;
+layout(location = 0) out vec2 vo_f2TexCoord;
 
 void main() 
 {
-    vo_f2TexCoord = in_f2Texcoord;
+    vo_f2TexCoord = in_f2Texcoord * GetViewportScale();
     gl_Position = vec4(in_f3Position, 1.0f);
 }
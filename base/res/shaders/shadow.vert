@@ -0,0 +1,18 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+layout(binding = 8) uniform PerDraw_Shadow
+{
+    mat4 um4ShadowModelViewProj;
+};
+
+layout(location = 0) in vec3 in_f3Position;
+
+// Depth only, into one cascade of the directional light's shadow map.
+void main() 
+{
+    gl_Position = um4ShadowModelViewProj * vec4(in_f3Position, 1.0f);
+}
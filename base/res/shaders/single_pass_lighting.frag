@@ -0,0 +1,41 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "LightingCommon.glsl"
+#include "PointShadowCommon.glsl"
+#include "ShadowCommon.glsl"
+#include "AmbientOcclusionCommon.glsl"
+
+// Textures
+layout(binding = 0) uniform sampler2D u_Depthtex;
+layout(binding = 1) uniform sampler2D u_Normaltex;
+layout(binding = 3) uniform sampler2D u_Colortex;
+
+layout(location = 0) in vec2 vo_f2TexCoord;
+layout(location = 0) out vec4 out_f4Colour;
+
+// All of a pixel's lighting in one go: the G-buffer is read once, every point light in the list is summed in registers, and the
+// target is written once, with no blending.
+void main() 
+{
+    float fLinearDepth = linearizeDepth(texture(u_Depthtex, vo_f2TexCoord).r);
+    if (fLinearDepth >= 0.99f)
+    {
+        out_f4Colour = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return;
+    }
+
+    vec3 f3Normal = SampleFragmentNormal(u_Normaltex, vo_f2TexCoord);
+    vec3 f3Position = ReconstructViewPosition(u_Depthtex, vo_f2TexCoord);
+    vec3 f3Colour = SampleTexture(u_Colortex, vo_f2TexCoord);
+
+    vec3 f3Irradiance = vec3(0.0f);
+    for (int i = 0; i < uiPointLightCount; ++i)
+        f3Irradiance += ComputeShadowedPointLightIrradiance(aLights[i].f4PositionRadius, aLights[i].f4ColourIntensity, aLights[i].iShadow, f3Position, f3Normal);
+
+    float fShadow = SampleDirectionalShadow(f3Position, f3Normal);
+    float fOcclusion = SampleAmbientOcclusion(vo_f2TexCoord, f3Position);
+    out_f4Colour = vec4(ComputeDirectionalAndAmbientLighting(f3Colour, f3Position, f3Normal, fShadow, fOcclusion) + (f3Colour * f3Irradiance), 1.0f);
+}
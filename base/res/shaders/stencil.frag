@@ -0,0 +1,13 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+
+layout(location = 0) out vec4 out_f4Colour;
+
+// For passes that only write depth or stencil. Colour writes are masked off, or there is no colour target.
+void main() 
+{
+    out_f4Colour = vec4(0.0f);
+}
@@ -0,0 +1,14 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "VisibilityCommon.glsl"
+
+layout(location = 0) out uint out_uVisibility;
+
+// Everything about the surface is worked out later from these 32 bits, so this pass costs the same whatever the material.
+void main()
+{
+    out_uVisibility = (uint(uiDrawID) << VISIBILITY_TRIANGLE_BITS) | uint(gl_PrimitiveID);
+}
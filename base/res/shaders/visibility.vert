@@ -0,0 +1,13 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#include "ShaderCommon.glsl"
+#include "VisibilityCommon.glsl"
+
+layout(location = 0) in vec3 in_f3Position;
+
+void main() 
+{
+    gl_Position = um4Persp * aDrawData[uiDrawID].m4ModelView * vec4(in_f3Position, 1.0);
+}
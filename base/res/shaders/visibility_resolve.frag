@@ -0,0 +1,126 @@
+#version 430
+#ifdef GL_SPIRV
+#extension GL_GOOGLE_include_directive : require
+#endif
+#extension GL_ARB_bindless_texture : require
+#include "ShaderCommon.glsl"
+#include "VisibilityCommon.glsl"
+
+// Textures
+layout(binding = 7) uniform usampler2D u_Visibilitytex;
+
+layout(location = 0) in vec2 vo_f2TexCoord;
+
+layout(location = 1) out vec2 out_f2Normal;
+layout(location = 0) out vec4 out_f4Colour;
+
+struct BarycentricDerivatives
+{
+    vec3 f3Lambda;
+    vec3 f3Ddx;     // Change in the barycentrics one pixel to the right, and one pixel up.
+    vec3 f3Ddy;
+};
+
+// Perspective correct barycentrics of a pixel, and their screen space derivatives so texture fetches can still pick a mip level.
+// From "The Visibility Buffer: A Cache-Friendly Approach to Deferred Shading", Burns and Hunt, and the analytic derivatives in The Forge.
+BarycentricDerivatives ComputeBarycentricDerivatives(vec4 f4Clip0, vec4 f4Clip1, vec4 f4Clip2, vec2 f2PixelNdc, vec2 f2ScreenSize)
+{
+    BarycentricDerivatives result;
+
+    vec3 f3InvW = 1.0f / vec3(f4Clip0.w, f4Clip1.w, f4Clip2.w);
+    vec2 f2Ndc0 = f4Clip0.xy * f3InvW.x;
+    vec2 f2Ndc1 = f4Clip1.xy * f3InvW.y;
+    vec2 f2Ndc2 = f4Clip2.xy * f3InvW.z;
+
+    float fInvDet = 1.0f / determinant(mat2(f2Ndc2 - f2Ndc1, f2Ndc0 - f2Ndc1));
+    result.f3Ddx = vec3(f2Ndc1.y - f2Ndc2.y, f2Ndc2.y - f2Ndc0.y, f2Ndc0.y - f2Ndc1.y) * fInvDet * f3InvW;
+    result.f3Ddy = vec3(f2Ndc2.x - f2Ndc1.x, f2Ndc0.x - f2Ndc2.x, f2Ndc1.x - f2Ndc0.x) * fInvDet * f3InvW;
+    float fDdxSum = dot(result.f3Ddx, vec3(1.0f));
+    float fDdySum = dot(result.f3Ddy, vec3(1.0f));
+
+    vec2 f2Delta = f2PixelNdc - f2Ndc0;
+    float fInterpInvW = f3InvW.x + (f2Delta.x * fDdxSum) + (f2Delta.y * fDdySum);
+    float fInterpW = 1.0f / fInterpInvW;
+
+    result.f3Lambda.x = fInterpW * (f3InvW.x + (f2Delta.x * result.f3Ddx.x) + (f2Delta.y * result.f3Ddy.x));
+    result.f3Lambda.y = fInterpW * ((f2Delta.x * result.f3Ddx.y) + (f2Delta.y * result.f3Ddy.y));
+    result.f3Lambda.z = fInterpW * ((f2Delta.x * result.f3Ddx.z) + (f2Delta.y * result.f3Ddy.z));
+
+    // From per NDC unit to per pixel. GL windows have y up, same as NDC, so no flip.
+    result.f3Ddx *= (2.0f / f2ScreenSize.x);
+    result.f3Ddy *= (2.0f / f2ScreenSize.y);
+    fDdxSum *= (2.0f / f2ScreenSize.x);
+    fDdySum *= (2.0f / f2ScreenSize.y);
+
+    float fInterpWDdx = 1.0f / (fInterpInvW + fDdxSum);
+    float fInterpWDdy = 1.0f / (fInterpInvW + fDdySum);
+    result.f3Ddx = (fInterpWDdx * ((result.f3Lambda * fInterpInvW) + result.f3Ddx)) - result.f3Lambda;
+    result.f3Ddy = (fInterpWDdy * ((result.f3Lambda * fInterpInvW) + result.f3Ddy)) - result.f3Lambda;
+
+    return result;
+}
+
+vec2 Interpolate(vec3 f3Weights, vec2 f2Value0, vec2 f2Value1, vec2 f2Value2)
+{
+    return (f2Value0 * f3Weights.x) + (f2Value1 * f3Weights.y) + (f2Value2 * f3Weights.z);
+}
+
+vec3 Interpolate(vec3 f3Weights, vec3 f3Value0, vec3 f3Value1, vec3 f3Value2)
+{
+    return (f3Value0 * f3Weights.x) + (f3Value1 * f3Weights.y) + (f3Value2 * f3Weights.z);
+}
+
+bool IsValidHandle(uvec2 u2Handle)
+{
+    return (u2Handle.x | u2Handle.y) != 0u;
+}
+
+void main()
+{
+    uint uVisibility = texelFetch(u_Visibilitytex, ivec2(gl_FragCoord.xy), 0).r;
+    if (uVisibility == VISIBILITY_EMPTY)
+        discard;
+
+    DrawData drawData = aDrawData[uVisibility >> VISIBILITY_TRIANGLE_BITS];
+    uint uFirstIndex = drawData.uFirstIndex + ((uVisibility & VISIBILITY_TRIANGLE_MASK) * 3u);
+    uint uVertex0 = auIndices[uFirstIndex];
+    uint uVertex1 = auIndices[uFirstIndex + 1u];
+    uint uVertex2 = auIndices[uFirstIndex + 2u];
+
+    mat4 m4ModelViewProjection = um4Persp * drawData.m4ModelView;
+    vec4 f4Clip0 = m4ModelViewProjection * vec4(FetchScenePosition(uVertex0), 1.0f);
+    vec4 f4Clip1 = m4ModelViewProjection * vec4(FetchScenePosition(uVertex1), 1.0f);
+    vec4 f4Clip2 = m4ModelViewProjection * vec4(FetchScenePosition(uVertex2), 1.0f);
+
+    vec2 f2PixelNdc = (gl_FragCoord.xy * vec2(ufInvScrWidth, ufInvScrHeight) * 2.0f) - 1.0f;
+    BarycentricDerivatives barycentrics = ComputeBarycentricDerivatives(f4Clip0, f4Clip1, f4Clip2, f2PixelNdc, vec2(uiScreenWidth, uiScreenHeight));
+
+    vec2 f2Texcoord0 = FetchSceneTexcoord(uVertex0);
+    vec2 f2Texcoord1 = FetchSceneTexcoord(uVertex1);
+    vec2 f2Texcoord2 = FetchSceneTexcoord(uVertex2);
+    vec2 f2Texcoord = Interpolate(barycentrics.f3Lambda, f2Texcoord0, f2Texcoord1, f2Texcoord2);
+    vec2 f2TexcoordDdx = Interpolate(barycentrics.f3Ddx, f2Texcoord0, f2Texcoord1, f2Texcoord2);
+    vec2 f2TexcoordDdy = Interpolate(barycentrics.f3Ddy, f2Texcoord0, f2Texcoord1, f2Texcoord2);
+
+    vec3 f3VertexNormal = normalize(Interpolate(barycentrics.f3Lambda, FetchSceneNormal(uVertex0), FetchSceneNormal(uVertex1), FetchSceneNormal(uVertex2)));
+    vec3 f3Tangent = Interpolate(barycentrics.f3Lambda, FetchSceneTangent(uVertex0), FetchSceneTangent(uVertex1), FetchSceneTangent(uVertex2));
+    vec3 f3Bitangent = cross(f3VertexNormal, f3Tangent);
+    f3Tangent = (dot(f3Tangent, f3Tangent) > 1e-6) ? normalize(f3Tangent) : vec3(0);
+    f3Bitangent = (dot(f3Bitangent, f3Bitangent) > 1e-6) ? normalize(f3Bitangent) : vec3(0);
+
+    // Same as GetNormalMappedNormal(), but with explicit gradients; there are no helper pixels to take them from.
+    vec3 f3Normal = vec3(0, 0, 1);
+    if (IsValidHandle(drawData.u2NormalHandle))
+    {
+        vec3 f3Sampled = textureGrad(sampler2D(drawData.u2NormalHandle), f2Texcoord, f2TexcoordDdx, f2TexcoordDdy).xyz;
+        f3Normal = (dot(f3Sampled, f3Sampled) > 1e-6) ? UnscaleAndUnbiasNormal(f3Sampled) : f3Normal;
+    }
+    f3Normal = mat3(f3Tangent, f3Bitangent, f3VertexNormal) * f3Normal;
+
+    vec3 f3Colour = vec3(0.0f);
+    if (IsValidHandle(drawData.u2DiffuseHandle))
+        f3Colour = textureGrad(sampler2D(drawData.u2DiffuseHandle), f2Texcoord, f2TexcoordDdx, f2TexcoordDdy).xyz;
+
+    out_f2Normal = StoreFragmentNormal((drawData.m4InvTrans * vec4(f3Normal, 0.0f)).xyz);
+    out_f4Colour = vec4(f3Colour, ufGlowmask);
+}
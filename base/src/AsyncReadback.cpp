@@ -0,0 +1,162 @@
+#include "AsyncReadback.h"
+#include "gl/glew.h"
+
+namespace
+{
+    uint32_t GetBytesPerPixel(GLType_uint format, GLType_uint type)
+    {
+        uint32_t components = 0;
+        switch (format)
+        {
+        case GL_RED:
+        case GL_RED_INTEGER:
+        case GL_DEPTH_COMPONENT:
+        case GL_STENCIL_INDEX:
+            components = 1;
+            break;
+        case GL_RG:
+        case GL_RG_INTEGER:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+            components = 3;
+            break;
+        case GL_RGBA:
+        case GL_BGRA:
+        case GL_RGBA_INTEGER:
+            components = 4;
+            break;
+        default:
+            assert(false); // Unsupported format.
+        }
+
+        switch (type)
+        {
+        case GL_UNSIGNED_BYTE:
+        case GL_BYTE:
+            return components;
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT:
+        case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_UNSIGNED_INT:
+        case GL_INT:
+        case GL_FLOAT:
+            return components * 4;
+        default:
+            assert(false); // Unsupported type; packed types would need their own sizes.
+            return 0;
+        }
+    }
+}
+
+AsyncReadback::AsyncReadback()
+    : m_issuedReads(0),
+    m_resolvedReads(0)
+{
+    for (Slot& slot : m_slots)
+    {
+        slot.buffer = 0;
+        slot.capacity = 0;
+        slot.size = 0;
+        slot.fence = nullptr;
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);    // Rows tightly packed, whatever their width. Nothing else reads pixels back.
+}
+
+AsyncReadback::~AsyncReadback()
+{
+    // Reads still in flight are dropped without calling back.
+    for (Slot& slot : m_slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+AsyncReadback::Slot* AsyncReadback::BeginRead(uint32_t size, const Callback& callback)
+{
+    if ((m_issuedReads - m_resolvedReads) >= c_slotCount)
+        return nullptr;     // The GPU is that far behind; go without the read rather than wait for one.
+
+    Slot& slot = m_slots[m_issuedReads % c_slotCount];
+    if (slot.capacity < size)
+    {
+        // Storage is immutable, so a bigger read gets a new buffer. Client storage, as it's only ever read by the CPU.
+        glDeleteBuffers(1, &slot.buffer);
+        glCreateBuffers(1, &slot.buffer);
+        glNamedBufferStorage(slot.buffer, size, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+        slot.capacity = size;
+    }
+
+    slot.size = size;
+    slot.callback = callback;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    return &slot;
+}
+
+void AsyncReadback::EndRead(Slot& slot)
+{
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++m_issuedReads;
+}
+
+bool AsyncReadback::ReadTexture(GLType_uint texture, int32_t x, int32_t y, uint32_t width, uint32_t height, GLType_uint format, GLType_uint type, const Callback& callback)
+{
+    uint32_t size = width * height * GetBytesPerPixel(format, type);
+    Slot* slot = BeginRead(size, callback);
+    if (slot == nullptr)
+        return false;
+
+    // With a pack buffer bound, the pointer is an offset into it.
+    glGetTextureSubImage(texture, 0, x, y, 0, width, height, 1, format, type, size, nullptr);
+    EndRead(*slot);
+    return true;
+}
+
+bool AsyncReadback::ReadFramebuffer(GLType_uint framebuffer, int32_t x, int32_t y, uint32_t width, uint32_t height, GLType_uint format, GLType_uint type, const Callback& callback)
+{
+    Slot* slot = BeginRead(width * height * GetBytesPerPixel(format, type), callback);
+    if (slot == nullptr)
+        return false;
+
+    // Only the read binding changes; whatever is being drawn to stays bound.
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadPixels(x, y, width, height, format, type, nullptr);
+    EndRead(*slot);
+    return true;
+}
+
+void AsyncReadback::Poll()
+{
+    // Fences pass in submission order, so the first unfinished read ends the search.
+    while (m_resolvedReads != m_issuedReads)
+    {
+        Slot& slot = m_slots[m_resolvedReads % c_slotCount];
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);     // A zero timeout only asks.
+        if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+        {
+            assert(status != GL_WAIT_FAILED);
+            break;
+        }
+
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        const void* data = glMapNamedBufferRange(slot.buffer, 0, slot.size, GL_MAP_READ_BIT);
+        assert(data != nullptr);
+        if (data != nullptr)
+        {
+            slot.callback(data);
+            glUnmapNamedBuffer(slot.buffer);
+        }
+        slot.callback = nullptr;
+
+        // Only now, so a read made from the callback can't be given the slot that was still mapped.
+        ++m_resolvedReads;
+    }
+}
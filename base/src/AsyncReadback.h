@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Common.h"
+#include <functional>
+
+// Copies rectangles of textures or framebuffers back to the CPU without waiting for them. Each read goes into one of a ring of
+// pixel pack buffers with a fence behind it, and its callback runs from Poll() once the fence has passed, usually a frame or two
+// later. Reads resolve in the order they were made, and like PassTimer's queries, a read is refused rather than waited for when
+// the ring is full.
+class AsyncReadback
+{
+public:
+    typedef std::function<void(const void* data)> Callback;    // data is only valid during the call. Rows go bottom up, tightly packed.
+
+private:
+    static const uint32_t c_slotCount = 4;      // Reads that can be in flight at once.
+
+    struct Slot
+    {
+        GLType_uint buffer;
+        uint32_t capacity;      // Bytes the buffer holds; it's only ever replaced by a bigger one.
+        uint32_t size;          // Bytes this read fills.
+        GLType_sync fence;
+        Callback callback;
+    };
+
+    Slot m_slots[c_slotCount];
+    uint32_t m_issuedReads;     // Both count from the first read; the slot used is the count modulo c_slotCount.
+    uint32_t m_resolvedReads;
+
+    Slot* BeginRead(uint32_t size, const Callback& callback);
+    void EndRead(Slot& slot);
+
+public:
+    AsyncReadback();
+    ~AsyncReadback();
+
+    // Both return false, and never call back, if the read was refused. format and type are as for glReadPixels.
+    bool ReadTexture(GLType_uint texture, int32_t x, int32_t y, uint32_t width, uint32_t height, GLType_uint format, GLType_uint type, const Callback& callback);
+    bool ReadFramebuffer(GLType_uint framebuffer, int32_t x, int32_t y, uint32_t width, uint32_t height, GLType_uint format, GLType_uint type, const Callback& callback);   // 0 -> the back buffer.
+
+    void Poll();    // Calls back for every read that has finished.
+};
@@ -40,7 +40,40 @@ namespace RenderEnums
         TESS_CTRL,
         TESS_EVAL,
         GEOM, 
-        FRAG
+        FRAG,
+        COMP
+    };
+
+    enum ProgramStatus
+    {
+        PROGRAM_EMPTY,
+        PROGRAM_PREPROCESSING,  // Sources are being loaded and #includes resolved on a worker thread.
+        PROGRAM_COMPILING,      // Compile and link submitted to the driver.
+        PROGRAM_READY,
+        PROGRAM_FAILED
+    };
+
+    enum ResourceAccess     // How a frame graph pass touches a resource.
+    {
+        ACCESS_SAMPLED,
+        ACCESS_RENDER_TARGET,
+        ACCESS_DEPTH_TARGET,
+        ACCESS_IMAGE_LOAD,
+        ACCESS_IMAGE_STORE,
+        ACCESS_PASS_BOUND_TARGET    // Drawn or copied to through framebuffers the pass binds itself, e.g. single layers of an array.
+    };
+
+    enum MemoryBarrierType  // Flags. Who has to see what a compute dispatch wrote.
+    {
+        BARRIER_NONE = 0,
+        BARRIER_STORAGE_BUFFER = 1 << 0,    // Shader reads and writes of storage buffers.
+        BARRIER_IMAGE_ACCESS = 1 << 1,      // Image loads and stores.
+        BARRIER_TEXTURE_FETCH = 1 << 2,     // Sampling.
+        BARRIER_INDIRECT_COMMAND = 1 << 3,  // Arguments for DispatchIndirect and indirect draws.
+        BARRIER_VERTEX_ATTRIB = 1 << 4,
+        BARRIER_BUFFER_UPDATE = 1 << 5,     // Reading back or mapping buffers.
+        BARRIER_FRAMEBUFFER = 1 << 6,
+        BARRIER_ALL = (1 << 7) - 1
     };
 
     enum DisplayType    //Should match #defines in ShaderCommon.glsl
@@ -50,7 +83,17 @@ namespace RenderEnums
         DISPLAY_POSITION = 2,
         DISPLAY_COLOR = 3,
         DISPLAY_LIGHTING = 4,
-        DISPLAY_TOTAL = 5
+        DISPLAY_TOTAL = 5,
+        DISPLAY_LIGHT_CLUSTERS = 6      // Heat map of how many point lights each cluster holds.
+    };
+
+    enum LightingPath   // How point lights get into the lighting target.
+    {
+        LIGHTING_QUADS,         // One instanced quad per light, blended.
+        LIGHTING_TILED,         // Compute pass that culls lights per screen tile.
+        LIGHTING_CLUSTERED,     // Full-screen pass over the lights the CPU assigned to each view space cluster.
+        LIGHTING_VOLUMES,       // A sphere per light; a stencil pass marks the pixels inside it, and only those are shaded.
+        LIGHTING_SINGLE_PASS    // One full-screen pass loops over every light and writes the whole lighting result, unblended.
     };
 }
 
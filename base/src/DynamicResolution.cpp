@@ -0,0 +1,102 @@
+#include "DynamicResolution.h"
+#include "gl/glew.h"
+#include "glm/glm.hpp"
+
+namespace
+{
+    // Gains on the relative error (target - measured) / target, in scale units. Velocity form: the proportional term acts on the
+    // change in error and the integral term on the error itself, so clamping the scale can't wind the integral up.
+    const float c_proportionalGain = 0.25f;
+    const float c_integralGain = 0.05f;
+    const float c_errorDeadband = 0.05f;    // Within 5% of the target the scale is left alone, so it doesn't hunt around it.
+}
+
+DynamicResolution::DynamicResolution(float minScale, float maxScale)
+    : m_issuedQueries(0),
+    m_resolvedQueries(0),
+    m_queryActive(false),
+    m_targetFrameTime(0.0f),
+    m_minScale(minScale),
+    m_maxScale(maxScale),
+    m_scale(maxScale),
+    m_previousError(0.0f),
+    m_lastFrameTime(0.0f)
+{
+    glCreateQueries(GL_TIME_ELAPSED, c_queryCount, m_queries);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    glDeleteQueries(c_queryCount, m_queries);
+}
+
+void DynamicResolution::BeginFrame()
+{
+    assert(!m_queryActive);
+    if ((m_issuedQueries - m_resolvedQueries) >= c_queryCount)
+        return;     // The GPU is that far behind; go without a measurement this frame rather than wait for one.
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_issuedQueries % c_queryCount]);
+    m_queryActive = true;
+}
+
+void DynamicResolution::EndFrame()
+{
+    if (m_queryActive)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_queryActive = false;
+        ++m_issuedQueries;
+    }
+
+    // Results become available in submission order, so stop at the first one that isn't.
+    while (m_resolvedQueries != m_issuedQueries)
+    {
+        GLType_uint query = m_queries[m_resolvedQueries % c_queryCount];
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+            break;
+
+        GLuint64 elapsedNanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+        ++m_resolvedQueries;
+
+        Update(static_cast<float>(elapsedNanoseconds) * 1e-6f);
+    }
+}
+
+void DynamicResolution::SetTargetFrameTime(float targetFrameTime)
+{
+    m_targetFrameTime = glm::max(targetFrameTime, 0.0f);
+    m_previousError = 0.0f;
+}
+
+void DynamicResolution::SetScaleRange(float minScale, float maxScale)
+{
+    assert(minScale <= maxScale);
+    m_minScale = minScale;
+    m_maxScale = maxScale;
+    m_scale = glm::clamp(m_scale, m_minScale, m_maxScale);
+}
+
+void DynamicResolution::SetScale(float scale)
+{
+    m_scale = glm::clamp(scale, m_minScale, m_maxScale);
+    m_previousError = 0.0f;
+}
+
+void DynamicResolution::Update(float frameTime)
+{
+    m_lastFrameTime = frameTime;
+    if (!IsEnabled())
+        return;
+
+    float error = (m_targetFrameTime - frameTime) / m_targetFrameTime;
+    if (glm::abs(error) < c_errorDeadband)
+        error = 0.0f;
+
+    float adjustment = (c_proportionalGain * (error - m_previousError)) + (c_integralGain * error);
+    m_previousError = error;
+    m_scale = glm::clamp(m_scale + adjustment, m_minScale, m_maxScale);
+}
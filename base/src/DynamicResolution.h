@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Common.h"
+
+// Picks the render resolution scale that keeps GPU frame time near a target. Each frame is bracketed by a GL_TIME_ELAPSED query;
+// results are read back a few frames late, and only once the driver says they're available, so measuring never stalls the CPU.
+// The scale is driven by a PI controller on the relative frame time error and stays within [minScale, maxScale].
+class DynamicResolution
+{
+    static const uint32_t c_queryCount = 4;     // Frames that can be in flight before a measurement is skipped.
+
+    GLType_uint m_queries[c_queryCount];
+    uint32_t m_issuedQueries;       // Both count from the first frame; the query used is the count modulo c_queryCount.
+    uint32_t m_resolvedQueries;
+    bool m_queryActive;
+
+    float m_targetFrameTime;        // Milliseconds. 0 -> controller off; frames are still timed.
+    float m_minScale;
+    float m_maxScale;
+    float m_scale;
+    float m_previousError;
+    float m_lastFrameTime;
+
+    void Update(float frameTime);
+
+public:
+    DynamicResolution(float minScale, float maxScale);
+    ~DynamicResolution();
+
+    void BeginFrame();
+    void EndFrame();    // Also collects every finished measurement and updates the scale.
+
+    void SetTargetFrameTime(float targetFrameTime);
+    void SetScaleRange(float minScale, float maxScale);
+    void SetScale(float scale);     // Where the controller carries on from, e.g. after a manual change.
+
+    bool IsEnabled() const { return m_targetFrameTime > 0.0f; }
+    float GetScale() const { return m_scale; }
+    float GetMinScale() const { return m_minScale; }
+    float GetMaxScale() const { return m_maxScale; }
+    float GetLastFrameTime() const { return m_lastFrameTime; }
+};
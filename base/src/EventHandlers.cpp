@@ -19,6 +19,18 @@ namespace EventHandler
                 assert(false); // The app doesn't exist? HOW!?
             }
         }
+        else if ((pressedButton == GLFW_MOUSE_BUTTON_RIGHT) && (action == GLFW_PRESS))
+        {
+            try
+            {
+                std::shared_ptr<GLApp> thisApp = std::shared_ptr<GLApp>(GLApp::Get());
+                thisApp->PickAtFocusPoint();
+            }
+            catch (std::bad_weak_ptr&)
+            {
+                assert(false); // The app doesn't exist? HOW!?
+            }
+        }
     }
 
     void OnMouseMove(GLFWwindow* windowHandle, double xPos, double yPos)
@@ -37,6 +49,23 @@ namespace EventHandler
                 thisApp->SetLastX(xPos);
                 thisApp->SetLastY(yPos);
             }
+            else
+            {
+                thisApp->SetCursorPosition(xPos, yPos);     // What DOF focuses on and right clicks pick.
+            }
+        }
+        catch (std::bad_weak_ptr&)
+        {
+            assert(false); // The app doesn't exist? HOW!?
+        }
+    }
+
+    void OnFramebufferResize(GLFWwindow* windowHandle, int32_t width, int32_t height)
+    {
+        try
+        {
+            std::shared_ptr<GLApp> thisApp = std::shared_ptr<GLApp>(GLApp::Get());
+            thisApp->reshape(width, height);
         }
         catch (std::bad_weak_ptr&)
         {
@@ -104,6 +133,10 @@ namespace EventHandler
             case GLFW_KEY_KP_5:
                 thisApp->SetDisplayType(RenderEnums::DISPLAY_LIGHTING);
                 break;
+            case GLFW_KEY_6:
+            case GLFW_KEY_KP_6:
+                thisApp->SetDisplayType(RenderEnums::DISPLAY_LIGHT_CLUSTERS);
+                break;
             case GLFW_KEY_0:
             case GLFW_KEY_KP_0:
                 thisApp->SetDisplayType(RenderEnums::DISPLAY_TOTAL);
@@ -111,6 +144,12 @@ namespace EventHandler
             case GLFW_KEY_X:
                 thisApp->ToggleScissor();
                 break;
+            case GLFW_KEY_K:
+                thisApp->ToggleShadows();
+                break;
+            case GLFW_KEY_O:
+                thisApp->ToggleAmbientOcclusion();
+                break;
             case GLFW_KEY_R:
                 thisApp->ReloadShaders();
                 break;
@@ -126,6 +165,24 @@ namespace EventHandler
             case GLFW_KEY_G:
                 thisApp->ToggleDOFDebug();
                 break;
+            case GLFW_KEY_V:
+                thisApp->ToggleVisibilityBuffer();
+                break;
+            case GLFW_KEY_H:
+                thisApp->CycleLightingResolution();
+                break;
+            case GLFW_KEY_L:
+                thisApp->CycleLightingPath();
+                break;
+            case GLFW_KEY_P:
+                thisApp->SaveScreenshot();
+                break;
+            case GLFW_KEY_PAGE_UP:
+                thisApp->AdjustResolutionScale(0.125f);
+                break;
+            case GLFW_KEY_PAGE_DOWN:
+                thisApp->AdjustResolutionScale(-0.125f);
+                break;
             }
 
             absoluteTranslation *= translateRate;
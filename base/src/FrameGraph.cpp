@@ -0,0 +1,432 @@
+#include "FrameGraph.h"
+#include "gl/glew.h"
+
+#include <algorithm>
+
+namespace
+{
+    const uint32_t c_noProducer = UINT32_MAX;
+
+    bool IsDepthStencilFormat(GLType_uint internalFormat)
+    {
+        return (internalFormat == GL_DEPTH24_STENCIL8) || (internalFormat == GL_DEPTH32F_STENCIL8);
+    }
+
+    bool IsAttachmentAccess(RenderEnums::ResourceAccess access)
+    {
+        return (access == RenderEnums::ACCESS_RENDER_TARGET) || (access == RenderEnums::ACCESS_DEPTH_TARGET);
+    }
+}
+
+FrameGraph::FrameGraph(RenderTargetPool& renderTargetPool)
+    : m_renderTargetPool(renderTargetPool),
+    m_backbufferWidth(0),
+    m_backbufferHeight(0),
+    m_viewportScaleX(1.0f),
+    m_viewportScaleY(1.0f),
+    m_compiled(false)
+{}
+
+FrameGraph::~FrameGraph()
+{
+    ReleasePhysicalTextures();
+}
+
+void FrameGraph::Reset()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_resourceNodes.clear();
+    m_presentedNodes.clear();
+    m_compiled = false;
+
+    ReleasePhysicalTextures();
+}
+
+void FrameGraph::ReleasePhysicalTextures()
+{
+    for (const auto& itr : m_physicalTextures)
+        m_renderTargetPool.Release(itr.texture);
+    m_physicalTextures.clear();
+}
+
+FrameGraphResource FrameGraph::CreateResourceNode(uint32_t resourceIndex, uint32_t producer)
+{
+    ResourceNode node;
+    node.resource = resourceIndex;
+    node.version = m_resources[resourceIndex].version;
+    node.producer = producer;
+    node.refCount = 0;
+    m_resourceNodes.push_back(node);
+
+    return static_cast<FrameGraphResource>(m_resourceNodes.size() - 1);
+}
+
+FrameGraphResource FrameGraph::ImportTexture(const std::string& name, GLType_uint texture, const RenderTargetDesc& desc)
+{
+    VirtualResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.texture = texture;
+    resource.imported = true;
+    resource.backbuffer = false;
+    resource.version = 0;
+    resource.firstUse = UINT32_MAX;
+    resource.lastUse = 0;
+    resource.pendingImageWrite = false;
+    resource.issuedBarrierBits = 0;
+    m_resources.push_back(resource);
+
+    return CreateResourceNode(static_cast<uint32_t>(m_resources.size() - 1), c_noProducer);
+}
+
+FrameGraphResource FrameGraph::ImportBackbuffer()
+{
+    FrameGraphResource backbuffer = ImportTexture("Backbuffer", 0, RenderTargetDesc(m_backbufferWidth, m_backbufferHeight));
+    m_resources[m_resourceNodes[backbuffer].resource].backbuffer = true;
+    return backbuffer;
+}
+
+void FrameGraph::AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+    assert(!m_compiled);    // Passes have to be added before the graph is compiled.
+
+    PassNode pass;
+    pass.name = name;
+    pass.execute = execute;
+    pass.refCount = 0;
+    pass.hasSideEffect = false;
+    pass.culled = false;
+    m_passes.push_back(pass);
+
+    PassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+    setup(builder);
+}
+
+void FrameGraph::Present(FrameGraphResource resource)
+{
+    assert(resource < m_resourceNodes.size());
+    m_presentedNodes.push_back(resource);
+}
+
+FrameGraphResource FrameGraph::PassBuilder::CreateTexture(const std::string& name, const RenderTargetDesc& desc)
+{
+    assert((desc.width > 0) && (desc.height > 0) && (desc.internalFormat != 0));
+
+    VirtualResource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.texture = 0;
+    resource.imported = false;
+    resource.backbuffer = false;
+    resource.version = 0;
+    resource.firstUse = UINT32_MAX;
+    resource.lastUse = 0;
+    resource.pendingImageWrite = false;
+    resource.issuedBarrierBits = 0;
+    m_graph.m_resources.push_back(resource);
+
+    return m_graph.CreateResourceNode(static_cast<uint32_t>(m_graph.m_resources.size() - 1), c_noProducer);
+}
+
+FrameGraphResource FrameGraph::PassBuilder::Read(FrameGraphResource resource, RenderEnums::ResourceAccess access)
+{
+    assert(resource < m_graph.m_resourceNodes.size());
+
+    ResourceUse use;
+    use.node = resource;
+    use.access = access;
+    use.attachmentIndex = 0;
+    m_graph.m_passes[m_passIndex].reads.push_back(use);
+
+    return resource;
+}
+
+FrameGraphResource FrameGraph::PassBuilder::Write(FrameGraphResource resource, RenderEnums::ResourceAccess access, uint32_t attachmentIndex)
+{
+    assert(resource < m_graph.m_resourceNodes.size());
+
+    // Every write produces a new version of the resource, so that readers can be traced back to the exact pass that produced what they read.
+    uint32_t resourceIndex = m_graph.m_resourceNodes[resource].resource;
+    ++m_graph.m_resources[resourceIndex].version;
+    FrameGraphResource newVersion = m_graph.CreateResourceNode(resourceIndex, m_passIndex);
+
+    ResourceUse use;
+    use.node = newVersion;
+    use.access = access;
+    use.attachmentIndex = attachmentIndex;
+    m_graph.m_passes[m_passIndex].writes.push_back(use);
+
+    return newVersion;
+}
+
+void FrameGraph::PassBuilder::SetSideEffect()
+{
+    m_graph.m_passes[m_passIndex].hasSideEffect = true;
+}
+
+void FrameGraph::Compile()
+{
+    // Reference counts: passes are referenced by the resource versions they write, resource versions by the passes reading them.
+    for (auto& pass : m_passes)
+    {
+        pass.refCount = static_cast<uint32_t>(pass.writes.size());
+        for (const auto& read : pass.reads)
+            ++m_resourceNodes[read.node].refCount;
+    }
+    for (const auto& presented : m_presentedNodes)
+        ++m_resourceNodes[presented].refCount;
+
+    // Cull: walk back from every unreferenced resource version to its producer, and from culled passes to what they read.
+    std::vector<FrameGraphResource> unreferencedNodes;
+    for (uint32_t i = 0; i < m_resourceNodes.size(); ++i)
+    {
+        if ((m_resourceNodes[i].refCount == 0) && (m_resourceNodes[i].producer != c_noProducer))
+            unreferencedNodes.push_back(i);
+    }
+
+    auto cullPass = [this, &unreferencedNodes](PassNode& pass)
+    {
+        pass.culled = true;
+        for (const auto& read : pass.reads)
+        {
+            ResourceNode& readNode = m_resourceNodes[read.node];
+            if ((--readNode.refCount == 0) && (readNode.producer != c_noProducer))
+                unreferencedNodes.push_back(read.node);
+        }
+    };
+
+    for (auto& pass : m_passes)
+    {
+        if ((pass.refCount == 0) && !pass.hasSideEffect)
+            cullPass(pass);
+    }
+
+    while (!unreferencedNodes.empty())
+    {
+        ResourceNode& node = m_resourceNodes[unreferencedNodes.back()];
+        unreferencedNodes.pop_back();
+
+        PassNode& producer = m_passes[node.producer];
+        if (producer.culled || producer.hasSideEffect)
+            continue;
+
+        if (--producer.refCount == 0)
+            cullPass(producer);
+    }
+
+    // Lifetimes over the surviving passes.
+    for (uint32_t i = 0; i < m_passes.size(); ++i)
+    {
+        if (m_passes[i].culled)
+            continue;
+
+        auto extendLifetime = [this, i](const ResourceUse& use)
+        {
+            VirtualResource& resource = m_resources[m_resourceNodes[use.node].resource];
+            resource.firstUse = std::min(resource.firstUse, i);
+            resource.lastUse = std::max(resource.lastUse, i);
+        };
+        std::for_each(m_passes[i].reads.begin(), m_passes[i].reads.end(), extendLifetime);
+        std::for_each(m_passes[i].writes.begin(), m_passes[i].writes.end(), extendLifetime);
+    }
+
+    AllocateTransientTextures();
+    m_compiled = true;
+}
+
+void FrameGraph::AllocateTransientTextures()
+{
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < m_resources.size(); ++i)
+    {
+        if (!m_resources[i].imported && (m_resources[i].firstUse != UINT32_MAX))
+            transients.push_back(i);
+    }
+
+    // Hand out textures in order of first use so that a texture freed by an earlier pass can be picked up by a later one.
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].firstUse < m_resources[b].firstUse; });
+    for (uint32_t i : transients)
+    {
+        VirtualResource& resource = m_resources[i];
+        resource.texture = AcquirePhysicalTexture(resource.desc, resource.firstUse, resource.lastUse);
+    }
+}
+
+GLType_uint FrameGraph::AcquirePhysicalTexture(const RenderTargetDesc& desc, uint32_t firstUse, uint32_t lastUse)
+{
+    for (auto& physicalTexture : m_physicalTextures)
+    {
+        if ((physicalTexture.desc == desc) && (physicalTexture.availableFromPass <= firstUse))
+        {
+            physicalTexture.availableFromPass = lastUse + 1;
+            return physicalTexture.texture;
+        }
+    }
+
+    PhysicalTexture newTexture;
+    newTexture.desc = desc;
+    newTexture.texture = m_renderTargetPool.Acquire(desc);
+    newTexture.availableFromPass = lastUse + 1;
+    m_physicalTextures.push_back(newTexture);
+
+    return newTexture.texture;
+}
+
+GLType_uint FrameGraph::GetFramebuffer(const PassNode& pass)
+{
+    std::vector<std::pair<GLType_uint, GLType_uint>> attachments;   // First -> attachment point; second -> texture.
+    auto addAttachment = [this, &attachments](const ResourceUse& use)
+    {
+        if (!IsAttachmentAccess(use.access))
+            return;
+
+        const VirtualResource& resource = m_resources[m_resourceNodes[use.node].resource];
+        GLType_uint attachmentPoint = GL_COLOR_ATTACHMENT0 + use.attachmentIndex;
+        if (use.access == RenderEnums::ACCESS_DEPTH_TARGET)
+            attachmentPoint = IsDepthStencilFormat(resource.desc.internalFormat) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+
+        for (const auto& itr : attachments)
+        {
+            if (itr.first == attachmentPoint)
+            {
+                assert(itr.second == resource.texture);  // Two different resources bound to the same attachment point.
+                return;
+            }
+        }
+        attachments.push_back(std::make_pair(attachmentPoint, resource.texture));
+    };
+    std::for_each(pass.reads.begin(), pass.reads.end(), addAttachment);
+    std::for_each(pass.writes.begin(), pass.writes.end(), addAttachment);
+    std::sort(attachments.begin(), attachments.end());
+
+    return m_renderTargetPool.GetFramebuffer(attachments);
+}
+
+void FrameGraph::BindRenderTargets(const PassNode& pass)
+{
+    const VirtualResource* firstAttachment = nullptr;
+    auto findAttachment = [this, &firstAttachment](const ResourceUse& use)
+    {
+        if ((firstAttachment == nullptr) && IsAttachmentAccess(use.access))
+            firstAttachment = &m_resources[m_resourceNodes[use.node].resource];
+    };
+    std::for_each(pass.writes.begin(), pass.writes.end(), findAttachment);
+    std::for_each(pass.reads.begin(), pass.reads.end(), findAttachment);
+
+    if (firstAttachment == nullptr)
+        return; // Compute/transfer pass; leave the framebuffer binding alone.
+
+    if (firstAttachment->backbuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, m_backbufferWidth, m_backbufferHeight);
+    }
+    else if (firstAttachment->imported)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(pass));
+        glViewport(0, 0, firstAttachment->desc.width, firstAttachment->desc.height);
+    }
+    else
+    {
+        // Transients are sized for the largest render resolution; this frame only covers the lower left part of them.
+        glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(pass));
+        glViewport(0, 0, GetScaledExtent(firstAttachment->desc.width, m_viewportScaleX), GetScaledExtent(firstAttachment->desc.height, m_viewportScaleY));
+    }
+}
+
+GLType_uint FrameGraph::GetScaledExtent(uint32_t extent, float scale)
+{
+    // Must round the same way as GetRenderAreaSize() in ShaderCommon.glsl.
+    GLType_uint scaledExtent = static_cast<GLType_uint>((extent * scale) + 0.5f);
+    return (scaledExtent > 0) ? scaledExtent : 1;
+}
+
+GLType_uint FrameGraph::GetBarrierBitsForPass(const PassNode& pass)
+{
+    // Only incoherent (image store) writes need a barrier; render target writes are synchronized by GL itself. A barrier only
+    // covers the kinds of access it names, so every pass up to the next store that touches the resource in a new way needs one.
+    GLType_uint barrierBits = 0;
+    auto addBarrier = [this, &barrierBits](const ResourceUse& use)
+    {
+        VirtualResource& resource = m_resources[m_resourceNodes[use.node].resource];
+        if (!resource.pendingImageWrite)
+            return;
+
+        GLType_uint accessBits = 0;
+        switch (use.access)
+        {
+        case RenderEnums::ACCESS_SAMPLED:
+            accessBits = GL_TEXTURE_FETCH_BARRIER_BIT;
+            break;
+        case RenderEnums::ACCESS_IMAGE_LOAD:
+        case RenderEnums::ACCESS_IMAGE_STORE:
+            accessBits = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+            break;
+        case RenderEnums::ACCESS_RENDER_TARGET:
+        case RenderEnums::ACCESS_DEPTH_TARGET:
+            accessBits = GL_FRAMEBUFFER_BARRIER_BIT;
+            break;
+        case RenderEnums::ACCESS_PASS_BOUND_TARGET:
+            accessBits = GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT;
+            break;
+        }
+        barrierBits |= accessBits & ~resource.issuedBarrierBits;
+        resource.issuedBarrierBits |= accessBits;
+    };
+    std::for_each(pass.reads.begin(), pass.reads.end(), addBarrier);
+    std::for_each(pass.writes.begin(), pass.writes.end(), addBarrier);
+
+    return barrierBits;
+}
+
+void FrameGraph::Execute()
+{
+    assert(m_compiled);
+
+    for (auto& pass : m_passes)
+    {
+        if (pass.culled)
+            continue;
+
+        GLType_uint barrierBits = GetBarrierBitsForPass(pass);
+        if (barrierBits != 0)
+            glMemoryBarrier(barrierBits);
+
+        BindRenderTargets(pass);
+        pass.execute(*this);
+
+        for (const auto& write : pass.writes)
+        {
+            if (write.access == RenderEnums::ACCESS_IMAGE_STORE)
+            {
+                VirtualResource& resource = m_resources[m_resourceNodes[write.node].resource];
+                resource.pendingImageWrite = true;
+                resource.issuedBarrierBits = 0;
+            }
+        }
+    }
+}
+
+GLType_uint FrameGraph::GetTexture(FrameGraphResource resource) const
+{
+    assert(m_compiled && (resource < m_resourceNodes.size()));
+    return m_resources[m_resourceNodes[resource].resource].texture;
+}
+
+const RenderTargetDesc& FrameGraph::GetDesc(FrameGraphResource resource) const
+{
+    assert(resource < m_resourceNodes.size());
+    return m_resources[m_resourceNodes[resource].resource].desc;
+}
+
+bool FrameGraph::IsPassCulled(const std::string& name) const
+{
+    for (const auto& pass : m_passes)
+    {
+        if (pass.name == name)
+            return pass.culled;
+    }
+
+    return true;
+}
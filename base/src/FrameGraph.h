@@ -0,0 +1,131 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "RenderTargetPool.h"
+
+typedef uint32_t FrameGraphResource;    // Handle to a version of a virtual resource. Only valid for the frame it was declared in.
+
+// Passes declare the resources they read and write during setup. Compile() then culls passes whose outputs are never consumed,
+// works out the lifetime of every transient resource and aliases transients with identical descriptions onto the same pooled
+// texture whenever their lifetimes don't overlap. Execute() runs the surviving passes in declaration order, binding a framebuffer made
+// from each pass' render target writes and issuing glMemoryBarrier only when a resource written through image stores is used again.
+class FrameGraph
+{
+public:
+    static const FrameGraphResource c_invalidResource = UINT32_MAX;
+
+    class PassBuilder
+    {
+        FrameGraph& m_graph;
+        uint32_t m_passIndex;
+
+        PassBuilder(FrameGraph& graph, uint32_t passIndex) : m_graph(graph), m_passIndex(passIndex) {}
+        PassBuilder& operator=(const PassBuilder&);
+
+    public:
+        FrameGraphResource CreateTexture(const std::string& name, const RenderTargetDesc& desc);
+        FrameGraphResource Read(FrameGraphResource resource, RenderEnums::ResourceAccess access = RenderEnums::ACCESS_SAMPLED);
+        FrameGraphResource Write(FrameGraphResource resource, RenderEnums::ResourceAccess access = RenderEnums::ACCESS_RENDER_TARGET, uint32_t attachmentIndex = 0);
+        void SetSideEffect();   // Never cull this pass, e.g. it writes to something outside of the graph.
+
+        friend class FrameGraph;
+    };
+
+    typedef std::function<void(PassBuilder&)> SetupFunction;
+    typedef std::function<void(const FrameGraph&)> ExecuteFunction;
+
+private:
+    struct ResourceUse
+    {
+        FrameGraphResource node;
+        RenderEnums::ResourceAccess access;
+        uint32_t attachmentIndex;
+    };
+
+    struct PassNode
+    {
+        std::string name;
+        std::vector<ResourceUse> reads;
+        std::vector<ResourceUse> writes;
+        ExecuteFunction execute;
+        uint32_t refCount;
+        bool hasSideEffect;
+        bool culled;
+    };
+
+    struct VirtualResource
+    {
+        std::string name;
+        RenderTargetDesc desc;
+        GLType_uint texture;
+        bool imported;
+        bool backbuffer;
+        uint32_t version;
+        uint32_t firstUse;      // Index of the first non-culled pass that touches this resource.
+        uint32_t lastUse;
+        bool pendingImageWrite;
+        GLType_uint issuedBarrierBits;  // Issued since the last image store. Each kind of access needs its own bit.
+    };
+
+    struct ResourceNode
+    {
+        uint32_t resource;
+        uint32_t version;
+        uint32_t producer;
+        uint32_t refCount;
+    };
+
+    struct PhysicalTexture
+    {
+        RenderTargetDesc desc;
+        GLType_uint texture;
+        uint32_t availableFromPass;     // Aliasing: this texture can be handed out again to a resource whose lifetime starts at or after this pass.
+    };
+
+    std::vector<PassNode> m_passes;
+    std::vector<VirtualResource> m_resources;
+    std::vector<ResourceNode> m_resourceNodes;
+    std::vector<FrameGraphResource> m_presentedNodes;
+
+    std::vector<PhysicalTexture> m_physicalTextures;    // Leased from the pool for this frame only; handed back on Reset().
+    RenderTargetPool& m_renderTargetPool;
+
+    uint32_t m_backbufferWidth;
+    uint32_t m_backbufferHeight;
+    float m_viewportScaleX;     // Fraction of each transient render target that passes draw into.
+    float m_viewportScaleY;
+    bool m_compiled;
+
+    FrameGraphResource CreateResourceNode(uint32_t resourceIndex, uint32_t producer);
+    void AllocateTransientTextures();
+    GLType_uint AcquirePhysicalTexture(const RenderTargetDesc& desc, uint32_t firstUse, uint32_t lastUse);
+    void ReleasePhysicalTextures();
+    GLType_uint GetFramebuffer(const PassNode& pass);
+    GLType_uint GetBarrierBitsForPass(const PassNode& pass);
+    static GLType_uint GetScaledExtent(uint32_t extent, float scale);
+    void BindRenderTargets(const PassNode& pass);
+
+public:
+    FrameGraph(RenderTargetPool& renderTargetPool);
+    ~FrameGraph();
+
+    void Reset();   // Forget last frame's passes and virtual resources, and hand their textures back to the pool.
+    void SetBackbufferSize(uint32_t width, uint32_t height) { m_backbufferWidth = width; m_backbufferHeight = height; }
+    void SetViewportScale(float scaleX, float scaleY) { m_viewportScaleX = scaleX; m_viewportScaleY = scaleY; }   // Dynamic resolution; leaves descriptions, and so the pool, untouched.
+
+    FrameGraphResource ImportTexture(const std::string& name, GLType_uint texture, const RenderTargetDesc& desc = RenderTargetDesc());
+    FrameGraphResource ImportBackbuffer();
+    void AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+    void Present(FrameGraphResource resource);  // Marks a resource version as a frame output. Everything that doesn't contribute to an output is culled.
+
+    void Compile();
+    void Execute();
+
+    GLType_uint GetTexture(FrameGraphResource resource) const;
+    const RenderTargetDesc& GetDesc(FrameGraphResource resource) const;
+    bool IsPassCulled(const std::string& name) const;
+};
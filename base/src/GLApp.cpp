@@ -4,6 +4,10 @@
 #include "EventHandlers.h"
 #include "TextureManager.h"
 #include "VertexSpecification.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
 #include <sstream>
 
 #include "gl/glew.h"
@@ -14,12 +18,22 @@
 #include "tiny_obj_loader.h"
 #undef TINYOBJLOADER_IMPLEMENTATION
 
+extern "C"
+{
+    #include "SOIL/SOIL.h"
+}
+
 using glm::vec4;
 using glm::vec3;
 using glm::vec2;
 using glm::mat4;
 
 const std::string GLApp::c_meshArgumentString = "mesh";
+const std::string GLApp::c_frameTimeArgumentString = "frametime";
+const std::string GLApp::c_minScaleArgumentString = "minscale";
+const std::string GLApp::c_lightsArgumentString = "lights";
+const std::string GLApp::c_passLightsArgumentString = "passlights";
+const std::string GLApp::c_aoBudgetArgumentString = "aobudget";
 
 namespace
 {
@@ -94,10 +108,16 @@ GLApp::GLApp(uint32_t width, uint32_t height, std::string windowTitle)
     m_toonEnabled(false),
     m_DOFEnabled(false),
     m_DOFDebug(false),
+    m_visibilityBufferEnabled(false),
+    m_lightingResolutionDivisor(1),
+    m_lightingPath(RenderEnums::LIGHTING_QUADS),
     m_scissorEnabled(true),
+    m_shadowsEnabled(true),
+    m_ambientOcclusionEnabled(true),
     m_mouseCaptured(true),
     mouse_dof_x(0),
     mouse_dof_y(0),
+    m_screenshotCount(0),
     m_glfwWindow(nullptr),
     m_windowTitle(windowTitle) 
 {
@@ -195,6 +215,7 @@ bool GLApp::ProcessScene(const std::string& sceneFile)
     }
 
     float maxExtent = -1e6, minExtent = 1e6;
+    vec3 boundsMin(1e6), boundsMax(-1e6);
     for (auto it = sceneObjects.begin(); it != sceneObjects.end(); ++it)
     {
         tinyobj::shape_t shape = *it;
@@ -268,6 +289,8 @@ bool GLApp::ProcessScene(const std::string& sceneFile)
             }
 
             model.vertices.push_back(v);
+            boundsMin = glm::min(boundsMin, v.position);
+            boundsMax = glm::max(boundsMax, v.position);
 
             float toCompareGreater = (v.position.x > v.position.y) ? ((v.position.x > v.position.z) ? v.position.x : v.position.z) : ((v.position.y > v.position.z) ? v.position.y : v.position.z);
             float toCompareLesser = (v.position.x < v.position.y) ? ((v.position.x < v.position.z) ? v.position.x : v.position.z) : ((v.position.y < v.position.z) ? v.position.y : v.position.z);
@@ -313,22 +336,123 @@ bool GLApp::ProcessScene(const std::string& sceneFile)
     glm::mat4 sceneAdaptiveScaleInverse = glm::scale(glm::mat4(), glm::vec3(scale));
     scale = 1.0f / scale;
     glm::mat4 sceneAdaptiveScale = glm::scale(glm::mat4(), glm::vec3(scale));
+    m_sceneBoundsMin = boundsMin * scale;
+    m_sceneBoundsMax = boundsMax * scale;
     for (std::unique_ptr<DrawableGeometry>& i : m_drawableModels)
     {
         i->modelMat *= sceneAdaptiveScale;
         i->inverseModelMat = sceneAdaptiveScaleInverse * i->inverseModelMat;
     }
+    m_spRenderer->SetShadowSceneBounds(m_sceneBoundsMin, m_sceneBoundsMax);
 
     Utility::LogMessageAndEndLine("Scene loading complete.");
     return true;
 }
 
+bool GLApp::ProcessLights(const std::map<std::string, std::string>& argumentList)
+{
+    LightStore& lightStore = m_spRenderer->GetLightStore();
+    lightStore.Clear();
+
+    auto mapItr = argumentList.find(c_lightsArgumentString);
+    if (mapItr == argumentList.end())
+    {
+        // The scene's original lights. Radius doubles as intensity.
+        const vec3 yellow(1, 1, 0), orange(0.89, 0.44, 0.1), red(1, 0, 0), blue(0, 0, 1);
+        lightStore.AddLight(vec3(5.4, -0.5, 3.0), 1.0f, yellow, 1.0f);
+        lightStore.AddLight(vec3(0.2, -0.5, 3.0), 1.0f, yellow, 1.0f);
+        lightStore.AddLight(vec3(5.4, -2.5, 3.0), 1.0f, orange, 1.0f);
+        lightStore.AddLight(vec3(0.2, -2.5, 3.0), 1.0f, orange, 1.0f);
+        lightStore.AddLight(vec3(5.4, -4.5, 3.0), 1.0f, yellow, 1.0f);
+        lightStore.AddLight(vec3(0.2, -4.5, 3.0), 1.0f, yellow, 1.0f);
+        lightStore.AddLight(vec3(2.5, -1.2, 0.5), 2.5f, red, 2.5f);
+        lightStore.AddLight(vec3(2.5, -5.0, 4.2), 2.5f, blue, 2.5f);
+        return true;
+    }
+
+    const std::string& lights = mapItr->second;
+    if (!lights.empty() && (lights.find_first_not_of("0123456789") == std::string::npos))
+        GenerateLights(static_cast<uint32_t>(std::strtoul(lights.c_str(), nullptr, 10)));
+    else if (!LoadLights(lights))
+        return false;
+
+    std::ostringstream debugOutput;
+    debugOutput << lightStore.GetCount() << " point lights.";
+    Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+    return true;
+}
+
+bool GLApp::LoadLights(const std::string& lightsFile)
+{
+    std::ifstream lightsStream(lightsFile);
+    if (!lightsStream)
+    {
+        Utility::LogMessage("Couldn't open lights file: ");
+        Utility::LogMessageAndEndLine(lightsFile.c_str());
+        return false;
+    }
+
+    // One light per line: x y z radius r g b intensity, in scene units after scene adaptive scaling. # starts a comment.
+    LightStore& lightStore = m_spRenderer->GetLightStore();
+    std::string line;
+    while (std::getline(lightsStream, line))
+    {
+        line = line.substr(0, line.find_first_of('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        vec3 position, colour;
+        float radius = 0.0f, intensity = 0.0f;
+        std::istringstream lineStream(line);
+        if (!(lineStream >> position.x >> position.y >> position.z >> radius >> colour.r >> colour.g >> colour.b >> intensity) || (radius <= 0.0f))
+        {
+            Utility::LogMessage("Skipping malformed light: ");
+            Utility::LogMessageAndEndLine(line.c_str());
+            continue;
+        }
+
+        lightStore.AddLight(position, radius, colour, intensity);
+    }
+
+    return true;
+}
+
+void GLApp::GenerateLights(uint32_t count)
+{
+    // Scattered through the scene's bounds. Seeded, so runs are comparable.
+    std::mt19937 generator(6);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    vec3 extent = m_sceneBoundsMax - m_sceneBoundsMin;
+    float largestExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+
+    LightStore& lightStore = m_spRenderer->GetLightStore();
+    lightStore.Reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        vec3 position = m_sceneBoundsMin + (extent * vec3(unit(generator), unit(generator), unit(generator)));
+        float radius = largestExtent * glm::mix(0.02f, 0.06f, unit(generator));
+        vec3 colour = glm::mix(vec3(0.2f), vec3(1.0f), vec3(unit(generator), unit(generator), unit(generator)));
+        lightStore.AddLight(position, radius, colour, 1.0f);
+    }
+}
+
 void GLApp::display()
 {
     m_spViewCamera->CalculateViewProjection(45.0f, m_width, m_height, RENDERER->GetNearPlaneDistance(), RENDERER->GetFarPlaneDistance());
 
     m_spRenderer->ClearLists();
     m_spRenderer->SetDisplayType(m_displayType);
+    m_spRenderer->SetToonEnabled(m_toonEnabled);
+    m_spRenderer->SetDOFEnabled(m_DOFEnabled);
+    m_spRenderer->SetDOFDebug(m_DOFDebug);
+    m_spRenderer->SetFocusPoint(GetFocusPoint());
+    m_spRenderer->SetBloomEnabled(m_bloomEnabled);
+    m_spRenderer->SetVisibilityBufferEnabled(m_visibilityBufferEnabled);
+    m_spRenderer->SetLightingResolutionDivisor(m_lightingResolutionDivisor);
+    m_spRenderer->SetLightingPath(m_lightingPath);
+    m_spRenderer->SetScissorEnabled(m_scissorEnabled);
+    m_spRenderer->SetShadowsEnabled(m_shadowsEnabled);
+    m_spRenderer->SetAmbientOcclusionEnabled(m_ambientOcclusionEnabled);
     for (uint32_t i = 0; i < m_drawableModels.size(); ++i)
     {
         m_spRenderer->AddDrawableGeometryToList(m_drawableModels[i].get(), RenderEnums::OPAQUE_LIST);
@@ -337,28 +461,31 @@ void GLApp::display()
     m_spRenderer->Render();
 }
 
-void GLApp::reshape(int w, int h)
+void GLApp::reshape(int32_t width, int32_t height)
 {
-    m_width = w;
-    m_height = h;
-    //glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    //glViewport(0, 0, (GLsizei)w, (GLsizei)h);
-
-    //if (m_depthTexture)
-    //    glDeleteTextures(1, &m_depthTexture);
-    //if (m_normalTexture)
-    //    glDeleteTextures(1, &m_normalTexture);
-    //if (m_positionTexture)
-    //    glDeleteTextures(1, &m_positionTexture);
-    //if (m_colorTexture)
-    //    glDeleteTextures(1, &m_colorTexture);
-    //if (m_postTexture)
-    //    glDeleteTextures(1, &m_postTexture);
-
-    //for (GLuint& fbo : m_FBO)
-    //    glDeleteFramebuffers(1, &fbo);
-
-    //initFBO();
+    if ((width <= 0) || (height <= 0))
+        return; // Minimized.
+
+    m_width = width;
+    m_height = height;
+    m_invHeight = 1.0f / (m_height - 1);
+    m_invWidth = 1.0f / (m_width - 1);
+
+    if (m_spRenderer)
+        m_spRenderer->Resize(m_width, m_height);
+}
+
+void GLApp::AdjustResolutionScale(float adjustment)
+{
+    if (!m_spRenderer)
+        return;
+
+    if (m_spRenderer->IsDynamicResolutionEnabled())
+    {
+        m_spRenderer->SetTargetFrameTime(0.0f);
+        Utility::LogMessageAndEndLine("Dynamic resolution off; resolution scale is manual now.");
+    }
+    m_spRenderer->SetResolutionScale(m_spRenderer->GetResolutionScale() + adjustment);
 }
 
 void GLApp::AdjustCamera(float xAdjustment, float yAdjustment, float zAdjustment)
@@ -373,9 +500,124 @@ void GLApp::RotateCamera(float xAngle, float yAngle)
         m_spViewCamera->adjust(xAngle, yAngle, 0.0f, 0.0f, 0.0f, 0.0f);
 }
 
+void GLApp::ToggleVisibilityBuffer()
+{
+    if (m_spRenderer && !m_spRenderer->IsVisibilityBufferSupported())
+    {
+        Utility::LogMessageAndEndLine("Visibility buffer needs GL_ARB_bindless_texture; staying on the G-buffer path.");
+        return;
+    }
+
+    m_visibilityBufferEnabled = !m_visibilityBufferEnabled;
+    Utility::LogMessageAndEndLine(m_visibilityBufferEnabled ? "Visibility buffer on." : "Visibility buffer off.");
+}
+
+void GLApp::CycleLightingResolution()
+{
+    // Full -> half -> quarter -> full.
+    m_lightingResolutionDivisor = (m_lightingResolutionDivisor >= 4) ? 1 : (m_lightingResolutionDivisor * 2);
+
+    std::ostringstream debugOutput;
+    debugOutput << "Point lights at 1/" << m_lightingResolutionDivisor << " resolution.";
+    Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+}
+
+void GLApp::CycleLightingPath()
+{
+    // Quads -> tiled -> clustered -> volumes -> single pass -> quads.
+    switch (m_lightingPath)
+    {
+    case RenderEnums::LIGHTING_QUADS:
+        m_lightingPath = RenderEnums::LIGHTING_TILED;
+        Utility::LogMessageAndEndLine("Point lights: tiled compute.");
+        break;
+    case RenderEnums::LIGHTING_TILED:
+        m_lightingPath = RenderEnums::LIGHTING_CLUSTERED;
+        Utility::LogMessageAndEndLine("Point lights: clustered.");
+        break;
+    case RenderEnums::LIGHTING_CLUSTERED:
+        m_lightingPath = RenderEnums::LIGHTING_VOLUMES;
+        Utility::LogMessageAndEndLine("Point lights: stencil-masked volumes.");
+        break;
+    case RenderEnums::LIGHTING_VOLUMES:
+        m_lightingPath = RenderEnums::LIGHTING_SINGLE_PASS;
+        Utility::LogMessageAndEndLine("Point lights: single pass.");
+        break;
+    default:
+        m_lightingPath = RenderEnums::LIGHTING_QUADS;
+        Utility::LogMessageAndEndLine("Point lights: one quad each.");
+        break;
+    }
+}
+
 void GLApp::ReloadShaders()
 {
-//    m_spRenderer->InitShaders();
+    if (m_spRenderer)
+        m_spRenderer->ReloadShaders();
+}
+
+glm::vec2 GLApp::GetFocusPoint()
+{
+    if (m_mouseCaptured)
+        return vec2(0.5f);
+
+    // Cursor positions are in window coordinates, which needn't match the framebuffer's pixels, and go top down.
+    int32_t windowWidth = 0, windowHeight = 0;
+    glfwGetWindowSize(m_glfwWindow, &windowWidth, &windowHeight);
+    if ((windowWidth <= 0) || (windowHeight <= 0))
+        return vec2(0.5f);
+
+    return vec2((mouse_dof_x + 0.5f) / windowWidth, 1.0f - ((mouse_dof_y + 0.5f) / windowHeight));
+}
+
+void GLApp::PickAtFocusPoint()
+{
+    if (!m_spRenderer)
+        return;
+
+    m_spRenderer->Pick(GetFocusPoint(), [](bool hit, const vec3& worldPosition)
+    {
+        std::ostringstream debugOutput;
+        if (hit)
+            debugOutput << "Picked (" << worldPosition.x << ", " << worldPosition.y << ", " << worldPosition.z << ").";
+        else
+            debugOutput << "Picked nothing.";
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+    });
+}
+
+void GLApp::SaveScreenshot()
+{
+    if (!m_spRenderer)
+        return;
+
+    std::ostringstream fileName;
+    fileName << "screenshot" << m_screenshotCount++ << ".bmp";
+    std::string screenshotFile = fileName.str();
+    m_spRenderer->CaptureBackbuffer([screenshotFile](uint32_t width, uint32_t height, const uint8_t* pixels)
+    {
+        // The capture is bottom up; SOIL writes top down.
+        uint32_t rowSize = width * 4;
+        std::vector<uint8_t> flipped;
+        try
+        {
+            flipped.resize(rowSize * height);
+        }
+        catch (std::bad_alloc&)
+        {
+            assert(false); // Out of memory.
+            return;
+        }
+        for (uint32_t row = 0; row < height; ++row)
+            std::memcpy(&flipped[row * rowSize], pixels + ((height - 1 - row) * rowSize), rowSize);
+
+        std::ostringstream debugOutput;
+        if (SOIL_save_image(screenshotFile.c_str(), SOIL_SAVE_TYPE_BMP, width, height, 4, flipped.data()))
+            debugOutput << "Saved " << screenshotFile << ".";
+        else
+            debugOutput << "Couldn't save " << screenshotFile << ".";
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+    });
 }
 
 bool GLApp::Initialize(const std::map<std::string, std::string>& argumentList)
@@ -406,6 +648,7 @@ bool GLApp::Initialize(const std::map<std::string, std::string>& argumentList)
     glfwSetKeyCallback(m_glfwWindow, EventHandler::OnKeyPress);
     glfwSetMouseButtonCallback(m_glfwWindow, EventHandler::OnMouseClick);
     glfwSetCursorPosCallback(m_glfwWindow, EventHandler::OnMouseMove);
+    glfwSetFramebufferSizeCallback(m_glfwWindow, EventHandler::OnFramebufferResize);
 
     GLenum err = glewInit();
     if (GLEW_OK != err)
@@ -432,7 +675,29 @@ bool GLApp::Initialize(const std::map<std::string, std::string>& argumentList)
 
     m_spRenderer->Initialize(m_spViewCamera);
 
-    return ProcessScene(argumentList.at(c_meshArgumentString));
+    auto mapItr = argumentList.find(c_frameTimeArgumentString);
+    if (mapItr != argumentList.end())
+    {
+        // e.g. frametime=16.6 minscale=0.5: hold 16.6 ms of GPU time per frame by rendering at 50% to 100% of the window size.
+        auto minScaleItr = argumentList.find(c_minScaleArgumentString);
+        float minScale = (minScaleItr != argumentList.end()) ? static_cast<float>(std::atof(minScaleItr->second.c_str())) : 0.5f;
+        m_spRenderer->SetDynamicResolutionRange(minScale, 1.0f);
+        m_spRenderer->SetTargetFrameTime(static_cast<float>(std::atof(mapItr->second.c_str())));
+
+        std::ostringstream debugOutput;
+        debugOutput << "Dynamic resolution targeting " << mapItr->second << " ms of GPU time per frame.";
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+    }
+
+    mapItr = argumentList.find(c_passLightsArgumentString);
+    if (mapItr != argumentList.end())
+        m_spRenderer->SetSinglePassLightLimit(static_cast<uint32_t>(std::strtoul(mapItr->second.c_str(), nullptr, 10)));
+
+    mapItr = argumentList.find(c_aoBudgetArgumentString);
+    if (mapItr != argumentList.end())
+        m_spRenderer->SetAmbientOcclusionBudget(static_cast<float>(std::atof(mapItr->second.c_str())));
+
+    return ProcessScene(argumentList.at(c_meshArgumentString)) && ProcessLights(argumentList);
 }
 
 int32_t GLApp::Run()
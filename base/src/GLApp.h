@@ -21,15 +21,23 @@ class GLApp
     bool m_toonEnabled;
     bool m_DOFEnabled;
     bool m_DOFDebug;
+    bool m_visibilityBufferEnabled;
+    uint32_t m_lightingResolutionDivisor;
+    RenderEnums::LightingPath m_lightingPath;
     bool m_scissorEnabled;
+    bool m_shadowsEnabled;
+    bool m_ambientOcclusionEnabled;
     bool m_mouseCaptured;
 
     double m_lastX;
     double m_lastY;
-    int32_t mouse_dof_x;
+    int32_t mouse_dof_x;    // Cursor position in the window while it isn't captured.
     int32_t mouse_dof_y;
+    uint32_t m_screenshotCount;
 
     glm::mat4 m_world;
+    glm::vec3 m_sceneBoundsMin;     // After scene adaptive scaling.
+    glm::vec3 m_sceneBoundsMax;
     std::shared_ptr<Camera> m_spViewCamera;
 
     std::unique_ptr<GLRenderer> m_spRenderer;
@@ -46,8 +54,15 @@ class GLApp
     // Also uploads data to GPU.
     bool ProcessScene(const std::string& sceneFile);
 
+    // Fills the renderer's light store: from the lights= argument (a file, or a number of lights to scatter through the scene),
+    // or with the default lights when there's none.
+    bool ProcessLights(const std::map<std::string, std::string>& argumentList);
+    bool LoadLights(const std::string& lightsFile);
+    void GenerateLights(uint32_t count);
+
+    glm::vec2 GetFocusPoint();     // Under the cursor, or the middle of the window while it's captured. As GLRenderer::SetFocusPoint.
+
     void display();
-    void reshape(int, int);
 
     GLApp(uint32_t width, uint32_t height, std::string windowTitle);
 public:
@@ -65,10 +80,13 @@ public:
     int32_t GetWidth() { return m_width; }
 
     bool IsScissorEnabled() { return m_scissorEnabled; }
+    bool IsShadowsEnabled() { return m_shadowsEnabled; }
+    bool IsAmbientOcclusionEnabled() { return m_ambientOcclusionEnabled; }
     bool IsBloomEnabled() { return m_bloomEnabled; }
     bool IsDOFEnabled() { return m_DOFEnabled; }
     bool IsToonEnabled() { return m_toonEnabled; }
     bool IsDOFDebug() { return m_DOFDebug; }
+    bool IsVisibilityBufferEnabled() { return m_visibilityBufferEnabled; }
     bool IsMouseCaptured() { return m_mouseCaptured; }
 
     void SetScissorEnabled(bool isScissorEnabled) { m_scissorEnabled = isScissorEnabled; }
@@ -79,22 +97,37 @@ public:
     void SetMouseCaptured(bool isMouseCaptured) { m_mouseCaptured = isMouseCaptured; }
 
     void ToggleScissor() { m_scissorEnabled = !m_scissorEnabled; }
+    void ToggleShadows() { m_shadowsEnabled = !m_shadowsEnabled; }
+    void ToggleAmbientOcclusion() { m_ambientOcclusionEnabled = !m_ambientOcclusionEnabled; }
     void ToggleBloom() { m_bloomEnabled = !m_bloomEnabled; }
     void ToggleDOF() { m_DOFEnabled = !m_DOFEnabled; }
     void ToggleToon() { m_toonEnabled = !m_toonEnabled; }
     void ToggleDOFDebug() { m_DOFDebug = !m_DOFDebug; }
+    void ToggleVisibilityBuffer();
+    void CycleLightingResolution();
+    void CycleLightingPath();
     void ToggleMouseCaptured() { m_mouseCaptured = !m_mouseCaptured; }
 
     void SetDisplayType(RenderEnums::DisplayType newDisplayType) { m_displayType = newDisplayType; }
     void SetLastX(double lastX) { m_lastX = lastX; }
     void SetLastY(double lastY) { m_lastY = lastY; }
+    void SetCursorPosition(double x, double y) { mouse_dof_x = static_cast<int32_t>(x); mouse_dof_y = static_cast<int32_t>(y); }
 
+    void reshape(int32_t width, int32_t height);
+    void AdjustResolutionScale(float adjustment);
     void AdjustCamera(float xAdjustment, float yAdjustment, float zAdjustment);
     void RotateCamera(float xAngle, float yAngle);
 
     void ReloadShaders();
+    void PickAtFocusPoint();    // Logs the world position under it.
+    void SaveScreenshot();      // To screenshot<n>.bmp in the working directory.
 
     static const std::string c_meshArgumentString;
+    static const std::string c_frameTimeArgumentString;     // Optional. Target GPU frame time in milliseconds; turns on dynamic resolution.
+    static const std::string c_minScaleArgumentString;      // Optional. Lowest resolution scale dynamic resolution may pick.
+    static const std::string c_lightsArgumentString;        // Optional. Lights file, or how many random lights to generate.
+    static const std::string c_passLightsArgumentString;    // Optional. Most point lights the single-pass lighting path loops over.
+    static const std::string c_aoBudgetArgumentString;      // Optional. Milliseconds of GPU time ambient occlusion may take; 0 for no limit.
 };
 
 #define RENDERER m_spRenderer
\ No newline at end of file
@@ -1,19 +1,39 @@
 #include "GLProgram.h"
+#include "ProgramBinaryCache.h"
 #include "ShaderConstantManager.h"
+#include "ShaderLibrary.h"
+#include "SpirvReflection.h"
 #include "Utility.h"
+
+#include <algorithm>
+#include <sstream>
 #include "gl/glew.h"
 
 static void tokenizer(const std::string& sourceString, std::vector<std::string>& tokenList);
 static ShaderConstantManager::SupportedTypes GLTypeToSupportedType(GLint gltype);
 
 GLProgram::GLProgram()
-    : m_id(0)
+    : m_id(0),
+    m_programType(RenderEnums::RENDER_PROGRAM),
+    m_status(RenderEnums::PROGRAM_EMPTY),
+    m_cacheKey(0),
+    m_useCache(false),
+    m_usingSpirv(false),
+    m_fixedTextureUnits(false),
+    m_workGroupSize()
 {
 }
 
 GLProgram::GLProgram(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, 
     const std::map<std::string, GLType_uint>& attributeBindIndices, const std::map<std::string, GLType_uint>& outputBindIndices)
-    : m_id(0)
+    : m_id(0),
+    m_programType(RenderEnums::RENDER_PROGRAM),
+    m_status(RenderEnums::PROGRAM_EMPTY),
+    m_cacheKey(0),
+    m_useCache(false),
+    m_usingSpirv(false),
+    m_fixedTextureUnits(false),
+    m_workGroupSize()
 {
     for (const auto& itr : attributeBindIndices)
     {
@@ -30,45 +50,295 @@ GLProgram::GLProgram(RenderEnums::ProgramType programType, const std::vector<std
 
 GLProgram::~GLProgram()
 {
+    if (m_pendingSources.valid())
+        m_pendingSources.wait();    // The worker holds a pointer to us.
+
+    if (m_status == RenderEnums::PROGRAM_COMPILING)
+        Utility::deleteShaders(m_id, m_pendingShaders);
+
+    if (m_id)
+        glDeleteProgram(m_id);
 }
 
 void GLProgram::Create(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles)
 {
-    Utility::shaders_t shaders;
+    Submit(programType, shaderSourceFiles);
+    Finish();
+}
+
+void GLProgram::Submit(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles)
+{
+    assert(m_status == RenderEnums::PROGRAM_EMPTY);
+
+    m_programType = programType;
+    m_shaderSourceFiles = shaderSourceFiles;
+    m_status = RenderEnums::PROGRAM_PREPROCESSING;
+    std::vector<std::string> keywords = m_keywords;
+    m_pendingSources = std::async(std::launch::async, [this, programType, shaderSourceFiles, keywords]() { return LoadAndPreprocessSources(programType, shaderSourceFiles, keywords); });
+}
+
+bool GLProgram::Poll()
+{
+    if (m_pendingReload)
+        PollReload();
+
+    if (m_status == RenderEnums::PROGRAM_PREPROCESSING)
+    {
+        if (m_pendingSources.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return false;
+
+        m_preprocessedSources = m_pendingSources.get();
+        SubmitToDriver();
+    }
+
+    if (m_status == RenderEnums::PROGRAM_COMPILING)
+    {
+        if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+                return false;
+        }
+
+        CompleteLink();
+    }
+
+    return IsReady();
+}
+
+void GLProgram::Finish()
+{
+    if (m_status == RenderEnums::PROGRAM_PREPROCESSING)
+    {
+        m_preprocessedSources = m_pendingSources.get();
+        SubmitToDriver();
+    }
+
+    while (m_status == RenderEnums::PROGRAM_COMPILING)
+        CompleteLink();     // Loops once more if a SPIR-V program had to fall back to GLSL.
+
+    assert(m_status == RenderEnums::PROGRAM_READY);
+}
+
+void GLProgram::Reload()
+{
+    if (m_status == RenderEnums::PROGRAM_EMPTY)
+        return;
+
+    try
+    {
+        m_pendingReload = std::make_unique<GLProgram>();   // Replaces any reload still in flight; that one is out of date anyway.
+    }
+    catch (std::bad_alloc&)
+    {
+        assert(false); // Out of memory.
+        return;
+    }
+
+    m_pendingReload->m_attributeBindIndicesMap = m_attributeBindIndicesMap;
+    m_pendingReload->m_outputBindIndicesMap = m_outputBindIndicesMap;
+    m_pendingReload->m_keywords = m_keywords;
+    m_pendingReload->Submit(m_programType, m_shaderSourceFiles);
+}
+
+bool GLProgram::DependsOn(const std::vector<std::string>& sourceFiles) const
+{
+    try
+    {
+        std::shared_ptr<ShaderLibrary> spShaderLibrary = std::shared_ptr<ShaderLibrary>(ShaderLibrary::GetSingleton());
+        for (const auto& itr : m_shaderSourceFiles)
+        {
+            for (const std::string& sourceFile : sourceFiles)
+            {
+                if (spShaderLibrary->DependsOn(itr.first, sourceFile))
+                    return true;
+            }
+        }
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        assert(false); // ShaderLibrary wasn't Create()d.
+    }
+
+    return false;
+}
+
+void GLProgram::PollReload()
+{
+    if (m_pendingReload->Poll())
+    {
+        AdoptReload(*m_pendingReload);
+        m_pendingReload = nullptr;
+    }
+    else if (m_pendingReload->m_status == RenderEnums::PROGRAM_FAILED)
+    {
+        std::ostringstream debugOutput;
+        debugOutput << "Reloading " << m_shaderSourceFiles.back().first << " failed. Keeping the previous program.";
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+        m_pendingReload = nullptr;
+    }
+}
+
+void GLProgram::AdoptReload(GLProgram& reloaded)
+{
+    // Textures already set on us stay set; the renderer only sets them when it draws.
+    for (auto& itr : reloaded.m_textureBindIndicesMap)
+    {
+        const auto& mapItr = m_textureBindIndicesMap.find(itr.first);
+        if (mapItr != m_textureBindIndicesMap.end())
+            itr.second.second = mapItr->second.second;
+    }
+    for (auto& itr : reloaded.m_storageBufferBindIndicesMap)
+    {
+        const auto& mapItr = m_storageBufferBindIndicesMap.find(itr.first);
+        if (mapItr != m_storageBufferBindIndicesMap.end())
+            itr.second.second = mapItr->second.second;
+    }
+    for (auto& itr : reloaded.m_imageBindIndicesMap)
+    {
+        const auto& mapItr = m_imageBindIndicesMap.find(itr.first);
+        if (mapItr != m_imageBindIndicesMap.end())
+        {
+            itr.second.texture = mapItr->second.texture;
+            itr.second.format = mapItr->second.format;
+            itr.second.level = mapItr->second.level;
+        }
+    }
+
+    // Swap rather than copy, so the old GL program goes away with the reloaded object.
+    std::swap(m_id, reloaded.m_id);
+    std::swap(m_textureBindIndicesMap, reloaded.m_textureBindIndicesMap);
+    std::swap(m_constantBufferBindIndicesMap, reloaded.m_constantBufferBindIndicesMap);
+    std::swap(m_shaderConstantToConstantBufferBindingMap, reloaded.m_shaderConstantToConstantBufferBindingMap);
+    std::swap(m_storageBufferBindIndicesMap, reloaded.m_storageBufferBindIndicesMap);
+    std::swap(m_imageBindIndicesMap, reloaded.m_imageBindIndicesMap);
+    std::copy(reloaded.m_workGroupSize, reloaded.m_workGroupSize + 3, m_workGroupSize);
+    m_usingSpirv = reloaded.m_usingSpirv;
+    m_fixedTextureUnits = reloaded.m_fixedTextureUnits;
+    m_cacheKey = reloaded.m_cacheKey;
+    m_status = RenderEnums::PROGRAM_READY;
 
-    std::string vert_shader, frag_shader;     // More shader types to be supported later.
+    std::ostringstream debugOutput;
+    debugOutput << "Reloaded " << m_shaderSourceFiles.back().first;
+    Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+}
+
+GLProgram::PreprocessedSources GLProgram::LoadAndPreprocessSources(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, const std::vector<std::string>& keywords) const
+{
+    // Runs on a worker thread. Must not touch GL or any GLProgram state.
+    std::string vert_shader, frag_shader, comp_shader;     // More shader types to be supported later.
     for (auto i : shaderSourceFiles)
     {
         if (i.second == RenderEnums::VERT)
             vert_shader = i.first;
         else if (i.second == RenderEnums::FRAG)
             frag_shader = i.first;
+        else if (i.second == RenderEnums::COMP)
+            comp_shader = i.first;
     }
 
-    int32_t size = 0;
-    char* shaderSourceRaw = Utility::loadFile(vert_shader.c_str(), size);
-    std::string vertShaderSource(shaderSourceRaw);
-    delete[] shaderSourceRaw;
+    std::vector<std::string> stageFiles;
+    if (programType == RenderEnums::COMPUTE_PROGRAM)
+    {
+        assert(!comp_shader.empty());   // Compute programs need a COMP stage, and nothing else.
+        stageFiles.push_back(comp_shader);
+    }
+    else
+    {
+        stageFiles.push_back(vert_shader);
+        stageFiles.push_back(frag_shader);
+    }
 
-    shaderSourceRaw = Utility::loadFile(frag_shader.c_str(), size);
-    std::string fragShaderSource(shaderSourceRaw);
-    delete[] shaderSourceRaw;
-    shaderSourceRaw = nullptr;
+    // Includes are resolved and memoized by the library, so a header shared by every program is read and parsed once.
+    PreprocessedSources preprocessedSources;
+    try
+    {
+        std::shared_ptr<ShaderLibrary> spShaderLibrary = std::shared_ptr<ShaderLibrary>(ShaderLibrary::GetSingleton());
+        for (const std::string& stageFile : stageFiles)
+        {
+            std::string shaderSource = spShaderLibrary->GetPreprocessedSource(stageFile);
+            InjectKeywords(shaderSource, keywords);
+            preprocessedSources.glsl.push_back(shaderSource);
+        }
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        assert(false); // ShaderLibrary wasn't Create()d.
+    }
 
-    std::string workingDirectory;
-    if (vert_shader.find_last_of('\\') != std::string::npos)
-        workingDirectory = vert_shader.substr(0, vert_shader.find_last_of('\\') + 1);   // Include trailing "\\"
-    else
-        workingDirectory = vert_shader.substr(0, vert_shader.find_last_of('/') + 1); // Include trailing /
-    PreprocessShaderSource(vertShaderSource, workingDirectory);
+    LoadSpirvModules(stageFiles, preprocessedSources);
 
-    if (frag_shader.find_last_of('\\') != std::string::npos)
-        workingDirectory = frag_shader.substr(0, frag_shader.find_last_of('\\') + 1);
-    else
-        workingDirectory = frag_shader.substr(0, frag_shader.find_last_of('/') + 1);
-    PreprocessShaderSource(fragShaderSource, workingDirectory);
+    return preprocessedSources;
+}
+
+void GLProgram::LoadSpirvModules(const std::vector<std::string>& shaderSourceFiles, PreprocessedSources& sources) const
+{
+    // Also runs on the worker thread. Modules are built offline by res/shaders/CompileSpirv.bat, one per stage, into a spirv
+    // directory next to the sources: pass.vert -> spirv/pass.vert.spv. A module older than its GLSL or anything that includes is
+    // ignored, so an edited shader (hot reloaded or not) builds from GLSL until the modules are rebuilt.
+    std::shared_ptr<ShaderLibrary> spShaderLibrary;
+    try
+    {
+        spShaderLibrary = std::shared_ptr<ShaderLibrary>(ShaderLibrary::GetSingleton());
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        assert(false); // ShaderLibrary wasn't Create()d.
+        return;
+    }
+
+    PreprocessedSources spirvSources;
+    for (const std::string& sourceFile : shaderSourceFiles)
+    {
+        std::string normalizedPath = ShaderLibrary::NormalizePath(sourceFile);
+        std::size_t fileNameStart = normalizedPath.find_last_of('/') + 1;  // npos + 1 == 0 when there's no directory.
+        std::string moduleFile = normalizedPath.substr(0, fileNameStart) + "spirv/" + normalizedPath.substr(fileNameStart) + ".spv";
+
+        uint64_t moduleWriteTime = ShaderLibrary::GetLastWriteTime(moduleFile);
+        if ((moduleWriteTime == 0) || (moduleWriteTime < spShaderLibrary->GetLatestWriteTime(sourceFile)))
+            return;     // Missing or stale.
+
+        int32_t size = 0;
+        char* moduleRaw = Utility::loadFile(moduleFile.c_str(), size);
+        std::string module(moduleRaw, size);
+        delete[] moduleRaw;
+
+        if (!SpirvReflection::Reflect(module, spirvSources.spirvReflection, spirvSources.specializationConstants))
+        {
+            std::ostringstream debugOutput;
+            debugOutput << moduleFile << " is not a SPIR-V module we can use. Compiling GLSL instead.";
+            Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+            return;
+        }
+
+        spirvSources.spirv.push_back(module);
+    }
 
-    shaders = Utility::createShaders(vertShaderSource, fragShaderSource);
+    sources.spirv.swap(spirvSources.spirv);
+    sources.spirvReflection = spirvSources.spirvReflection;
+    sources.specializationConstants.swap(spirvSources.specializationConstants);
+}
+
+void GLProgram::SubmitToDriver()
+{
+    m_usingSpirv = !m_preprocessedSources.spirv.empty() && (GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv);
+    const std::vector<std::string>& sources = m_usingSpirv ? m_preprocessedSources.spirv : m_preprocessedSources.glsl;
+
+    m_cacheKey = ProgramBinaryCache::ComputeKey(sources, m_keywords, m_attributeBindIndicesMap, m_outputBindIndicesMap);
+    m_useCache = ProgramBinaryCache::IsSupported();
+    if (m_useCache && CreateFromBinary(m_cacheKey))
+    {
+        m_status = RenderEnums::PROGRAM_READY;
+        return;
+    }
+
+    if (m_usingSpirv)
+        m_pendingShaders = SubmitSpirvShaders();
+    else if (m_programType == RenderEnums::COMPUTE_PROGRAM)
+        m_pendingShaders = Utility::submitComputeShader(m_preprocessedSources.glsl[0]);
+    else
+        m_pendingShaders = Utility::submitShaders(m_preprocessedSources.glsl[0], m_preprocessedSources.glsl[1]);
     m_id = glCreateProgram();
     assert(m_id != 0);
 
@@ -77,10 +347,101 @@ void GLProgram::Create(RenderEnums::ProgramType programType, const std::vector<s
     for (const auto& itr : m_outputBindIndicesMap)
         glBindFragDataLocation(m_id, itr.second, itr.first.c_str());
 
-    Utility::attachAndLinkProgram(m_id, shaders);
+    if (m_useCache)
+        glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    Utility::submitLink(m_id, m_pendingShaders);
+    m_status = RenderEnums::PROGRAM_COMPILING;
+}
+
+Utility::shaders_t GLProgram::SubmitSpirvShaders() const
+{
+    // The module is the same for every variant; keywords only pick the values of its specialization constants.
+    std::vector<GLType_uint> constantIndices, constantValues;
+    for (const std::string& keyword : m_keywords)
+    {
+        const auto& mapItr = m_preprocessedSources.specializationConstants.find(keyword);
+        if (mapItr != m_preprocessedSources.specializationConstants.end())
+        {
+            constantIndices.push_back(mapItr->second);
+            constantValues.push_back(GL_TRUE);
+        }
+    }
+
+    if (m_programType == RenderEnums::COMPUTE_PROGRAM)
+        return Utility::submitSpirvComputeShader(m_preprocessedSources.spirv[0], constantIndices, constantValues);
 
-    SetupTextureBindingsAndConstantBuffers(vertShaderSource);
-    SetupTextureBindingsAndConstantBuffers(fragShaderSource);
+    return Utility::submitSpirvShaders(m_preprocessedSources.spirv[0], m_preprocessedSources.spirv[1], constantIndices, constantValues);
+}
+
+void GLProgram::CompleteLink()
+{
+    bool compiled = Utility::checkShaders(m_pendingShaders);
+    bool linked = compiled && Utility::checkLink(m_id);
+
+    Utility::deleteShaders(m_id, m_pendingShaders);
+
+    if (!linked && m_usingSpirv)
+    {
+        // A driver can reject a module the offline compiler was happy with. Fall back to GLSL; we still have it.
+        std::ostringstream debugOutput;
+        debugOutput << "SPIR-V for " << m_shaderSourceFiles.back().first << " was rejected. Compiling GLSL instead.";
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+
+        glDeleteProgram(m_id);
+        m_id = 0;
+        m_preprocessedSources.spirv.clear();
+        SubmitToDriver();
+        return;
+    }
+
+    if (!linked)
+    {
+        m_status = RenderEnums::PROGRAM_FAILED;   // Finish() asserts on this; a failed reload is only logged.
+        return;
+    }
+
+    ProgramReflection reflection;
+    if (m_usingSpirv)
+        reflection = m_preprocessedSources.spirvReflection;     // GL can't look up uniforms by name in a SPIR-V program.
+    else
+    {
+        for (const std::string& shaderSource : m_preprocessedSources.glsl)
+            ReflectTexturesAndConstantBuffers(shaderSource, reflection);
+    }
+    ApplyReflection(reflection);
+
+    if (m_useCache)
+        ProgramBinaryCache::Store(m_cacheKey, m_id, reflection);
+
+    m_preprocessedSources = PreprocessedSources();
+    m_status = RenderEnums::PROGRAM_READY;
+}
+
+bool GLProgram::CreateFromBinary(uint64_t cacheKey)
+{
+    GLType_uint binaryFormat = 0;
+    std::vector<char> binary;
+    ProgramReflection reflection;
+    if (!ProgramBinaryCache::Load(cacheKey, binaryFormat, binary, reflection))
+        return false;
+
+    m_id = glCreateProgram();
+    assert(m_id != 0);
+    glProgramBinary(m_id, binaryFormat, &binary[0], static_cast<GLsizei>(binary.size()));
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(m_id, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        // The driver can reject a binary for reasons the key doesn't capture. Drop it and build from source instead.
+        glDeleteProgram(m_id);
+        m_id = 0;
+        ProgramBinaryCache::Evict(cacheKey);
+        return false;
+    }
+
+    ApplyReflection(reflection);
+    return true;
 }
 
 void GLProgram::SetActive() const
@@ -118,41 +479,24 @@ void GLProgram::SetShaderConstant(ShaderConstantReference constantHandle, const
     }
 }
 
-void GLProgram::PreprocessShaderSource(std::string& shaderSource, const std::string& workingDirectory) const
+void GLProgram::InjectKeywords(std::string& shaderSource, const std::vector<std::string>& keywords) const
 {
-    // Prepend Includes.
-    while (1)
-    {
-        std::size_t includePosition = shaderSource.find("#include");
-        if (includePosition != std::string::npos)
-        {
-            std::size_t includeEndPosition = shaderSource.find('\n', includePosition);
-            std::size_t includeNameEnd = includeEndPosition;
-            while ((shaderSource[includeNameEnd] == '\r') || (shaderSource[includeNameEnd] == '\n') || (shaderSource[includeNameEnd] == '\t') || (shaderSource[includeNameEnd] == ' '))
-                --includeNameEnd;
-            std::string headerNameWithQuotes = shaderSource.substr(includePosition + 9, includeNameEnd - (includePosition + 9) + 1);  // 9: '#','i','n','c','l','u','d','e',' '
-            std::string headerName;
-            if (headerNameWithQuotes.find_first_of('"') != headerNameWithQuotes.find_last_of('"'))
-            {
-                headerName = headerNameWithQuotes.substr(headerNameWithQuotes.find_first_of('"') + 1, headerNameWithQuotes.find_last_of('"') - headerNameWithQuotes.find_first_of('"') - 1);
-            }
-            else
-            {
-                assert(false);  // Header not enclosed in quotes.
-            }
-            headerName.insert(0, workingDirectory);
+    if (keywords.empty())
+        return;
 
-            int32_t headerSize = 0;
-            char* includeSourceRaw = Utility::loadFile(headerName.c_str(), headerSize);
-            shaderSource.replace(includePosition, includeEndPosition - includePosition - 1, includeSourceRaw);
-            delete[] includeSourceRaw;  includeSourceRaw = nullptr;
-        }
-        else
-            break;
-    }
+    // #version has to stay the first statement, so defines go right after it. Includes have been resolved by now, so it's in here somewhere.
+    std::size_t versionPosition = shaderSource.find("#version");
+    assert(versionPosition != std::string::npos);
+    std::size_t insertPosition = shaderSource.find('\n', versionPosition);
+    insertPosition = (insertPosition != std::string::npos) ? insertPosition + 1 : shaderSource.length();
+
+    std::string defines;
+    for (const std::string& keyword : keywords)
+        defines.append("#define " + keyword + " true\n");    // Shaders test keywords with if (), same as the SPIR-V specialization constants.
+    shaderSource.insert(insertPosition, defines);
 }
 
-void GLProgram::SetupTextureBindingsAndConstantBuffers(const std::string& shaderSource)
+void GLProgram::ReflectTexturesAndConstantBuffers(const std::string& shaderSource, ProgramReflection& reflection) const
 {
     // Tokenize
     std::vector<std::string> tokenList;
@@ -164,36 +508,98 @@ void GLProgram::SetupTextureBindingsAndConstantBuffers(const std::string& shader
     {
         if (tokenList[i].compare("uniform") == 0)
             uniformTokenPositions.push_back(i);
+        else if ((tokenList[i].compare("buffer") == 0) && (i + 1 < tokenList.size()))
+        {
+            // Shader storage block. Its binding comes from layout(binding = N); ask GL rather than parsing the layout.
+            std::string storageBufferName = tokenList[i + 1];
+            bool alreadyReflected = false;
+            for (const auto& itr : reflection.storageBuffers)
+                alreadyReflected |= (itr.first == storageBufferName);
+
+            GLType_uint storageBlockIndex = glGetProgramResourceIndex(m_id, GL_SHADER_STORAGE_BLOCK, storageBufferName.c_str());
+            if (!alreadyReflected && (storageBlockIndex != GL_INVALID_INDEX))
+            {
+                GLenum property = GL_BUFFER_BINDING;
+                GLint binding = 0;
+                glGetProgramResourceiv(m_id, GL_SHADER_STORAGE_BLOCK, storageBlockIndex, 1, &property, 1, nullptr, &binding);
+                reflection.storageBuffers.push_back(std::make_pair(storageBufferName, binding));
+            }
+        }
     }
 
-    std::vector<std::string> activeTextures;
     std::vector<std::string> activeUniforms;
-    std::string constBufferName;
     std::vector<ShaderConstantSignature> constBufferSignature;
-    std::shared_ptr<ShaderConstantManager> spShaderConstantManager;
-    try
-    {
-        spShaderConstantManager = std::shared_ptr<ShaderConstantManager>(ShaderConstantManager::GetSingleton());
-    }
-    catch (std::bad_weak_ptr&)
-    {
-        assert(false); // ShaderConstantManager wasn't Create()d.
-    }
 
     for (auto& i : uniformTokenPositions)
     {
-        // Gather all sampler uniforms - these will be passed to SetupTextureBindings()
-        if (tokenList[i + 1].find("sampler") != std::string::npos)
+        // Memory qualifiers can sit between "uniform" and an image type.
+        uint32_t typeToken = i + 1;
+        GLType_uint imageAccess = GL_READ_WRITE;
+        while ((typeToken + 1 < tokenList.size()) && ((tokenList[typeToken] == "readonly") || (tokenList[typeToken] == "writeonly") ||
+            (tokenList[typeToken] == "coherent") || (tokenList[typeToken] == "volatile") || (tokenList[typeToken] == "restrict")))
+        {
+            if (tokenList[typeToken] == "readonly")
+                imageAccess = GL_READ_ONLY;
+            else if (tokenList[typeToken] == "writeonly")
+                imageAccess = GL_WRITE_ONLY;
+            ++typeToken;
+        }
+        for (int32_t previous = i - 1; previous >= 0; --previous)
         {
-            activeTextures.push_back(tokenList[i + 2]);
-            activeTextures.back().pop_back();  // Get rid of trailing ;
+            // Or before it.
+            if (tokenList[previous].find(";") != std::string::npos)
+                break;
+            else if (tokenList[previous] == "readonly")
+                imageAccess = GL_READ_ONLY;
+            else if (tokenList[previous] == "writeonly")
+                imageAccess = GL_WRITE_ONLY;
+        }
+
+        if (tokenList[typeToken].find("image") != std::string::npos)
+        {
+            // Image uniforms. The unit is whatever layout(binding = N) initialized the uniform to.
+            std::string imageName = tokenList[typeToken + 1];
+            imageName.pop_back();  // Get rid of trailing ;
+
+            bool alreadyReflected = false;
+            for (const auto& itr : reflection.images)
+                alreadyReflected |= (itr.name == imageName);
+
+            GLType_int imageLocation = glGetUniformLocation(m_id, imageName.c_str());
+            if (!alreadyReflected && (imageLocation > -1))
+            {
+                ProgramReflection::ImageBinding image;
+                image.name = imageName;
+                image.unit = 0;
+                glGetUniformiv(m_id, imageLocation, &image.unit);
+                image.access = imageAccess;
+                reflection.images.push_back(image);
+            }
+        }
+        // Gather all sampler uniforms.
+        else if (tokenList[i + 1].find("sampler") != std::string::npos)
+        {
+            std::string textureName = tokenList[i + 2];
+            textureName.pop_back();  // Get rid of trailing ;
+
+            bool alreadyReflected = false;
+            for (const auto& itr : reflection.textures)
+                alreadyReflected |= (itr.first == textureName);
+
+            GLType_int textureLocation = glGetUniformLocation(m_id, textureName.c_str());
+            if (!alreadyReflected && (textureLocation > -1))
+                reflection.textures.push_back(std::make_pair(textureName, textureLocation));
         }
         else
         {
             // This is a constant buffer.
-            constBufferName = tokenList[i + 1];
+            std::string constBufferName = tokenList[i + 1];
+            bool alreadyReflected = false;
+            for (const auto& itr : reflection.constantBuffers)
+                alreadyReflected |= (itr.name == constBufferName);  // Common includes declare the same block in every stage.
+
             GLType_uint constBufferBlockIndex = glGetUniformBlockIndex(m_id, constBufferName.c_str());
-            if (constBufferBlockIndex != GL_INVALID_INDEX)   // Check if the constant buffer exists in this program.
+            if (!alreadyReflected && (constBufferBlockIndex != GL_INVALID_INDEX))   // Check if the constant buffer exists in this program.
             {
                 bool stdLayout = false;
                 for (int32_t previous = i - 1; previous >= 0; --previous)
@@ -294,57 +700,99 @@ void GLProgram::SetupTextureBindingsAndConstantBuffers(const std::string& shader
                         assert(false); // So, the driver culled out constants in an std140 layout? WHAT?!
                 }
 
-                GLType_int constBufferSize = 0;
-                glGetActiveUniformBlockiv(m_id, constBufferBlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &constBufferSize);
-                assert(static_cast<uint32_t>(constBufferSize) >= stdOffset);
-                auto indexOfConstantBuffer = spShaderConstantManager->SetupConstantBuffer(constBufferName, constBufferSize, constBufferSignature);
+                ProgramReflection::ConstantBufferBinding binding;
+                binding.name = constBufferName;
+                binding.size = 0;
+                glGetActiveUniformBlockiv(m_id, constBufferBlockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &binding.size);
+                assert(static_cast<uint32_t>(binding.size) >= stdOffset);
 
-                const auto& mapEnd = m_shaderConstantToConstantBufferBindingMap.end();
-                for (auto& iterator : activeUniforms)
-                {
-                    ShaderConstantReference shaderConstantHandle = Utility::HashCString(iterator.c_str());
-                    const auto& mapItr = m_shaderConstantToConstantBufferBindingMap.find(shaderConstantHandle);
-                    if (mapItr != mapEnd)
-                    {
-                        if (mapItr->second != indexOfConstantBuffer)
-                            assert(false);  // This constant is already mapped to a different constant buffer.
-                    }
-                    else
-                    {
-                        m_shaderConstantToConstantBufferBindingMap[shaderConstantHandle] = indexOfConstantBuffer;
-                    }
-                }
+                binding.bindPoint = -1;
+                glGetActiveUniformBlockiv(m_id, constBufferBlockIndex, GL_UNIFORM_BLOCK_BINDING, &binding.bindPoint);
+                assert(binding.bindPoint > -1);
 
-                GLType_int constBufferBindPoint = -1;
-                glGetActiveUniformBlockiv(m_id, constBufferBlockIndex, GL_UNIFORM_BLOCK_BINDING, &constBufferBindPoint);
-                assert(constBufferBindPoint > -1);
-                m_constantBufferBindIndicesMap[indexOfConstantBuffer] = constBufferBindPoint;
+                binding.signature = constBufferSignature;
+                binding.constantNames = activeUniforms;
+                reflection.constantBuffers.push_back(binding);
             }
         }
 
         activeUniforms.clear();
         constBufferSignature.clear();
     }
-
-    SetupTextureBindings(activeTextures);
 }
 
-void GLProgram::SetupTextureBindings(const std::vector<std::string>& textureNames)
+void GLProgram::ApplyReflection(const ProgramReflection& reflection)
 {
-    for (const std::string& i : textureNames)
+    std::shared_ptr<ShaderConstantManager> spShaderConstantManager;
+    try
     {
-        uint32_t hashValue = Utility::HashCString(i.c_str());
-        if (m_textureBindIndicesMap.count(hashValue) == 0)
+        spShaderConstantManager = std::shared_ptr<ShaderConstantManager>(ShaderConstantManager::GetSingleton());
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        assert(false); // ShaderConstantManager wasn't Create()d.
+    }
+
+    for (const auto& constantBuffer : reflection.constantBuffers)
+    {
+        std::string constBufferName = constantBuffer.name;
+        std::vector<ShaderConstantSignature> constBufferSignature = constantBuffer.signature;
+        auto indexOfConstantBuffer = spShaderConstantManager->SetupConstantBuffer(constBufferName, constantBuffer.size, constBufferSignature);
+
+        const auto& mapEnd = m_shaderConstantToConstantBufferBindingMap.end();
+        for (auto& iterator : constantBuffer.constantNames)
         {
-            // Add if it doesn't already exist.
-            GLType_int constantBindLocation = glGetUniformLocation(m_id, i.c_str());
-            if (constantBindLocation > -1)
+            ShaderConstantReference shaderConstantHandle = Utility::HashCString(iterator.c_str());
+            const auto& mapItr = m_shaderConstantToConstantBufferBindingMap.find(shaderConstantHandle);
+            if (mapItr != mapEnd)
             {
-                m_textureBindIndicesMap[hashValue] = std::make_pair(constantBindLocation, 0);
+                if (mapItr->second != indexOfConstantBuffer)
+                    assert(false);  // This constant is already mapped to a different constant buffer.
+            }
+            else
+            {
+                m_shaderConstantToConstantBufferBindingMap[shaderConstantHandle] = indexOfConstantBuffer;
             }
-//            else
-//                assert(false); // SetupTextureBindings was passed a texture name that isn't active in the program? Update the shader so that this wouldn't happen anymore.
         }
+
+        m_constantBufferBindIndicesMap[indexOfConstantBuffer] = constantBuffer.bindPoint;
+    }
+
+    m_fixedTextureUnits = reflection.fixedTextureUnits;
+    for (const auto& texture : reflection.textures)
+    {
+        uint32_t hashValue = Utility::HashCString(texture.first.c_str());
+        if (m_textureBindIndicesMap.count(hashValue) == 0)
+            m_textureBindIndicesMap[hashValue] = std::make_pair(texture.second, 0);
+    }
+
+    for (const auto& storageBuffer : reflection.storageBuffers)
+    {
+        uint32_t hashValue = Utility::HashCString(storageBuffer.first.c_str());
+        if (m_storageBufferBindIndicesMap.count(hashValue) == 0)
+            m_storageBufferBindIndicesMap[hashValue] = std::make_pair(storageBuffer.second, 0);
+    }
+
+    for (const auto& image : reflection.images)
+    {
+        uint32_t hashValue = Utility::HashCString(image.name.c_str());
+        if (m_imageBindIndicesMap.count(hashValue) == 0)
+        {
+            ImageBinding& imageBinding = m_imageBindIndicesMap[hashValue];
+            imageBinding.unit = image.unit;
+            imageBinding.access = image.access;
+            imageBinding.texture = 0;
+            imageBinding.format = 0;
+            imageBinding.level = 0;
+        }
+    }
+
+    if (m_programType == RenderEnums::COMPUTE_PROGRAM)
+    {
+        GLint workGroupSize[3] = { 0, 0, 0 };
+        glGetProgramiv(m_id, GL_COMPUTE_WORK_GROUP_SIZE, workGroupSize);
+        for (uint32_t i = 0; i < 3; ++i)
+            m_workGroupSize[i] = workGroupSize[i];
     }
 }
 
@@ -362,6 +810,24 @@ void GLProgram::SetTexture(TextureReference textureHandle, GLType_uint textureOb
     }
 }
 
+void GLProgram::SetStorageBuffer(StorageBufferReference storageBufferHandle, GLType_uint bufferObject)
+{
+    auto mapItr = m_storageBufferBindIndicesMap.find(storageBufferHandle);
+    if (mapItr != m_storageBufferBindIndicesMap.end())
+        mapItr->second.second = bufferObject;
+}
+
+void GLProgram::SetImage(ImageReference imageHandle, GLType_uint textureObject, GLType_uint internalFormat, GLType_int level)
+{
+    auto mapItr = m_imageBindIndicesMap.find(imageHandle);
+    if (mapItr != m_imageBindIndicesMap.end())
+    {
+        mapItr->second.texture = textureObject;
+        mapItr->second.format = internalFormat;
+        mapItr->second.level = level;
+    }
+}
+
 bool GLProgram::GetAttributeBindLocation(const std::string& attributeName, GLType_uint& bindLocation) const
 {
     const auto& mapItr = m_attributeBindIndicesMap.find(attributeName);
@@ -410,6 +876,13 @@ void GLProgram::CommitConstantBufferChanges() const
 
 void GLProgram::CommitTextureBindings() const
 {
+    if (m_fixedTextureUnits)
+    {
+        for (const auto& itr : m_textureBindIndicesMap)
+            glBindTextureUnit(itr.second.first, itr.second.second);
+        return;
+    }
+
     uint32_t i = 0;
     for (const auto& itr : m_textureBindIndicesMap)
     {
@@ -420,6 +893,105 @@ void GLProgram::CommitTextureBindings() const
     }
 }
 
+void GLProgram::CommitStorageBufferBindings() const
+{
+    for (const auto& itr : m_storageBufferBindIndicesMap)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, itr.second.first, itr.second.second);
+}
+
+void GLProgram::CommitImageBindings() const
+{
+    for (const auto& itr : m_imageBindIndicesMap)
+    {
+        const ImageBinding& image = itr.second;
+        if (image.texture)
+            glBindImageTexture(image.unit, image.texture, image.level, GL_TRUE, 0, image.access, image.format);
+    }
+}
+
+GLProgramVariants::GLProgramVariants(const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, const std::vector<std::string>& keywords,
+    const std::map<std::string, GLType_uint>& attributeBindIndices, const std::map<std::string, GLType_uint>& outputBindIndices)
+    : m_keywords(keywords),
+    m_shaderSourceFiles(shaderSourceFiles),
+    m_attributeBindIndices(attributeBindIndices),
+    m_outputBindIndices(outputBindIndices)
+{
+    assert(m_keywords.size() < 32);
+}
+
+void GLProgramVariants::SubmitAll()
+{
+    uint32_t numVariants = 1u << m_keywords.size();
+    for (uint32_t keywordMask = 0; keywordMask < numVariants; ++keywordMask)
+        GetVariant(keywordMask);
+}
+
+GLProgram* GLProgramVariants::GetVariant(uint32_t keywordMask)
+{
+    const auto& mapItr = m_variants.find(keywordMask);
+    if (mapItr != m_variants.end())
+        return mapItr->second.get();
+
+    std::vector<std::string> variantKeywords;
+    for (uint32_t i = 0; i < m_keywords.size(); ++i)
+    {
+        if (keywordMask & (1u << i))
+            variantKeywords.push_back(m_keywords[i]);
+    }
+
+    std::unique_ptr<GLProgram> variant;
+    try
+    {
+        variant = std::make_unique<GLProgram>();
+    }
+    catch (std::bad_alloc&)
+    {
+        assert(false); // Out of memory.
+        return nullptr;
+    }
+
+    for (const auto& itr : m_attributeBindIndices)
+        variant->SetAttributeBindLocation(itr.first, itr.second);
+    for (const auto& itr : m_outputBindIndices)
+        variant->SetOutputBindLocation(itr.first, itr.second);
+    variant->SetKeywords(variantKeywords);
+    bool isCompute = (m_shaderSourceFiles.size() == 1) && (m_shaderSourceFiles[0].second == RenderEnums::COMP);
+    variant->Submit(isCompute ? RenderEnums::COMPUTE_PROGRAM : RenderEnums::RENDER_PROGRAM, m_shaderSourceFiles);
+
+    GLProgram* variantPointer = variant.get();
+    m_variants[keywordMask] = std::move(variant);
+    return variantPointer;
+}
+
+uint32_t GLProgramVariants::GetKeywordMask(const std::string& keyword) const
+{
+    for (uint32_t i = 0; i < m_keywords.size(); ++i)
+    {
+        if (m_keywords[i] == keyword)
+            return 1u << i;
+    }
+
+    return 0;   // This program doesn't have that feature.
+}
+
+void GLProgramVariants::Reload()
+{
+    for (auto& itr : m_variants)
+        itr.second->Reload();
+}
+
+bool GLProgramVariants::DependsOn(const std::vector<std::string>& sourceFiles) const
+{
+    // Keywords don't change which files are included, so any variant answers for all of them.
+    return !m_variants.empty() && m_variants.begin()->second->DependsOn(sourceFiles);
+}
+
+void GLProgramVariants::Poll()
+{
+    for (auto& itr : m_variants)
+        itr.second->Poll();     // Ready variants may have a reload in flight.
+}
+
 void tokenizer(const std::string& sourceString, std::vector<std::string>& tokenList)
 {
     std::string newToken;
@@ -1,26 +1,103 @@
 #pragma once
 
+#include <future>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
 
 #include "Common.h"
+#include "ShaderConstantManager.h"
 #include "ShaderResourceReferences.h"
+#include "Utility.h"
+
+// Everything GLProgram learns about a linked program from its source and from GL. Kept separate from the program itself so it can
+// be cached on disk next to the program binary.
+struct ProgramReflection
+{
+    ProgramReflection() : fixedTextureUnits(false) {}
+
+    struct ConstantBufferBinding
+    {
+        std::string name;
+        int32_t size;
+        int32_t bindPoint;
+        std::vector<ShaderConstantSignature> signature;
+        std::vector<std::string> constantNames;
+    };
+
+    struct ImageBinding
+    {
+        std::string name;
+        GLType_int unit;
+        GLType_uint access;     // GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE, from the readonly/writeonly qualifiers.
+    };
+
+    std::vector<ConstantBufferBinding> constantBuffers;
+    std::vector<std::pair<std::string, GLType_int>> storageBuffers;     // First -> block name; second -> binding point.
+    std::vector<ImageBinding> images;
+    std::vector<std::pair<std::string, GLType_int>> textures;   // First -> sampler name; second -> uniform location, or texture unit if fixedTextureUnits.
+    bool fixedTextureUnits;     // Samplers have layout(binding) units baked in. True for SPIR-V, which doesn't give us uniform locations by name.
+};
 
 class GLProgram
 {
+    struct PreprocessedSources
+    {
+        std::vector<std::string> glsl;      // Vertex and fragment (or compute) source with includes resolved and keywords injected.
+        std::vector<std::string> spirv;     // Precompiled modules, one per stage. Empty unless all exist and are up to date.
+        ProgramReflection spirvReflection;
+        std::map<std::string, uint32_t> specializationConstants;    // Key: constant name. Value: SpecId.
+    };
+
+    struct ImageBinding
+    {
+        GLType_uint unit;
+        GLType_uint access;
+        GLType_uint texture;
+        GLType_uint format;
+        GLType_int level;
+    };
+
     GLType_uint m_id;
     std::map<TextureReference, std::pair<GLType_uint, GLType_uint>> m_textureBindIndicesMap;   // Key: String hash value. Value Pair: first -> texture bind point; second -> texture object name.
     std::map<ConstantBufferIndex, GLType_uint> m_constantBufferBindIndicesMap;
+    std::map<StorageBufferReference, std::pair<GLType_uint, GLType_uint>> m_storageBufferBindIndicesMap;   // Value Pair: first -> binding point; second -> buffer object name.
+    std::map<ImageReference, ImageBinding> m_imageBindIndicesMap;
     std::unordered_map<ShaderConstantReference, ConstantBufferIndex, std::hash<uint32_t>, std::equal_to<uint32_t>> m_shaderConstantToConstantBufferBindingMap;
     std::map<std::string, GLType_uint> m_attributeBindIndicesMap;
     std::map<std::string, GLType_uint> m_outputBindIndicesMap;
+    std::vector<std::string> m_keywords;    // Each is #defined right after the #version line.
+    RenderEnums::ProgramType m_programType;
+    std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>> m_shaderSourceFiles;
+
+    // Asynchronous creation state. See Submit()/Poll()/Finish().
+    RenderEnums::ProgramStatus m_status;
+    std::future<PreprocessedSources> m_pendingSources;     // Produced on a worker thread.
+    PreprocessedSources m_preprocessedSources;
+    Utility::shaders_t m_pendingShaders;
+    uint64_t m_cacheKey;
+    bool m_useCache;
+    bool m_usingSpirv;
+    bool m_fixedTextureUnits;
+
+    GLType_uint m_workGroupSize[3];     // Compute programs only.
+
+    std::unique_ptr<GLProgram> m_pendingReload;    // Rebuilt from changed sources. Its state replaces ours once it links.
 
-    void SetupTextureBindings(const std::vector<std::string>& textureNames);
     void SetShaderConstant(ShaderConstantReference constantHandle, const void* value_in) const;
-    void PreprocessShaderSource(std::string& shaderSource, const std::string& workingDirectory) const;
-    void SetupTextureBindingsAndConstantBuffers(const std::string& shaderSource);
+    PreprocessedSources LoadAndPreprocessSources(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, const std::vector<std::string>& keywords) const;
+    void InjectKeywords(std::string& shaderSource, const std::vector<std::string>& keywords) const;
+    void LoadSpirvModules(const std::vector<std::string>& shaderSourceFiles, PreprocessedSources& sources) const;
+    void ReflectTexturesAndConstantBuffers(const std::string& shaderSource, ProgramReflection& reflection) const;
+    void ApplyReflection(const ProgramReflection& reflection);
+    bool CreateFromBinary(uint64_t cacheKey);
+    void SubmitToDriver();
+    Utility::shaders_t SubmitSpirvShaders() const;
+    void CompleteLink();
+    void PollReload();
+    void AdoptReload(GLProgram& reloaded);
 
 public:
     GLProgram();
@@ -29,11 +106,26 @@ public:
         const std::map<std::string, GLType_uint>& outputBindIndices = std::map<std::string, GLType_uint>());
     ~GLProgram();
 
-    void Create(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles);
+    void Create(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles);   // Submit() + Finish().
+
+    // Starts creating the program without waiting on file IO or the driver. Poll() advances creation as far as it can without
+    // blocking and returns true once the program is usable; Finish() blocks until it is.
+    void Submit(RenderEnums::ProgramType programType, const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles);
+    bool Poll();
+    void Finish();
+    bool IsReady() const { return m_status == RenderEnums::PROGRAM_READY; }
+
+    // Rebuilds the program from its source files in the background while this one stays usable. The new program is swapped in
+    // by Poll() once it links; if it fails to compile, the error is logged and this one is kept.
+    void Reload();
+    bool DependsOn(const std::vector<std::string>& sourceFiles) const;  // True if any of them is one of our sources or is included by one.
 
     void SetAttributeBindLocation(const std::string& attributeName, GLType_uint bindLocation) { m_attributeBindIndicesMap[attributeName] = bindLocation; }
     void SetOutputBindLocation(const std::string& outputName, GLType_uint bindLocation) { m_outputBindIndicesMap[outputName] = bindLocation; }
+    void SetKeywords(const std::vector<std::string>& keywords) { assert(m_status == RenderEnums::PROGRAM_EMPTY); m_keywords = keywords; }
     void SetTexture(TextureReference textureHandle, GLType_uint textureObject);
+    void SetStorageBuffer(StorageBufferReference storageBufferHandle, GLType_uint bufferObject);
+    void SetImage(ImageReference imageHandle, GLType_uint textureObject, GLType_uint internalFormat, GLType_int level = 0);  // internalFormat must match the shader's format qualifier.
 
     void SetActive() const;
 
@@ -43,9 +135,35 @@ public:
 
     bool GetAttributeBindLocation(const std::string& attributeName, GLType_uint& bindLocation) const;
     bool GetOutputBindLocation(const std::string& outputName, GLType_uint& bindLocation) const;
+    const GLType_uint* GetWorkGroupSize() const { assert(m_programType == RenderEnums::COMPUTE_PROGRAM); return m_workGroupSize; }
 
     void CommitConstantBufferChanges() const;
     void CommitTextureBindings() const;
+    void CommitStorageBufferBindings() const;
+    void CommitImageBindings() const;
+};
+
+// All compiled variants of one program. A variant is picked by a mask where bit i enables keyword i, so features that are constant
+// for a whole pass are resolved at compile time instead of branching on a uniform for every pixel.
+class GLProgramVariants
+{
+    std::vector<std::string> m_keywords;
+    std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>> m_shaderSourceFiles;
+    std::map<std::string, GLType_uint> m_attributeBindIndices;
+    std::map<std::string, GLType_uint> m_outputBindIndices;
+    std::map<uint32_t, std::unique_ptr<GLProgram>> m_variants;     // Key: keyword mask.
+
+public:
+    GLProgramVariants(const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, const std::vector<std::string>& keywords,
+        const std::map<std::string, GLType_uint>& attributeBindIndices = std::map<std::string, GLType_uint>(),
+        const std::map<std::string, GLType_uint>& outputBindIndices = std::map<std::string, GLType_uint>());
+
+    void SubmitAll();   // Starts compiling every combination in the background.
+    void Reload();      // Reloads every variant that has been submitted.
+    bool DependsOn(const std::vector<std::string>& sourceFiles) const;
+    GLProgram* GetVariant(uint32_t keywordMask);   // Submits the variant if it hasn't been yet. It may still be compiling.
+    uint32_t GetKeywordMask(const std::string& keyword) const;
+    void Poll();
 };
 
 template<typename T>
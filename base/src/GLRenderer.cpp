@@ -1,46 +1,243 @@
 #include "GLRenderer.h"
+#include "AsyncReadback.h"
 #include "GLProgram.h"
+#include "PassTimer.h"
 #include "Utility.h"
 #include "gl/glew.h"
 #include "Camera.h"
+#include "DynamicResolution.h"
 #include "ShaderConstantManager.h"
+#include "ShaderLibrary.h"
 #include "TextureManager.h"
 #include "VertexSpecification.h"
 
-namespace Colours
+#include <algorithm>
+#include <sstream>
+
+namespace
 {
-    glm::vec3 yellow = glm::vec3(1, 1, 0);
-    glm::vec3 orange = glm::vec3(0.89, 0.44, 0.1);
-    glm::vec3 red = glm::vec3(1, 0, 0);
-    glm::vec3 blue = glm::vec3(0, 0, 1);
+    // Render resolution scale range. Intermediate targets are allocated at the output size times the maximum, once.
+    const float c_minResolutionScale = 0.25f;
+    const float c_maxResolutionScale = 1.0f;
+
+    const uint32_t c_lightingTileSize = 16;     // Must match TILE_SIZE in tiled_lighting.comp.
+
+    // Ambient occlusion. The group size must match GROUP_SIZE, and the sample counts MAX_SAMPLES, in the ambient occlusion shaders.
+    const uint32_t c_aoGroupSize = 8;
+    const uint32_t c_minAOSampleCount = 4;
+    const uint32_t c_maxAOSampleCount = 16;
+    const uint32_t c_aoSampleCountStep = 4;     // The kernel is ordered so that every aligned run of this many covers it evenly.
+    const float c_aoHistoryWeight = 0.9f;
+    const float c_aoBudgetHeadroom = 0.75f;     // Samples are only added back while under this fraction of the budget.
+
+    // Must match GROUP_SIZE and PYRAMID_LEVELS in depth_pyramid.comp and colour_pyramid.comp. A group reduces its whole tile, so the levels follow from it.
+    const uint32_t c_mipPyramidGroupSize = 8;
+    const uint32_t c_mipPyramidLevels = 4;
+
+    // Must match GROUP_SIZE in dof_prepare.comp and dof_blur.comp respectively. Blur groups are runs along the blur axis.
+    const uint32_t c_dofPrepareGroupSize = 8;
+    const uint32_t c_dofBlurGroupSize = 64;
+    const float c_autofocusRate = 0.15f;    // Of the way to the read back focal distance covered each frame.
+
+    // Bloom. The group size must match GROUP_SIZE in the bloom shaders. Level 0 is half the render resolution, the last 1/64th.
+    const uint32_t c_bloomGroupSize = 8;
+    const uint32_t c_bloomLevels = 6;
+    const float c_bloomThreshold = 0.8f;    // Brightest channel; the lit frame is mostly sRGB, so this has to stay below 1.
+    const float c_bloomKnee = 0.3f;
+    const float c_bloomIntensity = 0.2f;    // Of the sum of every level.
+
+    const uint32_t c_postGroupSize = 8;     // Must match GROUP_SIZE in post.comp.
+
+    // Visibility texel layout; must match VisibilityCommon.glsl. Draw index in the top bits, triangle index in the rest.
+    const uint32_t c_visibilityTriangleBits = 20;
+    const uint32_t c_visibilityEmpty = 0xFFFFFFFF;
+    const uint32_t c_maxVisibilityDraws = (1u << (32 - c_visibilityTriangleBits)) - 1;    // The last draw index would collide with c_visibilityEmpty.
+
+    static_assert(sizeof(Vertex) == 11 * sizeof(float), "VisibilityCommon.glsl reads vertices as 11 tightly packed floats.");
+
+    // Mirrors DrawData in VisibilityCommon.glsl, including std430 padding.
+    struct VisibilityDrawData
+    {
+        glm::mat4 modelView;
+        glm::mat4 inverseTransposedModelView;
+        uint64_t diffuseHandle;
+        uint64_t normalHandle;
+        uint32_t firstIndex;
+        uint32_t padding[3];
+    };
+
+    // Mirrors PointShadowFace in point_shadow.vert.
+    struct PointShadowFace
+    {
+        glm::mat4 worldToFace;
+        glm::mat4 faceToAtlas;
+    };
+
+    // Mirrors PointLightShadow in PointShadowCommon.glsl.
+    struct PointLightShadow
+    {
+        glm::mat4 viewToFace[ShadowAtlas::c_faceCount];
+        glm::vec4 faceBounds[ShadowAtlas::c_faceCount];
+    };
+
+    // Targets the ambient occlusion passes create and store to. They only get handles when their pass' setup runs, and the
+    // execute callbacks, made before that, outlive AddAmbientOcclusionPasses(), so they share these.
+    struct AmbientOcclusionTargets
+    {
+        FrameGraphResource normal;
+        FrameGraphResource blurred[2];
+    };
+
+    // The same for the depth of field passes: the fields as prepared, blurred along x, then along y.
+    struct DepthOfFieldTargets
+    {
+        DepthOfFieldResources fields[3];
+    };
+
+    // And the bloom chain, each level on its way down and on its way back up.
+    struct BloomTargets
+    {
+        FrameGraphResource downsampled[c_bloomLevels];
+        FrameGraphResource upsampled[c_bloomLevels];
+    };
+
+    // [-1, 1] scaled and biased to [0, 1], for matrices that go straight to shadow map coordinates.
+    const glm::mat4 c_textureBias(0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.0f, 0.5f, 0.5f, 0.5f, 1.0f);
+
+    // Pixel rectangle (x, y, width, height) around a view space sphere's projection. The sphere's bounding box is cut off at the
+    // near plane before its corners are projected, so a sphere around the eye still gets a finite rectangle: the whole viewport.
+    glm::ivec4 GetScissorRect(const glm::vec4& positionAndRadius, const glm::mat4& perspective, float nearPlane, uint32_t width, uint32_t height)
+    {
+        glm::vec3 boxMin = glm::vec3(positionAndRadius) - positionAndRadius.w;
+        glm::vec3 boxMax = glm::vec3(positionAndRadius) + positionAndRadius.w;
+        boxMax.z = glm::min(boxMax.z, -nearPlane);
+
+        glm::vec2 ndcMin(1.0f), ndcMax(-1.0f);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            glm::vec4 corner(((i & 1) != 0) ? boxMax.x : boxMin.x, ((i & 2) != 0) ? boxMax.y : boxMin.y, ((i & 4) != 0) ? boxMax.z : boxMin.z, 1.0f);
+            glm::vec4 clip = perspective * corner;
+            ndcMin = glm::min(ndcMin, glm::vec2(clip) / clip.w);
+            ndcMax = glm::max(ndcMax, glm::vec2(clip) / clip.w);
+        }
+
+        glm::vec2 size(width, height);
+        glm::ivec2 rectMin = glm::ivec2(glm::floor(glm::clamp((ndcMin * 0.5f) + 0.5f, 0.0f, 1.0f) * size));
+        glm::ivec2 rectMax = glm::ivec2(glm::ceil(glm::clamp((ndcMax * 0.5f) + 0.5f, 0.0f, 1.0f) * size));
+        return glm::ivec4(rectMin, rectMax - rectMin);
+    }
+
+    uint64_t GetResidentTextureHandle(GLType_uint texture)
+    {
+        if (texture == 0)
+            return 0;
+
+        GLuint64 handle = glGetTextureHandleARB(texture);
+        if (!glIsTextureHandleResidentARB(handle))
+            glMakeTextureHandleResidentARB(handle);
+        return handle;
+    }
 }
 
 GLRenderer::GLRenderer(uint32_t width, uint32_t height, float nearPlaneDistance, float farPlaneDistance)
     : m_width(width),
     m_height(height),
+    m_outputWidth(width),
+    m_outputHeight(height),
+    m_renderTargetWidth(width),
+    m_renderTargetHeight(height),
+    m_resolutionScale(1.0f),
     m_farPlane(farPlaneDistance),
     m_nearPlane(nearPlaneDistance),
     m_randomNormalTexture(0),
     m_randomScalarTexture(0),
-    m_depthTexture(0),
-    m_normalTexture(0),
-    m_positionTexture(0),
-    m_colorTexture(0),
-    m_postTexture(0),
     m_passProg(),
     m_pointProg(),
     m_directionalProg(),
     m_diagnosticProg(),
     m_postProg(),
+    m_visibilityProg(),
+    m_visibilityResolveProg(),
+    m_lightingDownsampleProg(),
+    m_lightingUpsampleProg(),
+    m_tiledLightingProg(),
+    m_clusteredLightingProg(),
+    m_lightVolumeProg(),
+    m_singlePassLightingProg(),
+    m_lightStencilProg(),
+    m_depthCopyProg(),
+    m_shadowProg(),
+    m_pointShadowProg(),
+    m_aoDownsampleProg(),
+    m_ambientOcclusionProg(),
+    m_aoBlurProg(),
+    m_depthPyramidProg(),
+    m_colourPyramidProg(),
+    m_dofPrepareProg(),
+    m_dofBlurProg(),
+    m_bloomDownsampleProg(),
+    m_bloomUpsampleProg(),
+    m_toonEnabled(false),
+    m_DOFEnabled(false),
+    m_DOFDebug(false),
+    m_focusPoint(0.5f),
+    m_focusTarget(-1.0f),
+    m_focalDistance(farPlaneDistance),
+    m_bloomEnabled(false),
+    m_lightingResolutionDivisor(1),
+    m_lightingPath(RenderEnums::LIGHTING_QUADS),
+    m_scissorEnabled(true),
+    m_singlePassLightLimit(256),
+    m_directionalLightDirection(glm::normalize(glm::vec3(0.0f, 1.0f, 1.0f))),
+    m_shadowsEnabled(true),
+    m_shadowDistance(300.0f),
+    m_shadowMap(0),
+    m_staticShadowMap(0),
+    m_pointShadowAtlas(0),
+    m_pointShadowFramebuffer(0),
+    m_pointShadowFaceBuffer(0),
+    m_pointShadowBuffer(0),
+    m_pointShadowsHadDynamicCasters(false),
+    m_ambientOcclusionEnabled(true),
+    m_aoRadius(2.0f),
+    m_aoBudget(1.0f),
+    m_aoSampleCount(c_maxAOSampleCount / 2),
+    m_aoFrameIndex(0),
+    m_aoHistoryWidth(0),
+    m_aoHistoryHeight(0),
+    m_aoHistoryIndex(0),
+    m_aoHistoryValid(false),
+    m_aoHistoryViewportScale(0.0f),
+    m_visibilityBufferSupported(false),
+    m_visibilityBufferEnabled(false),
+    m_maxTrianglesPerDraw(0),
+    m_sceneVertexBuffer(0),
+    m_sceneIndexBuffer(0),
+    m_drawDataBuffer(0),
+    m_sceneBuffersDirty(false),
+    m_lightBuffer(0),
+    m_clusterRangeBuffer(0),
+    m_clusterIndexBuffer(0),
     m_currentProgram(nullptr),
     m_perFrameConstBufIndex(0)
 {
     m_invWidth = 1.0f / m_width;
     m_invHeight = 1.0f / m_height;
 
+    for (uint32_t cascade = 0; cascade < ShadowCascades::c_cascadeCount; ++cascade)
+    {
+        m_shadowFramebuffers[cascade] = 0;
+        m_shadowLayerHasDynamicCasters[cascade] = false;
+    }
+    for (uint32_t layer = 0; layer < ShadowCascades::c_cachedCascadeCount; ++layer)
+        m_staticShadowFramebuffers[layer] = 0;
+    m_aoHistory[0] = m_aoHistory[1] = 0;
+    m_shadowCascades.SetLightDirection(m_directionalLightDirection);
+
     try
     {
         m_spShaderConstantManager = ShaderConstantManager::Create();
+        m_spShaderLibrary = ShaderLibrary::Create();
     }
     catch (std::bad_alloc&)
     {
@@ -49,7 +246,23 @@ GLRenderer::GLRenderer(uint32_t width, uint32_t height, float nearPlaneDistance,
 }
 
 GLRenderer::~GLRenderer()
-{}
+{
+    glDeleteBuffers(1, &m_sceneVertexBuffer);
+    glDeleteBuffers(1, &m_sceneIndexBuffer);
+    glDeleteBuffers(1, &m_drawDataBuffer);
+    glDeleteBuffers(1, &m_lightBuffer);
+    glDeleteBuffers(1, &m_clusterRangeBuffer);
+    glDeleteBuffers(1, &m_clusterIndexBuffer);
+    glDeleteFramebuffers(ShadowCascades::c_cascadeCount, m_shadowFramebuffers);
+    glDeleteFramebuffers(ShadowCascades::c_cachedCascadeCount, m_staticShadowFramebuffers);
+    glDeleteTextures(1, &m_shadowMap);
+    glDeleteTextures(1, &m_staticShadowMap);
+    glDeleteFramebuffers(1, &m_pointShadowFramebuffer);
+    glDeleteTextures(1, &m_pointShadowAtlas);
+    glDeleteBuffers(1, &m_pointShadowFaceBuffer);
+    glDeleteBuffers(1, &m_pointShadowBuffer);
+    glDeleteTextures(2, m_aoHistory);
+}
 
 DrawableGeometry::DrawableGeometry()
     : vertex_buffer(),
@@ -57,7 +270,11 @@ DrawableGeometry::DrawableGeometry()
     num_indices(),
     diffuse_tex(),
     normal_tex(),
-    specular_tex()
+    specular_tex(),
+    first_scene_index(UINT32_MAX),
+    diffuse_handle(0),
+    normal_handle(0),
+    isDynamic(false)
 {}
 
 DrawableGeometry::~DrawableGeometry()
@@ -106,24 +323,24 @@ void GLRenderer::ApplyPerFrameShaderConstants()
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.uiScreenWidth, m_perFrameConstBufIndex, &m_width);
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufInvScrHeight, m_perFrameConstBufIndex, &m_invHeight);
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufInvScrWidth, m_perFrameConstBufIndex, &m_invWidth);
-    //glUniform1f(glGetUniformLocation(m_postProg, "ufMouseTexX"), mouse_dof_x*m_invWidth);
-    //glUniform1f(glGetUniformLocation(m_postProg, "ufMouseTexY"), abs(static_cast<int32_t>(m_height)-mouse_dof_y)*m_invHeight);
+    float viewportScaleX = static_cast<float>(m_width) / m_renderTargetWidth;
+    float viewportScaleY = static_cast<float>(m_height) / m_renderTargetHeight;
+    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufViewportScaleX, m_perFrameConstBufIndex, &viewportScaleX);
+    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufViewportScaleY, m_perFrameConstBufIndex, &viewportScaleY);
+    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufMouseTexX, m_perFrameConstBufIndex, &m_focusPoint.x);
+    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufMouseTexY, m_perFrameConstBufIndex, &m_focusPoint.y);
 
     glm::mat4 view = m_spRenderCam->GetView();
     glm::mat4 persp = m_spRenderCam->GetPerspective();
+    glm::mat4 invPersp = m_spRenderCam->GetInversePerspective();
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.um4View, m_perFrameConstBufIndex, &view);
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.um4Persp, m_perFrameConstBufIndex, &persp);
+    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.um4InvPersp, m_perFrameConstBufIndex, &invPersp);
 
     float zero = 0.0f;
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ufGlowmask, m_perFrameConstBufIndex, &zero);
 
-    int32_t value = 0;
-    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ubBloomOn, m_perFrameConstBufIndex, &value/*m_bloomEnabled*/);
-    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ubToonOn, m_perFrameConstBufIndex, &value/*m_toonEnabled*/);
-    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ubDOFOn, m_perFrameConstBufIndex, &value/*m_DOFEnabled*/);
-    m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.ubDOFDebug, m_perFrameConstBufIndex, &value/*m_DOFDebug*/);
-
-    value = m_displayType;
+    int32_t value = m_displayType;
     m_spShaderConstantManager->SetShaderConstant(perFrameShaderConstants.uiDisplayType, m_perFrameConstBufIndex, &value);
 }
 
@@ -145,6 +362,21 @@ void GLRenderer::BindIndexBuffer(GLType_uint indexBuffer)
     }
 }
 
+bool GLRenderer::CanUseVisibilityBuffer() const
+{
+    if (!m_visibilityBufferSupported || m_opaqueList.empty() || (m_opaqueList.size() > c_maxVisibilityDraws) || 
+        (m_maxTrianglesPerDraw > (1u << c_visibilityTriangleBits)))
+        return false;
+
+    for (const DrawableGeometry* geometry : m_opaqueList)
+    {
+        if (geometry->first_scene_index == UINT32_MAX)
+            return false;   // Not made by MakeDrawableModel(), so it isn't in the scene buffers.
+    }
+
+    return true;
+}
+
 void GLRenderer::ClearFramebuffer(RenderEnums::ClearType clearFlags)
 {
     GLenum flags = 0;
@@ -199,13 +431,38 @@ std::weak_ptr<VertexSpecification> GLRenderer::CreateVertexSpecification(const s
     return m_vertexSpecifications[vertSpecNameHash];
 }
 
+void GLRenderer::Dispatch(GLProgram* computeProgram, uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ, uint32_t barriersAfter)
+{
+    SetShaderProgram(computeProgram);
+    m_currentProgram->CommitConstantBufferChanges();
+    m_currentProgram->CommitTextureBindings();
+    m_currentProgram->CommitStorageBufferBindings();
+    m_currentProgram->CommitImageBindings();
+
+    glDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
+    IssueMemoryBarrier(barriersAfter);
+}
+
+void GLRenderer::DispatchIndirect(GLProgram* computeProgram, GLType_uint indirectBuffer, uint32_t offset, uint32_t barriersAfter)
+{
+    SetShaderProgram(computeProgram);
+    m_currentProgram->CommitConstantBufferChanges();
+    m_currentProgram->CommitTextureBindings();
+    m_currentProgram->CommitStorageBufferBindings();
+    m_currentProgram->CommitImageBindings();
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectBuffer);
+    glDispatchComputeIndirect(static_cast<GLintptr>(offset));
+    IssueMemoryBarrier(barriersAfter);
+}
+
 void GLRenderer::DrawAlphaMaskedList()
 {
     glDepthMask(GL_FALSE);
     glDepthMask(GL_TRUE);
 }
 
-void GLRenderer::DrawGeometry(const DrawableGeometry* geom)
+void GLRenderer::DrawGeometry(const DrawableGeometry* geom, uint32_t instanceCount)
 {
     assert(m_currentProgram != nullptr);
     m_currentProgram->CommitTextureBindings();
@@ -214,73 +471,136 @@ void GLRenderer::DrawGeometry(const DrawableGeometry* geom)
     BindVertexBuffer(geom->vertex_buffer);
     BindIndexBuffer(geom->index_buffer);
 
-    glDrawElements(GL_TRIANGLES, geom->num_indices, GL_UNSIGNED_INT, 0);
+    if (instanceCount == 1)
+        glDrawElements(GL_TRIANGLES, geom->num_indices, GL_UNSIGNED_INT, 0);
+    else
+        glDrawElementsInstanced(GL_TRIANGLES, geom->num_indices, GL_UNSIGNED_INT, 0, instanceCount);
 }
 
-void GLRenderer::drawLight(glm::vec3 pos, float strength)
+void GLRenderer::DrawLightList(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* pointProgram)
 {
-    glm::vec4 light = m_spRenderCam->GetView() * glm::vec4(pos, 1.0);
-    if ((light.z - strength) > -m_nearPlane) // strength = radius.
-    {
+    if (m_visibleLights.empty())
         return;
-    }
-    light.w = strength;
-
-    using ShaderResourceReferences::lightPassShaderConstants;
-    m_currentProgram->SetShaderConstant(lightPassShaderConstants.uf4Light, light);
-    m_currentProgram->SetShaderConstant(lightPassShaderConstants.ufLightIl, strength);
-
-    //glm::vec4 left = vp * glm::vec4(pos + radius*m_spRenderCam->start_left, 1.0);
-    //glm::vec4 up = vp * glm::vec4(pos + radius*m_spRenderCam->up, 1.0);
-    //glm::vec4 center = vp * glm::vec4(pos, 1.0);
-
-    //left = sc * left;
-    //up = sc * up;
-    //center = sc * center;
 
-    //left /= left.w;
-    //up /= up.w;
-    //center /= center.w;
+    SetShaderProgram(pointProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    pointProgram->SetStorageBuffer(ShaderResourceReferences::lightPassResources.LightList, m_lightBuffer);
+    SetPointShadowResources(pointProgram);
+    pointProgram->CommitStorageBufferBindings();
 
-    //float hw = glm::distance(left, center);
-    //float hh = glm::distance(up, center);
+    // Every visible light in one draw; point.vert fits each instance's quad around its light.
+    glDepthMask(GL_FALSE);
+    DrawGeometry(&m_QuadGeometry, static_cast<uint32_t>(m_visibleLights.size()));
+    glDepthMask(GL_TRUE);
+}
 
-    //float r = (hh > hw) ? hh : hw;
+void GLRenderer::DrawClusteredLights(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* clusteredLightingProgram)
+{
+    if (m_visibleLights.empty())
+        return;
 
-    //float x = center.x - r;
-    //float y = center.y - r;
+    SetShaderProgram(clusteredLightingProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    SetLightClusterResources(clusteredLightingProgram);
 
-    //glScissor(x, y, 2 * r, 2 * r);
+    glDepthMask(GL_FALSE);
     RenderQuad();
+    glDepthMask(GL_TRUE);
 }
 
-void GLRenderer::DrawLightList()
+void GLRenderer::DrawLightVolumes(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* lightVolumeProgram)
 {
-    SetShaderProgram(m_pointProg.get());
-    SetTexturesForFullScreenPass();
+    if (m_visibleLights.empty())
+        return;
 
-    m_pointProg->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Colortex, m_colorTexture);
+    // The stencil test needs a depth/stencil target with the scene's depth in it.
+    SetShaderProgram(m_depthCopyProg.get());
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_ALWAYS);
+    RenderQuad();
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+
+    SetShaderProgram(lightVolumeProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    lightVolumeProgram->SetStorageBuffer(ShaderResourceReferences::lightPassResources.LightList, m_lightBuffer);
+    SetPointShadowResources(lightVolumeProgram);
+    lightVolumeProgram->CommitStorageBufferBindings();
+
+    glEnable(GL_STENCIL_TEST);
+    if (m_scissorEnabled)
+        glEnable(GL_SCISSOR_TEST);
 
     using ShaderResourceReferences::lightPassShaderConstants;
-    m_pointProg->SetShaderConstant(lightPassShaderConstants.uf3LightCol, Colours::yellow);
-    glDepthMask(GL_FALSE);
-    drawLight(glm::vec3(5.4, -0.5, 3.0), 1.0);
-    drawLight(glm::vec3(0.2, -0.5, 3.0), 1.0);
-    m_pointProg->SetShaderConstant(lightPassShaderConstants.uf3LightCol, Colours::orange);
-    drawLight(glm::vec3(5.4, -2.5, 3.0), 1.0);
-    drawLight(glm::vec3(0.2, -2.5, 3.0), 1.0);
-    m_pointProg->SetShaderConstant(lightPassShaderConstants.uf3LightCol, Colours::yellow);
-    drawLight(glm::vec3(5.4, -4.5, 3.0), 1.0);
-    drawLight(glm::vec3(0.2, -4.5, 3.0), 1.0);
-
-    m_pointProg->SetShaderConstant(lightPassShaderConstants.uf3LightCol, Colours::red);
-    drawLight(glm::vec3(2.5, -1.2, 0.5), 2.5);
-
-    m_pointProg->SetShaderConstant(lightPassShaderConstants.uf3LightCol, Colours::blue);
-    drawLight(glm::vec3(2.5, -5.0, 4.2), 2.5);
+    glm::mat4 perspective = m_spRenderCam->GetPerspective();
+    for (uint32_t light = 0; light < m_visibleLights.size(); ++light)
+    {
+        const glm::vec4& positionAndRadius = m_visibleLights[light].positionAndRadius;
+        if (m_scissorEnabled)
+        {
+            glm::ivec4 scissorRect = GetScissorRect(positionAndRadius, perspective, m_nearPlane, m_width, m_height);
+            if ((scissorRect.z <= 0) || (scissorRect.w <= 0))
+                continue;
+            glScissor(scissorRect.x, scissorRect.y, scissorRect.z, scissorRect.w);
+        }
+
+        // Once the near plane cuts into the sphere it covers most of the screen, and marking it first only adds a pass. Its
+        // back faces are shaded within the scissor rectangle instead, and the falloff does the rest.
+        bool cameraInside = glm::length(glm::vec3(positionAndRadius)) < (positionAndRadius.w + m_nearPlane);
+        if (!cameraInside)
+        {
+            // Depth fail: back faces behind the scene increment, front faces behind it decrement. Whatever is left non-zero
+            // is a surface between the two, inside the sphere. The front faces may be clipped away; the count still holds.
+            SetShaderProgram(m_lightStencilProg.get());
+            m_lightStencilProg->SetShaderConstant(lightPassShaderConstants.uiLightIndex, light);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glEnable(GL_DEPTH_TEST);
+            glStencilFunc(GL_ALWAYS, 0, 0xFF);
+            glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+            glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+            glDisable(GL_CULL_FACE);
+            DrawGeometry(&m_SphereGeometry);
+        }
+
+        // Back faces, so the shading pass still runs with the eye inside the sphere. Marked pixels are cleared as they're
+        // shaded, which leaves the stencil at zero for the next light.
+        SetShaderProgram(lightVolumeProgram);
+        lightVolumeProgram->SetShaderConstant(lightPassShaderConstants.uiLightIndex, light);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        if (cameraInside)
+            glDisable(GL_STENCIL_TEST);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        DrawGeometry(&m_SphereGeometry);
+        glCullFace(GL_BACK);
+        glEnable(GL_STENCIL_TEST);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
 }
 
+void GLRenderer::DrawShadowCasters(const glm::mat4& viewProjection, bool dynamicCasters)
+{
+    using ShaderResourceReferences::shadowPassShaderConstants;
+    for (const DrawableGeometry* geometry : m_opaqueList)
+    {
+        if (geometry->isDynamic != dynamicCasters)
+            continue;
+
+        m_shadowProg->SetShaderConstant(shadowPassShaderConstants.um4ShadowModelViewProj, viewProjection * geometry->modelMat);
+        DrawGeometry(geometry);
+    }
+}
+
 void GLRenderer::DrawOpaqueList()
 {
     glm::mat4 inverseView = m_spRenderCam->GetInverseView();
@@ -305,119 +625,70 @@ void GLRenderer::DrawOpaqueList()
     glBindVertexArray(0);
 }
 
+void GLRenderer::DrawVisibilityList()
+{
+    SetShaderProgram(m_visibilityProg.get());
+    m_visibilityProg->SetStorageBuffer(ShaderResourceReferences::visibilityPassResources.DrawDataList, m_drawDataBuffer);
+    m_visibilityProg->CommitStorageBufferBindings();
+
+    // Transforms live in the draw data, so the draw index is all that changes between draws.
+    using ShaderResourceReferences::visibilityPassShaderConstants;
+    for (uint32_t i = 0; i < m_opaqueList.size(); ++i)
+    {
+        m_visibilityProg->SetShaderConstant(visibilityPassShaderConstants.uiDrawID, static_cast<int32_t>(i));
+        DrawGeometry(m_opaqueList[i]);
+    }
+    glBindVertexArray(0);
+}
+
 void GLRenderer::DrawTransparentList()
 {
 
 }
 
-void GLRenderer::EndActiveFramebuffer()
+void GLRenderer::IssueMemoryBarrier(uint32_t barriers)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (barriers == RenderEnums::BARRIER_NONE)
+        return;
+
+    GLbitfield barrierBits = 0;
+    if (barriers & RenderEnums::BARRIER_STORAGE_BUFFER)
+        barrierBits |= GL_SHADER_STORAGE_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_IMAGE_ACCESS)
+        barrierBits |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_TEXTURE_FETCH)
+        barrierBits |= GL_TEXTURE_FETCH_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_INDIRECT_COMMAND)
+        barrierBits |= GL_COMMAND_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_VERTEX_ATTRIB)
+        barrierBits |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_BUFFER_UPDATE)
+        barrierBits |= GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT;
+    if (barriers & RenderEnums::BARRIER_FRAMEBUFFER)
+        barrierBits |= GL_FRAMEBUFFER_BARRIER_BIT;
+
+    glMemoryBarrier(barrierBits);
 }
 
 void GLRenderer::InitFramebuffers()
 {
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_depthTexture);
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_normalTexture);
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_positionTexture);
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_colorTexture);
+    // Render targets themselves are declared per frame in SetupFrameGraph(); the pool creates them on first use and recycles them after.
+    try
+    {
+        m_renderTargetPool = std::make_unique<RenderTargetPool>();
+        m_frameGraph = std::make_unique<FrameGraph>(*m_renderTargetPool);
+        m_dynamicResolution = std::make_unique<DynamicResolution>(c_minResolutionScale, c_maxResolutionScale);
+        m_aoTimer = std::make_unique<PassTimer>();
+        m_readback = std::make_unique<AsyncReadback>();
+    }
+    catch (std::bad_alloc&)
+    {
+        assert(false); // Out of memory.
+    }
 
+    m_frameGraph->SetBackbufferSize(m_outputWidth, m_outputHeight);
+    UpdateRenderResolution();
     glEnable(GL_FRAMEBUFFER_SRGB);
-
-    //Set up depth texture
-    glTextureParameteri(m_depthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_depthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameterf(m_depthTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameterf(m_depthTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-//    glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_DEPTH_COMPONENT);
-    glTextureStorage2D(m_depthTexture, 1, GL_DEPTH_COMPONENT32, m_width, m_height);
-    glTextureSubImage2D(m_depthTexture, 0, 0, 0, m_width, m_height, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
-
-    //Set up normal texture
-    glTextureParameteri(m_normalTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_normalTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameterf(m_normalTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameterf(m_normalTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureStorage2D(m_normalTexture, 1, GL_RGBA8, m_width, m_height);
-    glTextureSubImage2D(m_normalTexture, 0, 0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, 0);
-
-    //Set up position texture
-    glTextureParameteri(m_positionTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_positionTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameterf(m_positionTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameterf(m_positionTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureStorage2D(m_positionTexture, 1, GL_RGBA8, m_width, m_height);
-    glTextureSubImage2D(m_positionTexture, 0, 0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, 0);
-
-    //Set up color texture
-    glTextureParameteri(m_colorTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(m_colorTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameterf(m_colorTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameterf(m_colorTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureStorage2D(m_colorTexture, 1, GL_RGBA8, m_width, m_height);
-    glTextureSubImage2D(m_colorTexture, 0, 0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, 0);
-
-    GLType_uint fbo = 0;
-    glCreateFramebuffers(1, &fbo);
-
-    GLType_int normal_loc;
-    if (!m_passProg->GetOutputBindLocation("out_f4Normal", reinterpret_cast<GLType_uint&>(normal_loc)))
-        assert(false);
-    GLType_int position_loc;
-    if (!m_passProg->GetOutputBindLocation("out_f4Position", reinterpret_cast<GLType_uint&>(position_loc)))
-        assert(false);
-    GLType_int color_loc;
-    if (!m_passProg->GetOutputBindLocation("out_f4Colour", reinterpret_cast<GLType_uint&>(color_loc)))
-        assert(false);
-
-    GLenum draws[3];
-    draws[normal_loc] = GL_COLOR_ATTACHMENT0;
-    draws[position_loc] = GL_COLOR_ATTACHMENT1;
-    draws[color_loc] = GL_COLOR_ATTACHMENT2;
-    glNamedFramebufferDrawBuffers(fbo, 3, draws);
-
-    // attach the texture to FBO depth attachment point
-    glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, m_depthTexture, 0);
-    glNamedFramebufferTexture(fbo, draws[normal_loc], m_normalTexture, 0);
-    glNamedFramebufferTexture(fbo, draws[position_loc], m_positionTexture, 0);
-    glNamedFramebufferTexture(fbo, draws[color_loc], m_colorTexture, 0);
-
-    // check FBO status
-    GLenum FBOstatus = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
-    if (FBOstatus == GL_FRAMEBUFFER_COMPLETE)
-        m_FBO.push_back(fbo);
-    else
-        assert(false);
-
-    //Post Processing buffer!
-    //Set up post texture
-    glCreateTextures(GL_TEXTURE_2D, 1, &m_postTexture);
-    glTextureParameteri(m_postTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTextureParameteri(m_postTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTextureParameterf(m_postTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTextureParameterf(m_postTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTextureStorage2D(m_postTexture, 1, GL_SRGB8, m_width, m_height);
-    glTextureSubImage2D(m_postTexture, 0, 0, 0, m_width, m_height, GL_RGB, GL_FLOAT, 0);
-
-    // create a framebuffer object
-    fbo = 0;
-    glCreateFramebuffers(1, &fbo);
-
-    if (!m_directionalProg->GetOutputBindLocation("out_f4Colour", reinterpret_cast<GLType_uint&>(color_loc)))
-        assert(false);
-    GLenum draw[1];
-    draw[color_loc] = GL_COLOR_ATTACHMENT0;
-    glNamedFramebufferDrawBuffers(fbo, 1, draw);
-
-    // attach the texture to FBO depth attachment point
-    glNamedFramebufferTexture(fbo, draw[color_loc], m_postTexture, 0);
-
-    // check FBO status
-    FBOstatus = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
-    if (FBOstatus == GL_FRAMEBUFFER_COMPLETE)
-        m_FBO.push_back(fbo);
-    else
-        assert(false);
 }
 
 void GLRenderer::Initialize(const std::shared_ptr<Camera>& renderCamera)
@@ -427,6 +698,7 @@ void GLRenderer::Initialize(const std::shared_ptr<Camera>& renderCamera)
     InitFramebuffers();
     InitQuad();
     InitSphere();
+    InitShadowMaps();
 
     m_spRenderCam = renderCamera;
     glDepthFunc(GL_LEQUAL);
@@ -496,16 +768,39 @@ void GLRenderer::InitShaders()
 {
     const char * pass_vert = "../res/shaders/pass.vert";
     const char * shade_vert = "../res/shaders/shade.vert";
-    const char * post_vert = "../res/shaders/post.vert";
+    const char * point_vert = "../res/shaders/point.vert";
+    const char * shadow_vert = "../res/shaders/shadow.vert";
+    const char * point_shadow_vert = "../res/shaders/point_shadow.vert";
 
     const char * pass_frag = "../res/shaders/pass.frag";
     const char * diagnostic_frag = "../res/shaders/diagnostic.frag";
     const char * ambient_frag = "../res/shaders/ambient.frag";
     const char * point_frag = "../res/shaders/point.frag";
-    const char * post_frag = "../res/shaders/post.frag";
+    const char * lighting_downsample_frag = "../res/shaders/lighting_downsample.frag";
+    const char * lighting_upsample_frag = "../res/shaders/lighting_upsample.frag";
+    const char * clustered_lighting_frag = "../res/shaders/clustered_lighting.frag";
+    const char * light_volume_vert = "../res/shaders/light_volume.vert";
+    const char * light_volume_frag = "../res/shaders/light_volume.frag";
+    const char * stencil_frag = "../res/shaders/stencil.frag";
+    const char * depth_copy_frag = "../res/shaders/depth_copy.frag";
+    const char * single_pass_lighting_frag = "../res/shaders/single_pass_lighting.frag";
+    const char * tiled_lighting_comp = "../res/shaders/tiled_lighting.comp";
+    const char * visibility_vert = "../res/shaders/visibility.vert";
+    const char * visibility_frag = "../res/shaders/visibility.frag";
+    const char * visibility_resolve_frag = "../res/shaders/visibility_resolve.frag";
+    const char * ao_downsample_comp = "../res/shaders/ao_downsample.comp";
+    const char * ambient_occlusion_comp = "../res/shaders/ambient_occlusion.comp";
+    const char * ao_blur_comp = "../res/shaders/ao_blur.comp";
+    const char * depth_pyramid_comp = "../res/shaders/depth_pyramid.comp";
+    const char * colour_pyramid_comp = "../res/shaders/colour_pyramid.comp";
+    const char * dof_prepare_comp = "../res/shaders/dof_prepare.comp";
+    const char * dof_blur_comp = "../res/shaders/dof_blur.comp";
+    const char * bloom_downsample_comp = "../res/shaders/bloom_downsample.comp";
+    const char * bloom_upsample_comp = "../res/shaders/bloom_upsample.comp";
+    const char * post_comp = "../res/shaders/post.comp";
 
     std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>> shaderSourceAndStagePair;
-    std::map<std::string, GLType_uint> meshAttributeBindIndices, quadAttributeBindIndices, outputBindIndices;
+    std::map<std::string, GLType_uint> meshAttributeBindIndices, quadAttributeBindIndices, outputBindIndices, visibilityOutputBindIndices, downsampleOutputBindIndices;
 
     meshAttributeBindIndices["in_f3Position"] = 0;
     meshAttributeBindIndices["in_f3Normal"] = 1;
@@ -516,41 +811,232 @@ void GLRenderer::InitShaders()
     quadAttributeBindIndices["in_f2Texcoord"] = 1;
 
     outputBindIndices["out_f4Colour"] = 0;
-    outputBindIndices["out_f4Normal"] = 1;
-    outputBindIndices["out_f4Position"] = 2;
+    outputBindIndices["out_f2Normal"] = 1;
+
+    visibilityOutputBindIndices["out_uVisibility"] = 0;
+
+    downsampleOutputBindIndices["out_fDepth"] = 0;
+    downsampleOutputBindIndices["out_f2Normal"] = 1;
+
+    std::vector<std::string> lightingKeywords, pointKeywords, postKeywords;
+    lightingKeywords.push_back("TOON");
+    pointKeywords = lightingKeywords;
+    pointKeywords.push_back("HALF_RES");
+    postKeywords.push_back("TOON");
+    postKeywords.push_back("DOF");
+    postKeywords.push_back("DOF_DEBUG");
+    postKeywords.push_back("BLOOM");
+
+    // Let the driver compile on as many threads as it likes; compiles and links below are only submitted, not waited on.
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
 
     try
     {
         shaderSourceAndStagePair.clear();
         shaderSourceAndStagePair.push_back(std::make_pair(pass_vert, RenderEnums::VERT));
         shaderSourceAndStagePair.push_back(std::make_pair(pass_frag, RenderEnums::FRAG));
-        m_passProg = std::make_unique<GLProgram>(RenderEnums::RENDER_PROGRAM, shaderSourceAndStagePair, meshAttributeBindIndices, outputBindIndices);
+        m_passProg = SubmitProgram(shaderSourceAndStagePair, meshAttributeBindIndices, outputBindIndices);
 
         shaderSourceAndStagePair.clear();
         shaderSourceAndStagePair.push_back(std::make_pair(shade_vert, RenderEnums::VERT));
         shaderSourceAndStagePair.push_back(std::make_pair(diagnostic_frag, RenderEnums::FRAG));
-        m_diagnosticProg = std::make_unique<GLProgram>(RenderEnums::RENDER_PROGRAM, shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+        m_diagnosticProg = SubmitProgram(shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
 
         shaderSourceAndStagePair[1] = std::make_pair(ambient_frag, RenderEnums::FRAG);
-        m_directionalProg = std::make_unique<GLProgram>(RenderEnums::RENDER_PROGRAM, shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+        m_directionalProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, lightingKeywords, quadAttributeBindIndices, outputBindIndices);
 
+        shaderSourceAndStagePair[0] = std::make_pair(point_vert, RenderEnums::VERT);
         shaderSourceAndStagePair[1] = std::make_pair(point_frag, RenderEnums::FRAG);
-        m_pointProg = std::make_unique<GLProgram>(RenderEnums::RENDER_PROGRAM, shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+        m_pointProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, pointKeywords, quadAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[0] = std::make_pair(shade_vert, RenderEnums::VERT);
+        shaderSourceAndStagePair[1] = std::make_pair(lighting_downsample_frag, RenderEnums::FRAG);
+        m_lightingDownsampleProg = SubmitProgram(shaderSourceAndStagePair, quadAttributeBindIndices, downsampleOutputBindIndices);
+
+        shaderSourceAndStagePair[1] = std::make_pair(lighting_upsample_frag, RenderEnums::FRAG);
+        m_lightingUpsampleProg = SubmitProgram(shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[1] = std::make_pair(clustered_lighting_frag, RenderEnums::FRAG);
+        m_clusteredLightingProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, lightingKeywords, quadAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[1] = std::make_pair(single_pass_lighting_frag, RenderEnums::FRAG);
+        m_singlePassLightingProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, lightingKeywords, quadAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[1] = std::make_pair(depth_copy_frag, RenderEnums::FRAG);
+        m_depthCopyProg = SubmitProgram(shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[0] = std::make_pair(light_volume_vert, RenderEnums::VERT);
+        shaderSourceAndStagePair[1] = std::make_pair(light_volume_frag, RenderEnums::FRAG);
+        m_lightVolumeProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, lightingKeywords, meshAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[1] = std::make_pair(stencil_frag, RenderEnums::FRAG);
+        m_lightStencilProg = SubmitProgram(shaderSourceAndStagePair, meshAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[0] = std::make_pair(shadow_vert, RenderEnums::VERT);
+        m_shadowProg = SubmitProgram(shaderSourceAndStagePair, meshAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair[0] = std::make_pair(point_shadow_vert, RenderEnums::VERT);
+        m_pointShadowProg = SubmitProgram(shaderSourceAndStagePair, meshAttributeBindIndices, outputBindIndices);
+
+        shaderSourceAndStagePair.clear();
+        shaderSourceAndStagePair.push_back(std::make_pair(tiled_lighting_comp, RenderEnums::COMP));
+        m_tiledLightingProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, lightingKeywords, std::map<std::string, GLType_uint>(), std::map<std::string, GLType_uint>());
+
+        m_aoDownsampleProg = SubmitComputeProgram(ao_downsample_comp);
+        m_ambientOcclusionProg = SubmitComputeProgram(ambient_occlusion_comp);
+        m_aoBlurProg = SubmitComputeProgram(ao_blur_comp);
+        m_depthPyramidProg = SubmitComputeProgram(depth_pyramid_comp);
+        m_colourPyramidProg = SubmitComputeProgram(colour_pyramid_comp);
+        m_dofPrepareProg = SubmitComputeProgram(dof_prepare_comp);
+        m_dofBlurProg = SubmitComputeProgram(dof_blur_comp);
+        m_bloomDownsampleProg = SubmitComputeProgram(bloom_downsample_comp);
+        m_bloomUpsampleProg = SubmitComputeProgram(bloom_upsample_comp);
 
         shaderSourceAndStagePair.clear();
-        shaderSourceAndStagePair.push_back(std::make_pair(post_vert, RenderEnums::VERT));
-        shaderSourceAndStagePair.push_back(std::make_pair(post_frag, RenderEnums::FRAG));
-        m_postProg = std::make_unique<GLProgram>(RenderEnums::RENDER_PROGRAM, shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+        shaderSourceAndStagePair.push_back(std::make_pair(post_comp, RenderEnums::COMP));
+        m_postProg = std::make_unique<GLProgramVariants>(shaderSourceAndStagePair, postKeywords, std::map<std::string, GLType_uint>(), std::map<std::string, GLType_uint>());
+
+        // Without bindless textures the resolve shader doesn't compile, so don't bother with either.
+        m_visibilityBufferSupported = (GLEW_ARB_bindless_texture != 0);
+        if (m_visibilityBufferSupported)
+        {
+            shaderSourceAndStagePair.clear();
+            shaderSourceAndStagePair.push_back(std::make_pair(visibility_vert, RenderEnums::VERT));
+            shaderSourceAndStagePair.push_back(std::make_pair(visibility_frag, RenderEnums::FRAG));
+            m_visibilityProg = SubmitProgram(shaderSourceAndStagePair, meshAttributeBindIndices, visibilityOutputBindIndices);
+
+            shaderSourceAndStagePair.clear();
+            shaderSourceAndStagePair.push_back(std::make_pair(shade_vert, RenderEnums::VERT));
+            shaderSourceAndStagePair.push_back(std::make_pair(visibility_resolve_frag, RenderEnums::FRAG));
+            m_visibilityResolveProg = SubmitProgram(shaderSourceAndStagePair, quadAttributeBindIndices, outputBindIndices);
+        }
     }
     catch (std::bad_alloc&)
     {
         assert(false); // Out of memory.
     }
 
+    // The default display mode needs these for the first frame. The diagnostic program keeps compiling in the background and is
+    // finished by SetShaderProgram() if it gets used before it's ready.
+    m_passProg->Finish();
+    SelectVariant(*m_directionalProg)->Finish();
+    SelectVariant(*m_pointProg)->Finish();
+    SelectVariant(*m_postProg)->Finish();
+
+    // Toggling a feature shouldn't hitch, so every other combination compiles in the background as well.
+    m_directionalProg->SubmitAll();
+    m_pointProg->SubmitAll();
+    m_tiledLightingProg->SubmitAll();
+    m_clusteredLightingProg->SubmitAll();
+    m_lightVolumeProg->SubmitAll();
+    m_singlePassLightingProg->SubmitAll();
+    m_postProg->SubmitAll();
+
     m_perFrameConstBufIndex = Utility::HashCString("PerFrame");
     ShaderResourceReferences::Initialize();
 }
 
+std::unique_ptr<GLProgram> GLRenderer::SubmitProgram(const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, 
+    const std::map<std::string, GLType_uint>& attributeBindIndices, const std::map<std::string, GLType_uint>& outputBindIndices)
+{
+    std::unique_ptr<GLProgram> program = std::make_unique<GLProgram>();
+    for (const auto& itr : attributeBindIndices)
+        program->SetAttributeBindLocation(itr.first, itr.second);
+    for (const auto& itr : outputBindIndices)
+        program->SetOutputBindLocation(itr.first, itr.second);
+
+    program->Submit(RenderEnums::RENDER_PROGRAM, shaderSourceFiles);
+    return program;
+}
+
+std::unique_ptr<GLProgram> GLRenderer::SubmitComputeProgram(const std::string& computeShaderSourceFile)
+{
+    std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>> shaderSourceAndStagePair;
+    shaderSourceAndStagePair.push_back(std::make_pair(computeShaderSourceFile, RenderEnums::COMP));
+
+    std::unique_ptr<GLProgram> program = std::make_unique<GLProgram>();
+    program->Submit(RenderEnums::COMPUTE_PROGRAM, shaderSourceAndStagePair);
+    return program;
+}
+
+void GLRenderer::PollPendingPrograms()
+{
+    ReloadChangedShaders(false);
+
+    GLProgram* programs[] = { m_passProg.get(), m_diagnosticProg.get(), m_lightingDownsampleProg.get(), m_lightingUpsampleProg.get(),
+        m_lightStencilProg.get(), m_depthCopyProg.get(), m_shadowProg.get(), m_pointShadowProg.get(), m_visibilityProg.get(), m_visibilityResolveProg.get(),
+        m_aoDownsampleProg.get(), m_ambientOcclusionProg.get(), m_aoBlurProg.get(), m_depthPyramidProg.get(), m_colourPyramidProg.get(),
+        m_dofPrepareProg.get(), m_dofBlurProg.get(), m_bloomDownsampleProg.get(), m_bloomUpsampleProg.get() };
+    for (GLProgram* program : programs)
+    {
+        if (program)
+            program->Poll();    // Ready programs may have a reload in flight.
+    }
+
+    m_directionalProg->Poll();
+    m_pointProg->Poll();
+    m_tiledLightingProg->Poll();
+    m_clusteredLightingProg->Poll();
+    m_lightVolumeProg->Poll();
+    m_singlePassLightingProg->Poll();
+    m_postProg->Poll();
+}
+
+void GLRenderer::ReloadChangedShaders(bool forceCheck)
+{
+    std::vector<std::string> changedFiles = m_spShaderLibrary->PollChangedFiles(forceCheck);
+    if (changedFiles.empty())
+        return;
+
+    // Only programs that include a changed file are rebuilt. They keep rendering with the old code until the new one links,
+    // and nothing else (framebuffers, render targets, constant buffers) is touched.
+    for (const std::string& changedFile : changedFiles)
+    {
+        std::ostringstream debugOutput;
+        debugOutput << "Shader source changed: " << changedFile;
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+    }
+
+    GLProgram* programs[] = { m_passProg.get(), m_diagnosticProg.get(), m_lightingDownsampleProg.get(), m_lightingUpsampleProg.get(),
+        m_lightStencilProg.get(), m_depthCopyProg.get(), m_shadowProg.get(), m_pointShadowProg.get(), m_visibilityProg.get(), m_visibilityResolveProg.get(),
+        m_aoDownsampleProg.get(), m_ambientOcclusionProg.get(), m_aoBlurProg.get(), m_depthPyramidProg.get(), m_colourPyramidProg.get(),
+        m_dofPrepareProg.get(), m_dofBlurProg.get(), m_bloomDownsampleProg.get(), m_bloomUpsampleProg.get() };
+    for (GLProgram* program : programs)
+    {
+        if (program && program->DependsOn(changedFiles))
+            program->Reload();
+    }
+
+    GLProgramVariants* programVariants[] = { m_directionalProg.get(), m_pointProg.get(), m_tiledLightingProg.get(), m_clusteredLightingProg.get(), m_lightVolumeProg.get(), m_singlePassLightingProg.get(), m_postProg.get() };
+    for (GLProgramVariants* variants : programVariants)
+    {
+        if (variants->DependsOn(changedFiles))
+            variants->Reload();
+    }
+}
+
+GLProgram* GLRenderer::SelectVariant(GLProgramVariants& programVariants) const
+{
+    uint32_t keywordMask = 0;
+    if (m_toonEnabled)
+        keywordMask |= programVariants.GetKeywordMask("TOON");
+    if (m_DOFEnabled)
+    {
+        keywordMask |= programVariants.GetKeywordMask("DOF");
+        if (m_DOFDebug)
+            keywordMask |= programVariants.GetKeywordMask("DOF_DEBUG");
+    }
+    if (m_lightingResolutionDivisor > 1)
+        keywordMask |= programVariants.GetKeywordMask("HALF_RES");
+    if (m_bloomEnabled)
+        keywordMask |= programVariants.GetKeywordMask("BLOOM");
+
+    return programVariants.GetVariant(keywordMask);
+}
+
 void GLRenderer::InitSphere()
 {
     Geometry sphere;
@@ -561,21 +1047,28 @@ void GLRenderer::InitSphere()
     float thetaAdvance = 2 * pi * inverseDivisor;
     float phiAdvance = pi * inverseDivisor;
 
+    // Light volumes have to contain their light's whole sphere, so the mesh is pushed out until its flat faces, not just its
+    // vertices, reach radius 1.
+    const float coverScale = 1.0f / (cos(thetaAdvance * 0.5f) * cos(phiAdvance * 0.5f));
+
     for (uint32_t i = 0; i <= divisor; ++i)   // theta
     {
         for (uint32_t j = 0; j <= divisor; ++j)  // phi
         {
-            glm::vec3 positionNormal(sin(i * thetaAdvance) * sin(j * phiAdvance), cos(j * phiAdvance), cos(i * thetaAdvance) * sin(j * phiAdvance));
-            sphere.vertices.push_back(Vertex(positionNormal, positionNormal, glm::vec2(i * inverseDivisor, j * inverseDivisor)));
+            glm::vec3 normal(sin(i * thetaAdvance) * sin(j * phiAdvance), cos(j * phiAdvance), cos(i * thetaAdvance) * sin(j * phiAdvance));
+            sphere.vertices.push_back(Vertex(normal * coverScale, normal, glm::vec2(i * inverseDivisor, j * inverseDivisor)));
 
             if ((i < divisor) && (j < divisor))
             {
-                sphere.indices.push_back(j);
-                sphere.indices.push_back(((i + 1) * divisor + j));
-                sphere.indices.push_back(((i + 1) * divisor + (j + 1)));
-                sphere.indices.push_back(j);
-                sphere.indices.push_back(((i + 1) * divisor + (j + 1)));
-                sphere.indices.push_back(j + 1);
+                // Each row of constant theta holds divisor + 1 vertices. Counter-clockwise seen from outside.
+                uint32_t vertex = (i * (divisor + 1)) + j;
+                uint32_t nextThetaVertex = vertex + divisor + 1;
+                sphere.indices.push_back(vertex);
+                sphere.indices.push_back(nextThetaVertex + 1);
+                sphere.indices.push_back(nextThetaVertex);
+                sphere.indices.push_back(vertex);
+                sphere.indices.push_back(vertex + 1);
+                sphere.indices.push_back(nextThetaVertex + 1);
             }
         }
     }
@@ -611,6 +1104,58 @@ void GLRenderer::InitSphere()
     m_SphereGeometry.vertexSpecification = CreateVertexSpecification(sphereVertSpecName, sphereVertexAttribList, sizeof(Vertex));
 }
 
+void GLRenderer::InitShadowMaps()
+{
+    // Compared in hardware with linear filtering. Anything outside a cascade reads the border, i.e. as lit.
+    const float borderColour[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_shadowMap);
+    glTextureStorage3D(m_shadowMap, 1, GL_DEPTH_COMPONENT32F, ShadowCascades::c_resolution, ShadowCascades::c_resolution, ShadowCascades::c_cascadeCount);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTextureParameterfv(m_shadowMap, GL_TEXTURE_BORDER_COLOR, borderColour);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(m_shadowMap, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    // Only ever copied from, so it has no sampling state to speak of.
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_staticShadowMap);
+    glTextureStorage3D(m_staticShadowMap, 1, GL_DEPTH_COMPONENT32F, ShadowCascades::c_resolution, ShadowCascades::c_resolution, ShadowCascades::c_cachedCascadeCount);
+
+    // One depth-only framebuffer per layer.
+    glCreateFramebuffers(ShadowCascades::c_cascadeCount, m_shadowFramebuffers);
+    for (uint32_t cascade = 0; cascade < ShadowCascades::c_cascadeCount; ++cascade)
+    {
+        glNamedFramebufferTextureLayer(m_shadowFramebuffers[cascade], GL_DEPTH_ATTACHMENT, m_shadowMap, 0, cascade);
+        glNamedFramebufferDrawBuffer(m_shadowFramebuffers[cascade], GL_NONE);
+    }
+
+    glCreateFramebuffers(ShadowCascades::c_cachedCascadeCount, m_staticShadowFramebuffers);
+    for (uint32_t layer = 0; layer < ShadowCascades::c_cachedCascadeCount; ++layer)
+    {
+        glNamedFramebufferTextureLayer(m_staticShadowFramebuffers[layer], GL_DEPTH_ATTACHMENT, m_staticShadowMap, 0, layer);
+        glNamedFramebufferDrawBuffer(m_staticShadowFramebuffers[layer], GL_NONE);
+    }
+
+    // The point light atlas is drawn through one framebuffer over all of it; the vertex shader puts each face on its tile.
+    // Lookups never leave a tile, so there's no border to speak of.
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_pointShadowAtlas);
+    glTextureStorage2D(m_pointShadowAtlas, 1, GL_DEPTH_COMPONENT32F, ShadowAtlas::c_size, ShadowAtlas::c_size);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(m_pointShadowAtlas, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glCreateFramebuffers(1, &m_pointShadowFramebuffer);
+    glNamedFramebufferTexture(m_pointShadowFramebuffer, GL_DEPTH_ATTACHMENT, m_pointShadowAtlas, 0);
+    glNamedFramebufferDrawBuffer(m_pointShadowFramebuffer, GL_NONE);
+
+    glCreateBuffers(1, &m_pointShadowFaceBuffer);
+    glCreateBuffers(1, &m_pointShadowBuffer);
+}
+
 void GLRenderer::MakeDrawableModel(const Geometry& model, DrawableGeometry& out, const glm::mat4& modelMatrix)
 {
     CreateBuffersAndUploadData(model, out);
@@ -629,6 +1174,24 @@ void GLRenderer::MakeDrawableModel(const Geometry& model, DrawableGeometry& out,
     out.normal_tex = TextureManager::GetSingleton()->Acquire(model.normal_texpath);
     out.specular_tex = TextureManager::GetSingleton()->Acquire(model.specular_texpath);
 
+    if (m_visibilityBufferSupported)
+    {
+        // Keep a copy for the scene buffers; they are rebuilt from these the next time the visibility buffer is used.
+        uint32_t baseVertex = static_cast<uint32_t>(m_sceneVertices.size());
+        out.first_scene_index = static_cast<uint32_t>(m_sceneIndices.size());
+        m_sceneVertices.insert(m_sceneVertices.end(), model.vertices.begin(), model.vertices.end());
+        for (uint32_t index : model.indices)
+            m_sceneIndices.push_back(baseVertex + index);
+        m_sceneBuffersDirty = true;
+
+        uint32_t numTriangles = static_cast<uint32_t>(model.indices.size() / 3);
+        if (numTriangles > m_maxTrianglesPerDraw)
+            m_maxTrianglesPerDraw = numTriangles;
+
+        out.diffuse_handle = GetResidentTextureHandle(out.diffuse_tex);
+        out.normal_handle = GetResidentTextureHandle(out.normal_tex);
+    }
+
     out.modelMat = modelMatrix;
     out.inverseModelMat = glm::inverse(out.modelMat);
     out.color = model.color;
@@ -636,100 +1199,1397 @@ void GLRenderer::MakeDrawableModel(const Geometry& model, DrawableGeometry& out,
 
 void GLRenderer::Render()
 {
+    PollPendingPrograms();
+    m_readback->Poll();     // Focus, pick and capture callbacks for reads made a frame or two ago.
+
+    // The controller's scale comes from frames a few behind this one; changing it only moves viewports, nothing is reallocated.
+    if (m_dynamicResolution->IsEnabled() && (m_dynamicResolution->GetScale() != m_resolutionScale))
+    {
+        m_resolutionScale = m_dynamicResolution->GetScale();
+        UpdateRenderResolution();
+    }
+
+    m_dynamicResolution->BeginFrame();
     ApplyPerFrameShaderConstants();
+    UploadVisibleLights();
+    if ((m_lightingPath == RenderEnums::LIGHTING_CLUSTERED) || (m_displayType == RenderEnums::DISPLAY_LIGHT_CLUSTERS))
+        UploadLightClusters();
 
-    // GBuffer Pass
-    SetFramebufferActive(RenderEnums::GBUFFER_FRAMEBUFFER);
-    ClearFramebuffer(RenderEnums::CLEAR_ALL);
-    DrawOpaqueList();
-    DrawAlphaMaskedList();
-
-    // Lighting Pass
-    SetFramebufferActive(RenderEnums::LIGHTING_FRAMEBUFFER);
-    ClearFramebuffer(RenderEnums::CLEAR_ALL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE);
-    DrawLightList();
-    glDisable(GL_BLEND);
-    RenderDirectionalAndAmbientLighting();
-    EndActiveFramebuffer();
-
-    // Post Process Pass
-    ClearFramebuffer(RenderEnums::CLEAR_ALL);
-    glDisable(GL_DEPTH_TEST);
-    if (m_displayType != RenderEnums::DISPLAY_TOTAL)
-        RenderFramebuffers();
-    else
-        RenderPostProcessEffects();
-    glEnable(GL_DEPTH_TEST);
+    m_frameGraph->Reset();
+    SetupFrameGraph();
+    m_frameGraph->Compile();
+    m_frameGraph->Execute();
+
+    // The back buffer is only complete once every pass has run. A capture the ring refuses is tried again next frame.
+    if (m_pendingCapture)
+    {
+        CaptureCallback callback = m_pendingCapture;
+        uint32_t width = m_outputWidth, height = m_outputHeight;
+        if (m_readback->ReadFramebuffer(0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+            [callback, width, height](const void* data) { callback(width, height, static_cast<const uint8_t*>(data)); }))
+            m_pendingCapture = nullptr;
+    }
+
+    m_dynamicResolution->EndFrame();
+    m_renderTargetPool->EndFrame();
 }
 
-void GLRenderer::RenderDirectionalAndAmbientLighting()
+void GLRenderer::RenderShadowCascades()
 {
-    glm::vec4 dir_light(0.0, 1.0, 1.0, 0.0);
-    dir_light = m_spRenderCam->GetView() * dir_light;
-    dir_light = glm::normalize(dir_light);
-    dir_light.w = 1.0f; // strength
-    glm::vec3 ambient(0.04f);
+    // The cached depth only holds for the static casters it was drawn from.
+    std::vector<const DrawableGeometry*> staticCasters;
+    bool hasDynamicCasters = false;
+    for (const DrawableGeometry* geometry : m_opaqueList)
+    {
+        if (geometry->isDynamic)
+            hasDynamicCasters = true;
+        else
+            staticCasters.push_back(geometry);
+    }
+    if (staticCasters != m_staticShadowCasters)
+    {
+        m_staticShadowCasters.swap(staticCasters);
+        m_shadowCascades.InvalidateStaticDepth();
+    }
 
-    SetShaderProgram(m_directionalProg.get());
-    SetTexturesForFullScreenPass();
-    m_directionalProg->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Colortex, m_colorTexture);
+    m_shadowCascades.Update(m_spRenderCam->GetInverseView(), m_spRenderCam->GetPerspective(), m_nearPlane, glm::min(m_shadowDistance, m_farPlane));
 
-    using ShaderResourceReferences::lightPassShaderConstants;
-    m_directionalProg->SetShaderConstant(lightPassShaderConstants.uf4DirecLightDir, dir_light);
-    m_directionalProg->SetShaderConstant(lightPassShaderConstants.uf3AmbientContrib, ambient);
+    SetShaderProgram(m_shadowProg.get());
+    glViewport(0, 0, ShadowCascades::c_resolution, ShadowCascades::c_resolution);
+    glEnable(GL_DEPTH_CLAMP);       // Casters in front of the near plane are flattened onto it rather than lost.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);    // Slope scaled, against acne on surfaces at a grazing angle to the light.
+    glDisable(GL_CULL_FACE);        // Scene meshes aren't guaranteed to be closed.
 
-    glDepthMask(GL_FALSE);
-    RenderQuad();
-    glDepthMask(GL_TRUE);
+    for (uint32_t cascade = 0; cascade < ShadowCascades::c_cascadeCount; ++cascade)
+    {
+        const ShadowCascades::Cascade& thisCascade = m_shadowCascades.GetCascade(cascade);
+        if (!ShadowCascades::IsCached(cascade))
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFramebuffers[cascade]);
+            ClearFramebuffer(RenderEnums::CLEAR_DEPTH);
+            DrawShadowCasters(thisCascade.viewProjection, false);
+            DrawShadowCasters(thisCascade.viewProjection, true);
+            continue;
+        }
+
+        uint32_t cacheLayer = cascade - ShadowCascades::c_firstCachedCascade;
+        bool layerStale = hasDynamicCasters || m_shadowLayerHasDynamicCasters[cascade];     // Last frame's have to be wiped too.
+        if (thisCascade.staticDepthStale)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_staticShadowFramebuffers[cacheLayer]);
+            ClearFramebuffer(RenderEnums::CLEAR_DEPTH);
+            DrawShadowCasters(thisCascade.viewProjection, false);
+            m_shadowCascades.MarkStaticDepthRendered(cascade);
+            layerStale = true;
+        }
+
+        if (layerStale)
+        {
+            glCopyImageSubData(m_staticShadowMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cacheLayer, m_shadowMap, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                ShadowCascades::c_resolution, ShadowCascades::c_resolution, 1);
+            if (hasDynamicCasters)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, m_shadowFramebuffers[cascade]);
+                DrawShadowCasters(thisCascade.viewProjection, true);
+            }
+        }
+        m_shadowLayerHasDynamicCasters[cascade] = hasDynamicCasters;
+    }
+
+    glEnable(GL_CULL_FACE);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
 }
 
-void GLRenderer::RenderFramebuffers()
+void GLRenderer::RenderPointLightShadows()
 {
-    SetShaderProgram(m_diagnosticProg.get());
-    SetTexturesForFullScreenPass();
-    m_diagnosticProg->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Colortex, m_colorTexture);
+    const std::vector<uint32_t>& updates = m_shadowAtlas.GetUpdates();
+    if (updates.empty())
+        return;
 
-    glDepthMask(GL_FALSE);
-    RenderQuad();
-    glDepthMask(GL_TRUE);
+    // The faces of every light drawn this frame, a light's six in a row, so one instanced draw per caster covers its whole cube.
+    std::vector<PointShadowFace> faces;
+    std::vector<const ShadowAtlas::Slot*> slots;
+    for (uint32_t light : updates)
+    {
+        const ShadowAtlas::Slot* slot = m_shadowAtlas.FindUsableSlot(light);
+        slots.push_back(slot);
+        for (uint32_t face = 0; face < ShadowAtlas::c_faceCount; ++face)
+        {
+            PointShadowFace shadowFace;
+            shadowFace.worldToFace = ShadowAtlas::GetFaceViewProjection(slot->positionAndRadius, face);
+            shadowFace.faceToAtlas = ShadowAtlas::GetTileTransform(slot->faces[face]);
+            faces.push_back(shadowFace);
+        }
+    }
+    glNamedBufferData(m_pointShadowFaceBuffer, faces.size() * sizeof(PointShadowFace), &faces[0], GL_STREAM_DRAW);
+
+    using ShaderResourceReferences::shadowPassShaderConstants;
+    SetShaderProgram(m_pointShadowProg.get());
+    m_pointShadowProg->SetStorageBuffer(ShaderResourceReferences::shadowPassResources.PointShadowFaces, m_pointShadowFaceBuffer);
+    m_pointShadowProg->CommitStorageBufferBindings();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_pointShadowFramebuffer);
+    glViewport(0, 0, ShadowAtlas::c_size, ShadowAtlas::c_size);
+    for (uint32_t plane = 0; plane < 4; ++plane)
+        glEnable(GL_CLIP_DISTANCE0 + plane);    // Each face's frustum sides, which keep it on its tile.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glDisable(GL_CULL_FACE);
+
+    const float farDepth = 1.0f;
+    for (uint32_t update = 0; update < updates.size(); ++update)
+    {
+        for (const ShadowAtlas::Tile& tile : slots[update]->faces)
+            glClearTexSubImage(m_pointShadowAtlas, 0, tile.x, tile.y, 0, tile.size, tile.size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+
+        m_pointShadowProg->SetShaderConstant(shadowPassShaderConstants.uiFirstShadowFace, static_cast<int>(update * ShadowAtlas::c_faceCount));
+        for (const DrawableGeometry* geometry : m_opaqueList)
+        {
+            m_pointShadowProg->SetShaderConstant(shadowPassShaderConstants.um4PointShadowModel, geometry->modelMat);
+            DrawGeometry(geometry, ShadowAtlas::c_faceCount);
+        }
+        m_shadowAtlas.MarkRendered(updates[update]);
+    }
+
+    glEnable(GL_CULL_FACE);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    for (uint32_t plane = 0; plane < 4; ++plane)
+        glDisable(GL_CLIP_DISTANCE0 + plane);
 }
 
-void GLRenderer::RenderPostProcessEffects()
+void GLRenderer::Resize(uint32_t width, uint32_t height)
 {
-    SetShaderProgram(m_postProg.get());
-    SetTexturesForFullScreenPass();
-    m_postProg->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Posttex, m_postTexture);
+    if ((width == 0) || (height == 0))
+        return; // Minimized. Keep the old targets around until we come back.
 
-    glDepthMask(GL_FALSE);
-    RenderQuad();
-    glDepthMask(GL_TRUE);
+    m_outputWidth = width;
+    m_outputHeight = height;
+    m_frameGraph->SetBackbufferSize(m_outputWidth, m_outputHeight);
+    UpdateRenderResolution();
 }
 
-void GLRenderer::RenderQuad()
+void GLRenderer::SetDirectionalLightDirection(const glm::vec3& lightDirection)
 {
-    DrawGeometry(&m_QuadGeometry);
+    m_directionalLightDirection = glm::normalize(lightDirection);
+    m_shadowCascades.SetLightDirection(m_directionalLightDirection);
 }
 
-void GLRenderer::SetFramebufferActive(GLType_uint fbID)
+void GLRenderer::SetResolutionScale(float resolutionScale)
 {
-    assert(fbID < m_FBO.size());
-    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO[fbID]);
+    m_resolutionScale = glm::clamp(resolutionScale, c_minResolutionScale, c_maxResolutionScale);
+    m_dynamicResolution->SetScale(m_resolutionScale);
+    UpdateRenderResolution();
 }
 
-void GLRenderer::SetShaderProgram(GLProgram* currentlyUsedProgram)
-{ 
+void GLRenderer::SetTargetFrameTime(float targetFrameTime)
+{
+    m_dynamicResolution->SetTargetFrameTime(targetFrameTime);
+    m_dynamicResolution->SetScale(m_resolutionScale);
+}
+
+void GLRenderer::SetDynamicResolutionRange(float minScale, float maxScale)
+{
+    minScale = glm::clamp(minScale, c_minResolutionScale, c_maxResolutionScale);
+    maxScale = glm::clamp(maxScale, minScale, c_maxResolutionScale);
+    m_dynamicResolution->SetScaleRange(minScale, maxScale);
+}
+
+bool GLRenderer::IsDynamicResolutionEnabled() const
+{
+    return m_dynamicResolution->IsEnabled();
+}
+
+float GLRenderer::GetGPUFrameTime() const
+{
+    return m_dynamicResolution->GetLastFrameTime();
+}
+
+void GLRenderer::UploadVisibleLights()
+{
+    m_lightStore.CullAndTransform(m_spRenderCam->GetView(), m_spRenderCam->GetPerspective(), m_nearPlane, m_farPlane, m_visibleLights);
+    if (m_shadowsEnabled)
+        AssignPointLightShadows();
+    if (m_visibleLights.empty())
+        return;
+
+    // Past its limit, the single pass keeps the lights whose spheres come nearest the eye; they're moved to the front of the list.
+    if ((m_lightingPath == RenderEnums::LIGHTING_SINGLE_PASS) && (m_visibleLights.size() > m_singlePassLightLimit))
+    {
+        std::nth_element(m_visibleLights.begin(), m_visibleLights.begin() + m_singlePassLightLimit, m_visibleLights.end(),
+            [](const LightStore::ViewSpaceLight& a, const LightStore::ViewSpaceLight& b)
+            {
+                return (a.positionAndRadius.z + a.positionAndRadius.w) > (b.positionAndRadius.z + b.positionAndRadius.w);
+            });
+    }
+
+    if (m_lightBuffer == 0)
+        glCreateBuffers(1, &m_lightBuffer);
+
+    // One update for every light, whatever the count. Orphans last frame's copy.
+    glNamedBufferData(m_lightBuffer, m_visibleLights.size() * sizeof(LightStore::ViewSpaceLight), &m_visibleLights[0], GL_STREAM_DRAW);
+}
+
+void GLRenderer::AssignPointLightShadows()
+{
+    // Depth in the atlas only holds for the casters it was drawn with. Dynamic ones change it every frame, and so does their leaving.
+    std::vector<const DrawableGeometry*> staticCasters;
+    bool hasDynamicCasters = false;
+    for (const DrawableGeometry* geometry : m_opaqueList)
+    {
+        if (geometry->isDynamic)
+            hasDynamicCasters = true;
+        else
+            staticCasters.push_back(geometry);
+    }
+    if (staticCasters != m_pointShadowStaticCasters)
+    {
+        m_pointShadowStaticCasters.swap(staticCasters);
+        m_shadowAtlas.InvalidateAll();
+    }
+    bool castersChanged = hasDynamicCasters || m_pointShadowsHadDynamicCasters;
+    m_pointShadowsHadDynamicCasters = hasDynamicCasters;
+
+    // Coverage is the sphere's projected diameter over the screen height. From inside the sphere it's at least the whole screen.
+    float projectionScale = m_spRenderCam->GetPerspective()[1][1];
+    std::vector<ShadowAtlas::Request> requests;
+    for (const LightStore::ViewSpaceLight& light : m_visibleLights)
+    {
+        float radius = light.positionAndRadius.w;
+        ShadowAtlas::Request request;
+        request.light = light.light;
+        request.positionAndRadius = glm::vec4(m_lightStore.GetPosition(light.light), radius);
+        request.screenCoverage = (radius * projectionScale) / glm::max(glm::length(glm::vec3(light.positionAndRadius)), radius);
+        request.importance = request.screenCoverage * light.colourAndIntensity.a;
+        requests.push_back(request);
+    }
+    m_shadowAtlas.Schedule(requests, castersChanged);
+
+    // Lights waiting their turn are sampled from where their depth was drawn, not where they are now.
+    glm::mat4 inverseView = m_spRenderCam->GetInverseView();
+    std::vector<PointLightShadow> shadows;
+    for (LightStore::ViewSpaceLight& light : m_visibleLights)
+    {
+        const ShadowAtlas::Slot* slot = m_shadowAtlas.FindUsableSlot(light.light);
+        if (slot == nullptr)
+            continue;
+
+        const glm::vec4& positionAndRadius = slot->updating ? slot->positionAndRadius : slot->renderedPositionAndRadius;
+        PointLightShadow shadow;
+        for (uint32_t face = 0; face < ShadowAtlas::c_faceCount; ++face)
+        {
+            const ShadowAtlas::Tile& tile = slot->faces[face];
+            shadow.viewToFace[face] = c_textureBias * ShadowAtlas::GetTileTransform(tile) * ShadowAtlas::GetFaceViewProjection(positionAndRadius, face) * inverseView;
+            shadow.faceBounds[face] = glm::vec4(tile.x, tile.y, tile.x + tile.size, tile.y + tile.size) / static_cast<float>(ShadowAtlas::c_size);
+        }
+
+        light.shadow = static_cast<int32_t>(shadows.size());
+        shadows.push_back(shadow);
+    }
+
+    // Orphans last frame's copy. Never left empty, so there's always something to bind.
+    if (shadows.empty())
+        shadows.resize(1);
+    glNamedBufferData(m_pointShadowBuffer, shadows.size() * sizeof(PointLightShadow), &shadows[0], GL_STREAM_DRAW);
+}
+
+void GLRenderer::UploadLightClusters()
+{
+    m_lightClusterGrid.Build(m_visibleLights, m_spRenderCam->GetPerspective(), m_nearPlane, m_farPlane);
+
+    if (m_clusterRangeBuffer == 0)
+    {
+        glCreateBuffers(1, &m_clusterRangeBuffer);
+        glCreateBuffers(1, &m_clusterIndexBuffer);
+    }
+
+    // Orphans last frame's copies. The index list is never left empty, so there's always something to bind.
+    const std::vector<LightClusterGrid::ClusterRange>& ranges = m_lightClusterGrid.GetRanges();
+    const std::vector<uint32_t>& indices = m_lightClusterGrid.GetIndices();
+    uint32_t noIndex = 0;
+    glNamedBufferData(m_clusterRangeBuffer, ranges.size() * sizeof(LightClusterGrid::ClusterRange), &ranges[0], GL_STREAM_DRAW);
+    glNamedBufferData(m_clusterIndexBuffer, glm::max<size_t>(indices.size(), 1) * sizeof(uint32_t), indices.empty() ? &noIndex : &indices[0], GL_STREAM_DRAW);
+}
+
+void GLRenderer::SetLightClusterResources(GLProgram* program)
+{
+    using ShaderResourceReferences::lightPassResources;
+    using ShaderResourceReferences::lightPassShaderConstants;
+    program->SetStorageBuffer(lightPassResources.LightList, m_lightBuffer);
+    program->SetStorageBuffer(lightPassResources.ClusterLightRanges, m_clusterRangeBuffer);
+    program->SetStorageBuffer(lightPassResources.ClusterLightIndices, m_clusterIndexBuffer);
+    SetPointShadowResources(program);
+    program->CommitStorageBufferBindings();
+
+    program->SetShaderConstant(lightPassShaderConstants.uiClusterCountX, static_cast<uint32_t>(LightClusterGrid::c_countX));
+    program->SetShaderConstant(lightPassShaderConstants.uiClusterCountY, static_cast<uint32_t>(LightClusterGrid::c_countY));
+    program->SetShaderConstant(lightPassShaderConstants.uiClusterCountZ, static_cast<uint32_t>(LightClusterGrid::c_countZ));
+    program->SetShaderConstant(lightPassShaderConstants.ufClusterSliceScale, LightClusterGrid::GetSliceScale(m_nearPlane, m_farPlane));
+    program->SetShaderConstant(lightPassShaderConstants.ufClusterSliceBias, LightClusterGrid::GetSliceBias(m_nearPlane, m_farPlane));
+}
+
+void GLRenderer::SetPointShadowResources(GLProgram* program)
+{
+    // Bound even with shadows off: every light's index is -1 then, so neither is read.
+    using ShaderResourceReferences::lightPassResources;
+    program->SetStorageBuffer(lightPassResources.PointShadowList, m_pointShadowBuffer);
+    program->SetTexture(lightPassResources.u_PointShadowAtlastex, m_pointShadowAtlas);
+}
+
+void GLRenderer::UploadVisibilityBuffers()
+{
+    if (m_sceneBuffersDirty)
+    {
+        glDeleteBuffers(1, &m_sceneVertexBuffer);
+        glDeleteBuffers(1, &m_sceneIndexBuffer);
+        glCreateBuffers(1, &m_sceneVertexBuffer);
+        glCreateBuffers(1, &m_sceneIndexBuffer);
+        glNamedBufferStorage(m_sceneVertexBuffer, m_sceneVertices.size() * sizeof(Vertex), &m_sceneVertices[0], 0);
+        glNamedBufferStorage(m_sceneIndexBuffer, m_sceneIndices.size() * sizeof(GLuint), &m_sceneIndices[0], 0);
+        m_sceneBuffersDirty = false;
+    }
+
+    if (m_drawDataBuffer == 0)
+        glCreateBuffers(1, &m_drawDataBuffer);
+
+    glm::mat4 view = m_spRenderCam->GetView();
+    glm::mat4 inverseView = m_spRenderCam->GetInverseView();
+    std::vector<VisibilityDrawData> drawData(m_opaqueList.size());
+    for (uint32_t i = 0; i < m_opaqueList.size(); ++i)
+    {
+        drawData[i].modelView = view * m_opaqueList[i]->modelMat;
+        drawData[i].inverseTransposedModelView = glm::transpose(m_opaqueList[i]->inverseModelMat * inverseView);
+        drawData[i].diffuseHandle = m_opaqueList[i]->diffuse_handle;
+        drawData[i].normalHandle = m_opaqueList[i]->normal_handle;
+        drawData[i].firstIndex = m_opaqueList[i]->first_scene_index;
+    }
+
+    glNamedBufferData(m_drawDataBuffer, drawData.size() * sizeof(VisibilityDrawData), &drawData[0], GL_STREAM_DRAW);  // Orphans last frame's copy.
+}
+
+void GLRenderer::InitAmbientOcclusionHistory()
+{
+    uint32_t width = (m_renderTargetWidth + 1) / 2, height = (m_renderTargetHeight + 1) / 2;
+    if ((width == m_aoHistoryWidth) && (height == m_aoHistoryHeight))
+        return;
+
+    // Follows the render targets, which only change size with the output. Bilinear, for reprojected lookups between texels.
+    glDeleteTextures(2, m_aoHistory);
+    glCreateTextures(GL_TEXTURE_2D, 2, m_aoHistory);
+    for (GLType_uint history : m_aoHistory)
+    {
+        glTextureStorage2D(history, 1, GL_RG16F, width, height);
+        glTextureParameteri(history, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(history, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(history, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(history, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    m_aoHistoryWidth = width;
+    m_aoHistoryHeight = height;
+    m_aoHistoryValid = false;
+}
+
+void GLRenderer::UpdateAmbientOcclusionBudget()
+{
+    if (m_aoBudget <= 0.0f)
+    {
+        m_aoSampleCount = c_maxAOSampleCount;
+        return;
+    }
+
+    // A step down as soon as a measurement is over budget, and a step back up only with room to spare, so it doesn't hunt.
+    // Temporal accumulation makes up for fewer samples, over a few more frames.
+    float time = m_aoTimer->GetLastTime();
+    if ((time > m_aoBudget) && (m_aoSampleCount > c_minAOSampleCount))
+        m_aoSampleCount -= c_aoSampleCountStep;
+    else if ((time < (m_aoBudget * c_aoBudgetHeadroom)) && (m_aoSampleCount < c_maxAOSampleCount))
+        m_aoSampleCount += c_aoSampleCountStep;
+}
+
+void GLRenderer::UpdateRenderResolution()
+{
+    // Render targets only change size with the output. Targets at the old size aren't freed here; they stop being requested
+    // and the pool evicts them a few frames later. The render resolution is the part of them the frame graph points viewports at.
+    m_renderTargetWidth = std::max(static_cast<uint32_t>(m_outputWidth * c_maxResolutionScale), 1u);
+    m_renderTargetHeight = std::max(static_cast<uint32_t>(m_outputHeight * c_maxResolutionScale), 1u);
+    m_width = std::max(static_cast<uint32_t>((m_renderTargetWidth * (m_resolutionScale / c_maxResolutionScale)) + 0.5f), 1u);
+    m_height = std::max(static_cast<uint32_t>((m_renderTargetHeight * (m_resolutionScale / c_maxResolutionScale)) + 0.5f), 1u);
+    m_invWidth = 1.0f / m_width;
+    m_invHeight = 1.0f / m_height;
+    m_frameGraph->SetViewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+}
+
+void GLRenderer::SetupFrameGraph()
+{
+    FrameGraphResource backbuffer = m_frameGraph->ImportBackbuffer();
+    GBufferResources gBuffer = (m_visibilityBufferEnabled && CanUseVisibilityBuffer()) ? AddVisibilityPasses() : AddGBufferPass();
+    AddDepthReadbackPass(gBuffer);
+    ShadowResources shadows = AddShadowPasses();
+    MipPyramidResources mipPyramid;     // Each half is culled when no effect samples it.
+    mipPyramid.depth = AddDepthPyramidPass(gBuffer);
+    FrameGraphResource ambientOcclusion = AddAmbientOcclusionPasses(gBuffer, mipPyramid.depth);
+    FrameGraphResource lighting = AddLightingPass(gBuffer, shadows, ambientOcclusion);
+    mipPyramid.colour = AddColourPyramidPass(lighting);
+    DepthOfFieldResources depthOfField = AddDepthOfFieldPasses(mipPyramid);
+    FrameGraphResource bloom = AddBloomPasses(mipPyramid.colour);
+
+    // Both outputs are always declared. The one that isn't presented is culled, along with anything that only it consumed.
+    FrameGraphResource diagnosticOutput = AddDiagnosticPass(gBuffer, backbuffer);
+    FrameGraphResource postOutput = AddPostProcessPass(gBuffer, lighting, bloom, depthOfField, backbuffer);
+    m_frameGraph->Present((m_displayType != RenderEnums::DISPLAY_TOTAL) ? diagnosticOutput : postOutput);
+}
+
+GBufferResources GLRenderer::AddGBufferPass()
+{
+    GBufferResources gBuffer;
+    m_frameGraph->AddPass("GBuffer",
+        [this, &gBuffer](FrameGraph::PassBuilder& builder)
+        {
+            GLType_uint normalLocation = 0, colourLocation = 0;
+            if (!m_passProg->GetOutputBindLocation("out_f2Normal", normalLocation))
+                assert(false);
+            if (!m_passProg->GetOutputBindLocation("out_f4Colour", colourLocation))
+                assert(false);
+
+            gBuffer.depth = builder.CreateTexture("GBufferDepth", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_DEPTH_COMPONENT32));
+            // View space position is rebuilt from depth, normals are octahedral encoded and the glow mask rides in the colour alpha.
+            gBuffer.normal = builder.CreateTexture("GBufferNormal", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_RG16));
+            gBuffer.colour = builder.CreateTexture("GBufferColour", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_RGBA8));
+
+            gBuffer.depth = builder.Write(gBuffer.depth, RenderEnums::ACCESS_DEPTH_TARGET);
+            gBuffer.normal = builder.Write(gBuffer.normal, RenderEnums::ACCESS_RENDER_TARGET, normalLocation);
+            gBuffer.colour = builder.Write(gBuffer.colour, RenderEnums::ACCESS_RENDER_TARGET, colourLocation);
+        },
+        [this](const FrameGraph&)
+        {
+            ClearFramebuffer(RenderEnums::CLEAR_ALL);
+            DrawOpaqueList();
+            DrawAlphaMaskedList();
+        });
+
+    return gBuffer;
+}
+
+GBufferResources GLRenderer::AddVisibilityPasses()
+{
+    // Same G-buffer as AddGBufferPass() in the end, but the geometry pass only writes depth and a draw/triangle id. The resolve pass
+    // then runs once per pixel, never for overdraw, and is the only place material textures are read.
+    FrameGraphResource visibility = FrameGraph::c_invalidResource;
+    GBufferResources gBuffer;
+    m_frameGraph->AddPass("Visibility",
+        [this, &gBuffer, &visibility](FrameGraph::PassBuilder& builder)
+        {
+            gBuffer.depth = builder.CreateTexture("GBufferDepth", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_DEPTH_COMPONENT32));
+            visibility = builder.CreateTexture("Visibility", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_R32UI, GL_NEAREST));
+
+            gBuffer.depth = builder.Write(gBuffer.depth, RenderEnums::ACCESS_DEPTH_TARGET);
+            visibility = builder.Write(visibility, RenderEnums::ACCESS_RENDER_TARGET);
+        },
+        [this](const FrameGraph&)
+        {
+            UploadVisibilityBuffers();
+
+            const GLuint clearValue[] = { c_visibilityEmpty, 0, 0, 0 };
+            ClearFramebuffer(RenderEnums::CLEAR_DEPTH);
+            glClearBufferuiv(GL_COLOR, 0, clearValue);  // glClear is undefined for integer targets.
+            DrawVisibilityList();
+        });
+
+    m_frameGraph->AddPass("VisibilityResolve",
+        [this, &gBuffer, &visibility](FrameGraph::PassBuilder& builder)
+        {
+            GLType_uint normalLocation = 0, colourLocation = 0;
+            if (!m_visibilityResolveProg->GetOutputBindLocation("out_f2Normal", normalLocation))
+                assert(false);
+            if (!m_visibilityResolveProg->GetOutputBindLocation("out_f4Colour", colourLocation))
+                assert(false);
+
+            builder.Read(visibility);
+            gBuffer.normal = builder.CreateTexture("GBufferNormal", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_RG16));
+            gBuffer.colour = builder.CreateTexture("GBufferColour", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_RGBA8));
+
+            gBuffer.normal = builder.Write(gBuffer.normal, RenderEnums::ACCESS_RENDER_TARGET, normalLocation);
+            gBuffer.colour = builder.Write(gBuffer.colour, RenderEnums::ACCESS_RENDER_TARGET, colourLocation);
+        },
+        [this, visibility](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::visibilityPassResources;
+            ClearFramebuffer(RenderEnums::CLEAR_COLOUR);
+            SetShaderProgram(m_visibilityResolveProg.get());
+            m_currentProgram->SetTexture(visibilityPassResources.u_Visibilitytex, frameGraph.GetTexture(visibility));
+            m_currentProgram->SetStorageBuffer(visibilityPassResources.DrawDataList, m_drawDataBuffer);
+            m_currentProgram->SetStorageBuffer(visibilityPassResources.SceneVertices, m_sceneVertexBuffer);
+            m_currentProgram->SetStorageBuffer(visibilityPassResources.SceneIndices, m_sceneIndexBuffer);
+            m_currentProgram->CommitStorageBufferBindings();
+
+            glDisable(GL_DEPTH_TEST);
+            glDepthMask(GL_FALSE);
+            RenderQuad();
+            glDepthMask(GL_TRUE);
+            glEnable(GL_DEPTH_TEST);
+        });
+
+    return gBuffer;
+}
+
+ShadowResources GLRenderer::AddShadowPasses()
+{
+    ShadowResources shadows;
+    shadows.cascades = FrameGraph::c_invalidResource;
+    shadows.pointAtlas = FrameGraph::c_invalidResource;
+    if (!m_shadowsEnabled)
+        return shadows;
+
+    // The shadow map outlives the frame: cached cascades are only partly redrawn. It's imported so the lighting pass can depend on it.
+    shadows.cascades = m_frameGraph->ImportTexture("ShadowMap", m_shadowMap,
+        RenderTargetDesc(ShadowCascades::c_resolution, ShadowCascades::c_resolution, GL_DEPTH_COMPONENT32F, GL_LINEAR));
+    m_frameGraph->AddPass("Shadows",
+        [&shadows](FrameGraph::PassBuilder& builder)
+        {
+            shadows.cascades = builder.Write(shadows.cascades, RenderEnums::ACCESS_PASS_BOUND_TARGET);   // A layer at a time.
+        },
+        [this](const FrameGraph&)
+        {
+            RenderShadowCascades();
+        });
+
+    // Same for the atlas, where most tiles are left as they were.
+    shadows.pointAtlas = m_frameGraph->ImportTexture("PointShadowAtlas", m_pointShadowAtlas,
+        RenderTargetDesc(ShadowAtlas::c_size, ShadowAtlas::c_size, GL_DEPTH_COMPONENT32F, GL_LINEAR));
+    m_frameGraph->AddPass("PointShadows",
+        [&shadows](FrameGraph::PassBuilder& builder)
+        {
+            shadows.pointAtlas = builder.Write(shadows.pointAtlas, RenderEnums::ACCESS_PASS_BOUND_TARGET);
+        },
+        [this](const FrameGraph&)
+        {
+            RenderPointLightShadows();
+        });
+
+    return shadows;
+}
+
+FrameGraphResource GLRenderer::AddDepthPyramidPass(const GBufferResources& gBuffer)
+{
+    // Level 0 is half the render targets. A group covers a tile of it through every level, so the groups only have to cover the
+    // part of level 0 that holds this frame, rounded the way GetRenderAreaSize() in the shaders does.
+    uint32_t width = (m_renderTargetWidth + 1) / 2, height = (m_renderTargetHeight + 1) / 2;
+    glm::vec2 viewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+    uint32_t renderWidth = std::max(static_cast<uint32_t>((width * viewportScale.x) + 0.5f), 1u);
+    uint32_t renderHeight = std::max(static_cast<uint32_t>((height * viewportScale.y) + 0.5f), 1u);
+    uint32_t groupsX = (renderWidth + c_mipPyramidGroupSize - 1) / c_mipPyramidGroupSize;
+    uint32_t groupsY = (renderHeight + c_mipPyramidGroupSize - 1) / c_mipPyramidGroupSize;
+
+    // Shared with the execute callback, which is made before the setup hands out the pyramid's handle.
+    std::shared_ptr<FrameGraphResource> depthPyramid = std::make_shared<FrameGraphResource>(FrameGraph::c_invalidResource);
+    m_frameGraph->AddPass("DepthPyramid",
+        [&gBuffer, depthPyramid, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+
+            *depthPyramid = builder.CreateTexture("DepthPyramid", RenderTargetDesc(width, height, GL_RG32F, GL_NEAREST, c_mipPyramidLevels));
+            *depthPyramid = builder.Write(*depthPyramid, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, gBuffer, depthPyramid, groupsX, groupsY](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::mipPyramidPassResources;
+            const ImageReference images[c_mipPyramidLevels] = { mipPyramidPassResources.u_DepthPyramid0img, mipPyramidPassResources.u_DepthPyramid1img,
+                mipPyramidPassResources.u_DepthPyramid2img, mipPyramidPassResources.u_DepthPyramid3img };
+
+            SetShaderProgram(m_depthPyramidProg.get());
+            m_currentProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Depthtex, frameGraph.GetTexture(gBuffer.depth));
+            for (uint32_t level = 0; level < c_mipPyramidLevels; ++level)
+                m_currentProgram->SetImage(images[level], frameGraph.GetTexture(*depthPyramid), GL_RG32F, level);
+            Dispatch(m_depthPyramidProg.get(), groupsX, groupsY, 1);
+        });
+
+    return *depthPyramid;
+}
+
+FrameGraphResource GLRenderer::AddAmbientOcclusionPasses(const GBufferResources& gBuffer, FrameGraphResource depthPyramid)
+{
+    if (!m_ambientOcclusionEnabled)
+    {
+        m_aoHistoryValid = false;
+        return FrameGraph::c_invalidResource;
+    }
+
+    // Last frame's occlusion is only worth reprojecting if it was drawn at the same resolution.
+    InitAmbientOcclusionHistory();
+    glm::vec2 viewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+    if (viewportScale != m_aoHistoryViewportScale)
+        m_aoHistoryValid = false;
+
+    uint32_t width = m_aoHistoryWidth, height = m_aoHistoryHeight;
+    // The part of the half resolution targets that holds this frame, rounded the way GetRenderAreaSize() in the shaders does.
+    uint32_t renderWidth = std::max(static_cast<uint32_t>((width * viewportScale.x) + 0.5f), 1u);
+    uint32_t renderHeight = std::max(static_cast<uint32_t>((height * viewportScale.y) + 0.5f), 1u);
+    uint32_t groupsX = (renderWidth + c_aoGroupSize - 1) / c_aoGroupSize, groupsY = (renderHeight + c_aoGroupSize - 1) / c_aoGroupSize;
+    uint32_t historyIndex = 1 - m_aoHistoryIndex;
+    glm::mat4 viewProjection = m_spRenderCam->GetPerspective() * m_spRenderCam->GetView();
+    glm::mat4 viewToPreviousClip = m_aoHistoryViewProjection * m_spRenderCam->GetInverseView();
+    float historyWeight = m_aoHistoryValid ? c_aoHistoryWeight : 0.0f;
+
+    // The history outlives the frame, so it's imported: one to read from, the other to write this frame's occlusion to.
+    FrameGraphResource previousHistory = m_frameGraph->ImportTexture("AOHistoryPrevious", m_aoHistory[m_aoHistoryIndex], RenderTargetDesc(width, height, GL_RG16F, GL_LINEAR));
+    FrameGraphResource history = m_frameGraph->ImportTexture("AOHistory", m_aoHistory[historyIndex], RenderTargetDesc(width, height, GL_RG16F, GL_LINEAR));
+    std::shared_ptr<AmbientOcclusionTargets> targets = std::make_shared<AmbientOcclusionTargets>();
+    m_frameGraph->AddPass("AODownsample",
+        [&gBuffer, targets, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.Read(gBuffer.normal);
+
+            targets->normal = builder.CreateTexture("AONormal", RenderTargetDesc(width, height, GL_RG16, GL_NEAREST));
+            targets->normal = builder.Write(targets->normal, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, gBuffer, targets, groupsX, groupsY](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::ambientOcclusionPassResources;
+            m_aoTimer->Begin();
+            SetShaderProgram(m_aoDownsampleProg.get());
+            m_currentProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Depthtex, frameGraph.GetTexture(gBuffer.depth));
+            m_currentProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Normaltex, frameGraph.GetTexture(gBuffer.normal));
+            m_currentProgram->SetImage(ambientOcclusionPassResources.u_AONormalimg, frameGraph.GetTexture(targets->normal), GL_RG16);
+            Dispatch(m_aoDownsampleProg.get(), groupsX, groupsY, 1);
+        });
+
+    // Depth is level 0 of the pyramid, the same size as the history and already the nearest linear view distance of each 2x2.
+    FrameGraphResource normal = targets->normal, historyTarget = history;
+    m_frameGraph->AddPass("AmbientOcclusion",
+        [depthPyramid, normal, &history, previousHistory](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(depthPyramid);
+            builder.Read(normal);
+            builder.Read(previousHistory);
+            history = builder.Write(history, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, depthPyramid, normal, historyTarget, previousHistory, historyIndex, viewProjection, viewToPreviousClip, historyWeight, viewportScale, groupsX, groupsY](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::ambientOcclusionPassShaderConstants;
+            using ShaderResourceReferences::ambientOcclusionPassResources;
+            SetShaderProgram(m_ambientOcclusionProg.get());
+            m_currentProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_RandomNormaltex, m_randomNormalTexture);
+            m_currentProgram->SetTexture(ambientOcclusionPassResources.u_AODepthtex, frameGraph.GetTexture(depthPyramid));
+            m_currentProgram->SetTexture(ambientOcclusionPassResources.u_AONormaltex, frameGraph.GetTexture(normal));
+            m_currentProgram->SetTexture(ambientOcclusionPassResources.u_AOHistorytex, frameGraph.GetTexture(previousHistory));
+            m_currentProgram->SetImage(ambientOcclusionPassResources.u_AOimg, frameGraph.GetTexture(historyTarget), GL_RG16F);
+            m_currentProgram->SetShaderConstant(ambientOcclusionPassShaderConstants.um4ViewToPreviousClip, viewToPreviousClip);
+            m_currentProgram->SetShaderConstant(ambientOcclusionPassShaderConstants.ufAORadius, m_aoRadius);
+            m_currentProgram->SetShaderConstant(ambientOcclusionPassShaderConstants.ufAOHistoryWeight, historyWeight);
+            m_currentProgram->SetShaderConstant(ambientOcclusionPassShaderConstants.uiAOSampleCount, m_aoSampleCount);
+            m_currentProgram->SetShaderConstant(ambientOcclusionPassShaderConstants.uiAOFrameIndex, m_aoFrameIndex);
+            Dispatch(m_ambientOcclusionProg.get(), groupsX, groupsY, 1);
+
+            // What next frame reprojects from.
+            m_aoHistoryIndex = historyIndex;
+            m_aoHistoryViewProjection = viewProjection;
+            m_aoHistoryViewportScale = viewportScale;
+            m_aoHistoryValid = true;
+            ++m_aoFrameIndex;
+        });
+
+    // Separable, so x then y, each through a target of its own. The history keeps the unblurred occlusion, so the blur doesn't
+    // pile up over frames.
+    for (uint32_t axis = 0; axis < 2; ++axis)
+    {
+        FrameGraphResource source = (axis == 0) ? history : targets->blurred[0];
+        m_frameGraph->AddPass((axis == 0) ? "AOBlurX" : "AOBlurY",
+            [targets, source, width, height, axis](FrameGraph::PassBuilder& builder)
+            {
+                builder.Read(source);
+                targets->blurred[axis] = builder.CreateTexture((axis == 0) ? "AOBlurX" : "AmbientOcclusion", RenderTargetDesc(width, height, GL_RG16F, GL_NEAREST));
+                targets->blurred[axis] = builder.Write(targets->blurred[axis], RenderEnums::ACCESS_IMAGE_STORE);
+            },
+            [this, targets, source, axis, groupsX, groupsY](const FrameGraph& frameGraph)
+            {
+                using ShaderResourceReferences::ambientOcclusionPassResources;
+                SetShaderProgram(m_aoBlurProg.get());
+                m_currentProgram->SetTexture(ambientOcclusionPassResources.u_AOSourcetex, frameGraph.GetTexture(source));
+                m_currentProgram->SetImage(ambientOcclusionPassResources.u_AOimg, frameGraph.GetTexture(targets->blurred[axis]), GL_RG16F);
+                m_currentProgram->SetShaderConstant(ShaderResourceReferences::ambientOcclusionPassShaderConstants.uiAOBlurAxis, axis);
+                Dispatch(m_aoBlurProg.get(), groupsX, groupsY, 1);
+
+                if (axis == 1)
+                {
+                    if (m_aoTimer->End())
+                        UpdateAmbientOcclusionBudget();
+                }
+            });
+    }
+
+    return targets->blurred[1];
+}
+
+FrameGraphResource GLRenderer::AddLightingPass(const GBufferResources& gBuffer, const ShadowResources& shadows, FrameGraphResource ambientOcclusion)
+{
+    FrameGraphResource lighting = FrameGraph::c_invalidResource;
+    GLProgram* directionalProgram = SelectVariant(*m_directionalProg);
+    GLProgram* pointProgram = SelectVariant(*m_pointProg);
+    GLProgram* clusteredLightingProgram = SelectVariant(*m_clusteredLightingProg);
+    GLProgram* lightVolumeProgram = SelectVariant(*m_lightVolumeProg);
+    GLProgram* singlePassLightingProgram = SelectVariant(*m_singlePassLightingProg);
+
+    // At reduced resolution point lights accumulate irradiance into their own target, and the pass below only upsamples it.
+    // Tiled lighting adds them afterwards in a compute pass, which needs a target it can store to.
+    GBufferResources lowResGBuffer;
+    FrameGraphResource irradiance = FrameGraph::c_invalidResource;
+    if ((m_lightingPath == RenderEnums::LIGHTING_QUADS) && (m_lightingResolutionDivisor > 1))
+    {
+        lowResGBuffer = AddLightingDownsamplePasses(gBuffer);
+        irradiance = AddLowResLightingPass(lowResGBuffer, shadows.pointAtlas, pointProgram);
+    }
+
+    m_frameGraph->AddPass("Lighting",
+        [this, &gBuffer, &lowResGBuffer, &lighting, irradiance, &shadows, ambientOcclusion](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.Read(gBuffer.normal);
+            builder.Read(gBuffer.colour);
+            if (ambientOcclusion != FrameGraph::c_invalidResource)
+                builder.Read(ambientOcclusion);
+            if (shadows.cascades != FrameGraph::c_invalidResource)
+                builder.Read(shadows.cascades);
+            if (shadows.pointAtlas != FrameGraph::c_invalidResource)
+                builder.Read(shadows.pointAtlas);
+            if (irradiance != FrameGraph::c_invalidResource)
+            {
+                builder.Read(lowResGBuffer.depth);
+                builder.Read(lowResGBuffer.normal);
+                builder.Read(irradiance);
+            }
+
+            GLType_uint format = (m_lightingPath == RenderEnums::LIGHTING_TILED) ? GL_RGBA16F : GL_SRGB8;    // sRGB formats can't be bound as images.
+            lighting = builder.CreateTexture("Lighting", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, format, GL_LINEAR));
+            lighting = builder.Write(lighting, RenderEnums::ACCESS_RENDER_TARGET);
+
+            if (m_lightingPath == RenderEnums::LIGHTING_VOLUMES)
+            {
+                FrameGraphResource volumeDepth = builder.CreateTexture("LightVolumeDepth", RenderTargetDesc(m_renderTargetWidth, m_renderTargetHeight, GL_DEPTH24_STENCIL8));
+                builder.Write(volumeDepth, RenderEnums::ACCESS_DEPTH_TARGET);
+            }
+        },
+        [this, gBuffer, lowResGBuffer, irradiance, ambientOcclusion, directionalProgram, pointProgram, clusteredLightingProgram, lightVolumeProgram, singlePassLightingProgram](const FrameGraph& frameGraph)
+        {
+            if (m_lightingPath == RenderEnums::LIGHTING_SINGLE_PASS)
+            {
+                RenderSinglePassLighting(frameGraph, gBuffer, ambientOcclusion, singlePassLightingProgram);   // Writes every pixel; nothing to clear.
+                return;
+            }
+
+            if (m_lightingPath == RenderEnums::LIGHTING_VOLUMES)
+                ClearFramebuffer(static_cast<RenderEnums::ClearType>(RenderEnums::CLEAR_COLOUR | RenderEnums::CLEAR_STENCIL));
+            else
+                ClearFramebuffer(RenderEnums::CLEAR_COLOUR);
+            glDisable(GL_DEPTH_TEST);   // Light volumes bring a depth target along; the full-screen passes mustn't test against it.
+            RenderDirectionalAndAmbientLighting(frameGraph, gBuffer, ambientOcclusion, directionalProgram);
+            glEnable(GL_DEPTH_TEST);
+            if (m_lightingPath == RenderEnums::LIGHTING_TILED)
+                return;
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            if (m_lightingPath == RenderEnums::LIGHTING_CLUSTERED)
+                DrawClusteredLights(frameGraph, gBuffer, clusteredLightingProgram);
+            else if (m_lightingPath == RenderEnums::LIGHTING_VOLUMES)
+                DrawLightVolumes(frameGraph, gBuffer, lightVolumeProgram);
+            else if (irradiance != FrameGraph::c_invalidResource)
+                UpsampleLighting(frameGraph, gBuffer, lowResGBuffer, irradiance);
+            else
+                DrawLightList(frameGraph, gBuffer, pointProgram);
+            glDisable(GL_BLEND);
+        });
+
+    if (m_lightingPath == RenderEnums::LIGHTING_TILED)
+        lighting = AddTiledLightingPass(gBuffer, lighting, shadows.pointAtlas);
+
+    return lighting;
+}
+
+GBufferResources GLRenderer::AddLightingDownsamplePasses(const GBufferResources& gBuffer)
+{
+    // One 2x2 reduction per halving. Colour isn't needed at low resolution; albedo is applied after upsampling.
+    GBufferResources lowResGBuffer = gBuffer;
+    uint32_t width = m_renderTargetWidth, height = m_renderTargetHeight;
+    for (uint32_t divisor = 2; divisor <= m_lightingResolutionDivisor; divisor *= 2)
+    {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+
+        GBufferResources source = lowResGBuffer;
+        m_frameGraph->AddPass("LightingDownsample",
+            [this, &source, &lowResGBuffer, width, height](FrameGraph::PassBuilder& builder)
+            {
+                builder.Read(source.depth);
+                builder.Read(source.normal);
+
+                lowResGBuffer.depth = builder.CreateTexture("LowResDepth", RenderTargetDesc(width, height, GL_R32F, GL_NEAREST));
+                lowResGBuffer.normal = builder.CreateTexture("LowResNormal", RenderTargetDesc(width, height, GL_RG16, GL_NEAREST));
+                lowResGBuffer.depth = builder.Write(lowResGBuffer.depth, RenderEnums::ACCESS_RENDER_TARGET, 0);
+                lowResGBuffer.normal = builder.Write(lowResGBuffer.normal, RenderEnums::ACCESS_RENDER_TARGET, 1);
+            },
+            [this, source](const FrameGraph& frameGraph)
+            {
+                using ShaderResourceReferences::fullScreenPassTextures;
+                SetShaderProgram(m_lightingDownsampleProg.get());
+                m_currentProgram->SetTexture(fullScreenPassTextures.u_Depthtex, frameGraph.GetTexture(source.depth));
+                m_currentProgram->SetTexture(fullScreenPassTextures.u_Normaltex, frameGraph.GetTexture(source.normal));
+
+                glDisable(GL_DEPTH_TEST);
+                glDepthMask(GL_FALSE);
+                RenderQuad();
+                glDepthMask(GL_TRUE);
+                glEnable(GL_DEPTH_TEST);
+            });
+    }
+
+    return lowResGBuffer;
+}
+
+FrameGraphResource GLRenderer::AddLowResLightingPass(const GBufferResources& lowResGBuffer, FrameGraphResource pointShadowAtlas, GLProgram* pointProgram)
+{
+    FrameGraphResource irradiance = FrameGraph::c_invalidResource;
+    uint32_t width = (m_renderTargetWidth + m_lightingResolutionDivisor - 1) / m_lightingResolutionDivisor;
+    uint32_t height = (m_renderTargetHeight + m_lightingResolutionDivisor - 1) / m_lightingResolutionDivisor;
+    m_frameGraph->AddPass("LowResLighting",
+        [&lowResGBuffer, &irradiance, pointShadowAtlas, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(lowResGBuffer.depth);
+            builder.Read(lowResGBuffer.normal);
+            builder.Read(lowResGBuffer.colour);     // Bound like every full-screen pass, though the HALF_RES variant doesn't sample it.
+            if (pointShadowAtlas != FrameGraph::c_invalidResource)
+                builder.Read(pointShadowAtlas);
+
+            irradiance = builder.CreateTexture("Irradiance", RenderTargetDesc(width, height, GL_RGBA16F, GL_NEAREST));
+            irradiance = builder.Write(irradiance, RenderEnums::ACCESS_RENDER_TARGET);
+        },
+        [this, lowResGBuffer, pointProgram](const FrameGraph& frameGraph)
+        {
+            ClearFramebuffer(RenderEnums::CLEAR_COLOUR);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            DrawLightList(frameGraph, lowResGBuffer, pointProgram);
+            glDisable(GL_BLEND);
+        });
+
+    return irradiance;
+}
+
+FrameGraphResource GLRenderer::AddTiledLightingPass(const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource pointShadowAtlas)
+{
+    FrameGraphResource output = FrameGraph::c_invalidResource;
+    GLProgram* tiledLightingProgram = SelectVariant(*m_tiledLightingProg);
+    m_frameGraph->AddPass("TiledLighting",
+        [&gBuffer, &output, lighting, pointShadowAtlas](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.Read(gBuffer.normal);
+            builder.Read(gBuffer.colour);
+            if (pointShadowAtlas != FrameGraph::c_invalidResource)
+                builder.Read(pointShadowAtlas);
+            builder.Read(lighting, RenderEnums::ACCESS_IMAGE_LOAD);
+            output = builder.Write(lighting, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, gBuffer, lighting, tiledLightingProgram](const FrameGraph& frameGraph)
+        {
+            if (m_visibleLights.empty())
+                return;
+
+            using ShaderResourceReferences::lightPassResources;
+            SetShaderProgram(tiledLightingProgram);
+            SetTexturesForFullScreenPass(frameGraph, gBuffer);
+            tiledLightingProgram->SetImage(lightPassResources.u_Lightingimg, frameGraph.GetTexture(lighting), GL_RGBA16F);
+            tiledLightingProgram->SetStorageBuffer(lightPassResources.LightList, m_lightBuffer);
+            SetPointShadowResources(tiledLightingProgram);
+            tiledLightingProgram->SetShaderConstant(ShaderResourceReferences::lightPassShaderConstants.uiPointLightCount, static_cast<int>(m_visibleLights.size()));
+
+            // One work group per tile of the render area; the edge groups skip pixels outside it.
+            Dispatch(tiledLightingProgram, (m_width + c_lightingTileSize - 1) / c_lightingTileSize, (m_height + c_lightingTileSize - 1) / c_lightingTileSize, 1);
+        });
+
+    return output;
+}
+
+FrameGraphResource GLRenderer::AddDiagnosticPass(const GBufferResources& gBuffer, FrameGraphResource backbuffer)
+{
+    FrameGraphResource output = FrameGraph::c_invalidResource;
+    m_frameGraph->AddPass("Diagnostic",
+        [&gBuffer, &output, backbuffer](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.Read(gBuffer.normal);
+            builder.Read(gBuffer.colour);
+            output = builder.Write(backbuffer);
+        },
+        [this, gBuffer](const FrameGraph& frameGraph)
+        {
+            ClearFramebuffer(RenderEnums::CLEAR_ALL);
+            glDisable(GL_DEPTH_TEST);
+            RenderFramebuffers(frameGraph, gBuffer);
+            glEnable(GL_DEPTH_TEST);
+        });
+
+    return output;
+}
+
+void GLRenderer::Pick(const glm::vec2& point, const PickCallback& callback)
+{
+    try
+    {
+        m_pendingPicks.push_back(std::make_pair(glm::clamp(point, glm::vec2(0.0f), glm::vec2(1.0f)), callback));
+    }
+    catch (std::bad_alloc&)
+    {
+        assert(false); // Out of memory.
+    }
+}
+
+void GLRenderer::AddDepthReadbackPass(const GBufferResources& gBuffer)
+{
+    // Autofocus reads every frame DOF is on, picks only when there are some.
+    if (!m_DOFEnabled && m_pendingPicks.empty())
+        return;
+
+    // The callbacks run frames later, so everything they need to turn depth into a position is taken from this frame now.
+    std::vector<std::pair<glm::vec2, PickCallback>> picks;
+    picks.swap(m_pendingPicks);
+    glm::vec2 focusPoint = m_focusPoint;
+    bool readFocus = m_DOFEnabled;
+    glm::uvec2 renderSize(m_width, m_height);
+    glm::mat4 inversePerspective = m_spRenderCam->GetInversePerspective();
+    glm::mat4 inverseView = m_spRenderCam->GetInverseView();
+
+    m_frameGraph->AddPass("DepthReadback",
+        [&gBuffer](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.SetSideEffect();    // Its output is on the CPU.
+        },
+        [this, gBuffer, picks, focusPoint, readFocus, renderSize, inversePerspective, inverseView](const FrameGraph& frameGraph)
+        {
+            GLType_uint depthTexture = frameGraph.GetTexture(gBuffer.depth);
+            auto toTexel = [renderSize](const glm::vec2& point) { return glm::min(glm::uvec2(point * glm::vec2(renderSize)), renderSize - 1u); };
+            auto toViewPosition = [inversePerspective](const glm::vec2& point, float depth)
+            {
+                glm::vec4 position = inversePerspective * glm::vec4((glm::vec3(point, depth) * 2.0f) - 1.0f, 1.0f);
+                return glm::vec3(position) / position.w;
+            };
+
+            if (readFocus)
+            {
+                glm::uvec2 texel = toTexel(focusPoint);
+                m_readback->ReadTexture(depthTexture, texel.x, texel.y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT,
+                    [this, focusPoint, toViewPosition](const void* data)
+                    {
+                        float depth = *static_cast<const float*>(data);
+                        float distance = (depth < 1.0f) ? -toViewPosition(focusPoint, depth).z : m_farPlane;
+                        if (m_focusTarget < 0.0f)
+                            m_focalDistance = distance;     // Nothing to pull focus from yet.
+                        m_focusTarget = distance;
+                    });
+                // Refused just means this frame's sample is skipped; the last one stands.
+            }
+
+            for (uint32_t i = 0; i < picks.size(); ++i)
+            {
+                glm::vec2 point = picks[i].first;
+                PickCallback callback = picks[i].second;
+                glm::uvec2 texel = toTexel(point);
+                bool issued = m_readback->ReadTexture(depthTexture, texel.x, texel.y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT,
+                    [callback, point, toViewPosition, inverseView](const void* data)
+                    {
+                        float depth = *static_cast<const float*>(data);
+                        glm::vec3 worldPosition = glm::vec3(inverseView * glm::vec4(toViewPosition(point, depth), 1.0f));
+                        callback(depth < 1.0f, worldPosition);
+                    });
+                if (!issued)
+                    Pick(point, callback);      // Tried again next frame.
+            }
+        });
+}
+
+FrameGraphResource GLRenderer::AddColourPyramidPass(FrameGraphResource lighting)
+{
+    // Laid out like the depth pyramid, see AddDepthPyramidPass().
+    uint32_t width = (m_renderTargetWidth + 1) / 2, height = (m_renderTargetHeight + 1) / 2;
+    glm::vec2 viewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+    uint32_t renderWidth = std::max(static_cast<uint32_t>((width * viewportScale.x) + 0.5f), 1u);
+    uint32_t renderHeight = std::max(static_cast<uint32_t>((height * viewportScale.y) + 0.5f), 1u);
+    uint32_t groupsX = (renderWidth + c_mipPyramidGroupSize - 1) / c_mipPyramidGroupSize;
+    uint32_t groupsY = (renderHeight + c_mipPyramidGroupSize - 1) / c_mipPyramidGroupSize;
+
+    std::shared_ptr<FrameGraphResource> colourPyramid = std::make_shared<FrameGraphResource>(FrameGraph::c_invalidResource);
+    m_frameGraph->AddPass("ColourPyramid",
+        [lighting, colourPyramid, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(lighting);
+
+            *colourPyramid = builder.CreateTexture("ColourPyramid", RenderTargetDesc(width, height, GL_R11F_G11F_B10F, GL_LINEAR, c_mipPyramidLevels));
+            *colourPyramid = builder.Write(*colourPyramid, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, lighting, colourPyramid, groupsX, groupsY](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::mipPyramidPassResources;
+            const ImageReference images[c_mipPyramidLevels] = { mipPyramidPassResources.u_ColourPyramid0img, mipPyramidPassResources.u_ColourPyramid1img,
+                mipPyramidPassResources.u_ColourPyramid2img, mipPyramidPassResources.u_ColourPyramid3img };
+
+            SetShaderProgram(m_colourPyramidProg.get());
+            m_currentProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Posttex, frameGraph.GetTexture(lighting));
+            for (uint32_t level = 0; level < c_mipPyramidLevels; ++level)
+                m_currentProgram->SetImage(images[level], frameGraph.GetTexture(*colourPyramid), GL_R11F_G11F_B10F, level);
+            Dispatch(m_colourPyramidProg.get(), groupsX, groupsY, 1);
+        });
+
+    return *colourPyramid;
+}
+
+DepthOfFieldResources GLRenderer::AddDepthOfFieldPasses(const MipPyramidResources& mipPyramid)
+{
+    DepthOfFieldResources depthOfField = { FrameGraph::c_invalidResource, FrameGraph::c_invalidResource };
+    if (!m_DOFEnabled)
+        return depthOfField;
+
+    // The fields match the pyramid's half resolution level texel for texel, which is where they're prepared from.
+    uint32_t width = m_frameGraph->GetDesc(mipPyramid.colour).width, height = m_frameGraph->GetDesc(mipPyramid.colour).height;
+    glm::vec2 viewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+    uint32_t renderWidth = std::max(static_cast<uint32_t>((width * viewportScale.x) + 0.5f), 1u);
+    uint32_t renderHeight = std::max(static_cast<uint32_t>((height * viewportScale.y) + 0.5f), 1u);
+
+    // Focus follows the depth read back under the focus point, which arrives a frame or two late; easing towards it hides that.
+    if (m_focusTarget >= 0.0f)
+        m_focalDistance = glm::mix(m_focalDistance, m_focusTarget, c_autofocusRate);
+    float focalDistance = m_focalDistance;
+
+    std::shared_ptr<DepthOfFieldTargets> targets = std::make_shared<DepthOfFieldTargets>();
+    m_frameGraph->AddPass("DOFPrepare",
+        [&mipPyramid, targets, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(mipPyramid.depth);
+            builder.Read(mipPyramid.colour);
+
+            targets->fields[0].nearField = builder.CreateTexture("DOFNear", RenderTargetDesc(width, height, GL_RGBA16F, GL_LINEAR));
+            targets->fields[0].farField = builder.CreateTexture("DOFFar", RenderTargetDesc(width, height, GL_RGBA16F, GL_LINEAR));
+            targets->fields[0].nearField = builder.Write(targets->fields[0].nearField, RenderEnums::ACCESS_IMAGE_STORE);
+            targets->fields[0].farField = builder.Write(targets->fields[0].farField, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, mipPyramid, targets, renderWidth, renderHeight, focalDistance](const FrameGraph& frameGraph)
+        {
+            using ShaderResourceReferences::depthOfFieldPassResources;
+            using ShaderResourceReferences::mipPyramidPassResources;
+            SetShaderProgram(m_dofPrepareProg.get());
+            m_currentProgram->SetShaderConstant(ShaderResourceReferences::depthOfFieldPassShaderConstants.ufDOFFocalDistance, focalDistance);
+            m_currentProgram->SetTexture(mipPyramidPassResources.u_DepthPyramidtex, frameGraph.GetTexture(mipPyramid.depth));
+            m_currentProgram->SetTexture(mipPyramidPassResources.u_ColourPyramidtex, frameGraph.GetTexture(mipPyramid.colour));
+            m_currentProgram->SetImage(depthOfFieldPassResources.u_DOFNearimg, frameGraph.GetTexture(targets->fields[0].nearField), GL_RGBA16F);
+            m_currentProgram->SetImage(depthOfFieldPassResources.u_DOFFarimg, frameGraph.GetTexture(targets->fields[0].farField), GL_RGBA16F);
+            Dispatch(m_dofPrepareProg.get(), (renderWidth + c_dofPrepareGroupSize - 1) / c_dofPrepareGroupSize, (renderHeight + c_dofPrepareGroupSize - 1) / c_dofPrepareGroupSize, 1);
+        });
+
+    // Separable, so x then y. A group covers a run along the axis, so there's a row of groups for every line across it.
+    for (uint32_t axis = 0; axis < 2; ++axis)
+    {
+        DepthOfFieldResources source = targets->fields[axis];
+        uint32_t length = (axis == 0) ? renderWidth : renderHeight, lines = (axis == 0) ? renderHeight : renderWidth;
+        m_frameGraph->AddPass((axis == 0) ? "DOFBlurX" : "DOFBlurY",
+            [targets, source, width, height, axis](FrameGraph::PassBuilder& builder)
+            {
+                builder.Read(source.nearField);
+                builder.Read(source.farField);
+
+                DepthOfFieldResources& fields = targets->fields[axis + 1];
+                fields.nearField = builder.CreateTexture((axis == 0) ? "DOFNearBlurX" : "DOFNearBlurred", RenderTargetDesc(width, height, GL_RGBA16F, GL_LINEAR));
+                fields.farField = builder.CreateTexture((axis == 0) ? "DOFFarBlurX" : "DOFFarBlurred", RenderTargetDesc(width, height, GL_RGBA16F, GL_LINEAR));
+                fields.nearField = builder.Write(fields.nearField, RenderEnums::ACCESS_IMAGE_STORE);
+                fields.farField = builder.Write(fields.farField, RenderEnums::ACCESS_IMAGE_STORE);
+            },
+            [this, targets, source, axis, length, lines](const FrameGraph& frameGraph)
+            {
+                using ShaderResourceReferences::depthOfFieldPassResources;
+                SetShaderProgram(m_dofBlurProg.get());
+                m_currentProgram->SetTexture(depthOfFieldPassResources.u_DOFNeartex, frameGraph.GetTexture(source.nearField));
+                m_currentProgram->SetTexture(depthOfFieldPassResources.u_DOFFartex, frameGraph.GetTexture(source.farField));
+                m_currentProgram->SetImage(depthOfFieldPassResources.u_DOFNearimg, frameGraph.GetTexture(targets->fields[axis + 1].nearField), GL_RGBA16F);
+                m_currentProgram->SetImage(depthOfFieldPassResources.u_DOFFarimg, frameGraph.GetTexture(targets->fields[axis + 1].farField), GL_RGBA16F);
+                m_currentProgram->SetShaderConstant(ShaderResourceReferences::depthOfFieldPassShaderConstants.uiDOFBlurAxis, axis);
+                Dispatch(m_dofBlurProg.get(), (length + c_dofBlurGroupSize - 1) / c_dofBlurGroupSize, lines, 1);
+            });
+    }
+
+    return targets->fields[2];
+}
+
+FrameGraphResource GLRenderer::AddBloomPasses(FrameGraphResource colourPyramid)
+{
+    if (!m_bloomEnabled)
+        return FrameGraph::c_invalidResource;
+
+    // Level 0 is the size of the colour pyramid's, and each level after it half the one before. Groups only cover the part of a
+    // level that holds this frame, rounded the way GetRenderAreaSize() in the shaders does.
+    glm::vec2 viewportScale(static_cast<float>(m_width) / m_renderTargetWidth, static_cast<float>(m_height) / m_renderTargetHeight);
+    uint32_t widths[c_bloomLevels], heights[c_bloomLevels], groupsX[c_bloomLevels], groupsY[c_bloomLevels];
+    for (uint32_t level = 0; level < c_bloomLevels; ++level)
+    {
+        widths[level] = std::max(((m_renderTargetWidth + 1) / 2) >> level, 1u);
+        heights[level] = std::max(((m_renderTargetHeight + 1) / 2) >> level, 1u);
+        uint32_t renderWidth = std::max(static_cast<uint32_t>((widths[level] * viewportScale.x) + 0.5f), 1u);
+        uint32_t renderHeight = std::max(static_cast<uint32_t>((heights[level] * viewportScale.y) + 0.5f), 1u);
+        groupsX[level] = (renderWidth + c_bloomGroupSize - 1) / c_bloomGroupSize;
+        groupsY[level] = (renderHeight + c_bloomGroupSize - 1) / c_bloomGroupSize;
+    }
+
+    // Down the chain. Level 0 is seeded from the colour pyramid, which has already halved the lit frame, so the bright pass only
+    // thresholds it instead of reading the full resolution frame a second time. The steps after it keep bloom's own 13 tap
+    // filter rather than the pyramid's further levels: a 2x2 average lets small bright spots flicker as they move.
+    std::shared_ptr<BloomTargets> targets = std::make_shared<BloomTargets>();
+    for (uint32_t level = 0; level < c_bloomLevels; ++level)
+    {
+        FrameGraphResource source = (level == 0) ? colourPyramid : targets->downsampled[level - 1];
+        uint32_t width = widths[level], height = heights[level], levelGroupsX = groupsX[level], levelGroupsY = groupsY[level];
+        m_frameGraph->AddPass((level == 0) ? "BloomPrefilter" : "BloomDownsample",
+            [targets, source, level, width, height](FrameGraph::PassBuilder& builder)
+            {
+                builder.Read(source);
+                targets->downsampled[level] = builder.CreateTexture("BloomDownsampled", RenderTargetDesc(width, height, GL_R11F_G11F_B10F, GL_LINEAR));
+                targets->downsampled[level] = builder.Write(targets->downsampled[level], RenderEnums::ACCESS_IMAGE_STORE);
+            },
+            [this, targets, source, level, levelGroupsX, levelGroupsY](const FrameGraph& frameGraph)
+            {
+                using ShaderResourceReferences::bloomPassShaderConstants;
+                using ShaderResourceReferences::bloomPassResources;
+                SetShaderProgram(m_bloomDownsampleProg.get());
+                m_currentProgram->SetTexture(bloomPassResources.u_BloomSourcetex, frameGraph.GetTexture(source));
+                m_currentProgram->SetImage(bloomPassResources.u_Bloomimg, frameGraph.GetTexture(targets->downsampled[level]), GL_R11F_G11F_B10F);
+                m_currentProgram->SetShaderConstant(bloomPassShaderConstants.ufBloomThreshold, c_bloomThreshold);
+                m_currentProgram->SetShaderConstant(bloomPassShaderConstants.ufBloomKnee, c_bloomKnee);
+                m_currentProgram->SetShaderConstant(bloomPassShaderConstants.ubBloomPrefilter, level == 0);
+                Dispatch(m_bloomDownsampleProg.get(), levelGroupsX, levelGroupsY, 1);
+            });
+    }
+
+    // And back up, each level adding what came up from below it. The last step scales the sum for the post pass to add as it is.
+    for (uint32_t level = c_bloomLevels - 1; level-- > 0;)
+    {
+        FrameGraphResource source = (level == c_bloomLevels - 2) ? targets->downsampled[level + 1] : targets->upsampled[level + 1];
+        FrameGraphResource base = targets->downsampled[level];
+        uint32_t width = widths[level], height = heights[level], levelGroupsX = groupsX[level], levelGroupsY = groupsY[level];
+        float scale = (level == 0) ? c_bloomIntensity : 1.0f;
+        m_frameGraph->AddPass("BloomUpsample",
+            [targets, source, base, level, width, height](FrameGraph::PassBuilder& builder)
+            {
+                builder.Read(source);
+                builder.Read(base);
+                targets->upsampled[level] = builder.CreateTexture((level == 0) ? "Bloom" : "BloomUpsampled", RenderTargetDesc(width, height, GL_R11F_G11F_B10F, GL_LINEAR));
+                targets->upsampled[level] = builder.Write(targets->upsampled[level], RenderEnums::ACCESS_IMAGE_STORE);
+            },
+            [this, targets, source, base, level, scale, levelGroupsX, levelGroupsY](const FrameGraph& frameGraph)
+            {
+                using ShaderResourceReferences::bloomPassResources;
+                SetShaderProgram(m_bloomUpsampleProg.get());
+                m_currentProgram->SetTexture(bloomPassResources.u_BloomSourcetex, frameGraph.GetTexture(source));
+                m_currentProgram->SetTexture(bloomPassResources.u_BloomBasetex, frameGraph.GetTexture(base));
+                m_currentProgram->SetImage(bloomPassResources.u_Bloomimg, frameGraph.GetTexture(targets->upsampled[level]), GL_R11F_G11F_B10F);
+                m_currentProgram->SetShaderConstant(ShaderResourceReferences::bloomPassShaderConstants.ufBloomScale, scale);
+                Dispatch(m_bloomUpsampleProg.get(), levelGroupsX, levelGroupsY, 1);
+            });
+    }
+
+    return targets->upsampled[0];
+}
+
+FrameGraphResource GLRenderer::AddPostProcessPass(const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource bloom, const DepthOfFieldResources& depthOfField, FrameGraphResource backbuffer)
+{
+    // Every post effect is fused into the one compute pass, which writes the finished, sRGB encoded frame at the window's size.
+    // Compute can't write to the window itself, so a blit copies it there. The handle is shared with the execute callbacks, which
+    // are made before the setup hands it out.
+    std::shared_ptr<FrameGraphResource> postOutput = std::make_shared<FrameGraphResource>(FrameGraph::c_invalidResource);
+    FrameGraphResource output = FrameGraph::c_invalidResource;
+    GLProgram* postProgram = SelectVariant(*m_postProg);
+    uint32_t width = m_outputWidth, height = m_outputHeight;
+    m_frameGraph->AddPass("PostProcess",
+        [&gBuffer, postOutput, lighting, bloom, &depthOfField, width, height](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(gBuffer.depth);
+            builder.Read(gBuffer.normal);
+            builder.Read(lighting);
+            if (bloom != FrameGraph::c_invalidResource)
+                builder.Read(bloom);
+            if (depthOfField.nearField != FrameGraph::c_invalidResource)
+            {
+                builder.Read(depthOfField.nearField);
+                builder.Read(depthOfField.farField);
+            }
+            *postOutput = builder.CreateTexture("PostOutput", RenderTargetDesc(width, height, GL_RGBA8, GL_NEAREST));
+            *postOutput = builder.Write(*postOutput, RenderEnums::ACCESS_IMAGE_STORE);
+        },
+        [this, gBuffer, lighting, bloom, depthOfField, postOutput, postProgram](const FrameGraph& frameGraph)
+        {
+            RenderPostProcessEffects(frameGraph, gBuffer, lighting, bloom, depthOfField, *postOutput, postProgram);
+        });
+
+    m_frameGraph->AddPass("PostBlit",
+        [&output, postOutput, backbuffer](FrameGraph::PassBuilder& builder)
+        {
+            builder.Read(*postOutput, RenderEnums::ACCESS_PASS_BOUND_TARGET);
+            output = builder.Write(backbuffer);
+        },
+        [this, postOutput, width, height](const FrameGraph& frameGraph)
+        {
+            std::vector<std::pair<GLType_uint, GLType_uint>> attachments(1, std::make_pair(GL_COLOR_ATTACHMENT0, frameGraph.GetTexture(*postOutput)));
+            GLType_uint postFramebuffer = m_renderTargetPool->GetFramebuffer(attachments);
+
+            // Already encoded; with GL_FRAMEBUFFER_SRGB on, an sRGB capable window would encode it a second time.
+            glDisable(GL_FRAMEBUFFER_SRGB);
+            glBlitNamedFramebuffer(postFramebuffer, 0, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glEnable(GL_FRAMEBUFFER_SRGB);
+        });
+
+    return output;
+}
+
+void GLRenderer::SetDirectionalLightConstants(GLProgram* program)
+{
+    glm::vec4 dir_light(m_directionalLightDirection, 0.0f);
+    dir_light = m_spRenderCam->GetView() * dir_light;
+    dir_light = glm::normalize(dir_light);
+    dir_light.w = 1.0f; // strength
+    glm::vec3 ambient(0.04f);
+
+    using ShaderResourceReferences::lightPassShaderConstants;
+    program->SetShaderConstant(lightPassShaderConstants.uf4DirecLightDir, dir_light);
+    program->SetShaderConstant(lightPassShaderConstants.uf3AmbientContrib, ambient);
+
+    // Each cascade's matrix goes from view space straight to shadow map coordinates.
+    using ShaderResourceReferences::shadowPassShaderConstants;
+    const ShaderConstantReference viewToShadow[] = { shadowPassShaderConstants.um4ViewToShadow0, shadowPassShaderConstants.um4ViewToShadow1,
+        shadowPassShaderConstants.um4ViewToShadow2, shadowPassShaderConstants.um4ViewToShadow3 };
+    static_assert((sizeof(viewToShadow) / sizeof(viewToShadow[0])) == ShadowCascades::c_cascadeCount, "ShadowCommon.glsl has a matrix per cascade.");
+
+    glm::mat4 inverseView = m_spRenderCam->GetInverseView();
+    glm::vec4 splits, texelSizes;
+    for (uint32_t cascade = 0; cascade < ShadowCascades::c_cascadeCount; ++cascade)
+    {
+        const ShadowCascades::Cascade& thisCascade = m_shadowCascades.GetCascade(cascade);
+        program->SetShaderConstant(viewToShadow[cascade], c_textureBias * thisCascade.viewProjection * inverseView);
+        splits[cascade] = thisCascade.splitFar;
+        texelSizes[cascade] = (2.0f * thisCascade.radius) / ShadowCascades::c_resolution;
+    }
+    program->SetShaderConstant(shadowPassShaderConstants.uf4ShadowSplits, splits);
+    program->SetShaderConstant(shadowPassShaderConstants.uf4ShadowTexelSizes, texelSizes);
+    program->SetShaderConstant(shadowPassShaderConstants.ubShadowsOn, m_shadowsEnabled);
+    program->SetTexture(ShaderResourceReferences::lightPassResources.u_ShadowMaptex, m_shadowMap);
+}
+
+void GLRenderer::SetAmbientOcclusionResources(GLProgram* program, const FrameGraph& frameGraph, FrameGraphResource ambientOcclusion)
+{
+    bool ambientOcclusionOn = (ambientOcclusion != FrameGraph::c_invalidResource);
+    program->SetShaderConstant(ShaderResourceReferences::ambientOcclusionPassShaderConstants.ubAmbientOcclusionOn, ambientOcclusionOn);
+    if (ambientOcclusionOn)
+        program->SetTexture(ShaderResourceReferences::ambientOcclusionPassResources.u_AmbientOcclusiontex, frameGraph.GetTexture(ambientOcclusion));
+}
+
+void GLRenderer::RenderDirectionalAndAmbientLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource ambientOcclusion, GLProgram* directionalProgram)
+{
+    SetShaderProgram(directionalProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    SetDirectionalLightConstants(directionalProgram);
+    SetAmbientOcclusionResources(directionalProgram, frameGraph, ambientOcclusion);
+
+    glDepthMask(GL_FALSE);
+    RenderQuad();
+    glDepthMask(GL_TRUE);
+}
+
+void GLRenderer::RenderSinglePassLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource ambientOcclusion, GLProgram* singlePassLightingProgram)
+{
+    SetShaderProgram(singlePassLightingProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    SetDirectionalLightConstants(singlePassLightingProgram);
+    SetAmbientOcclusionResources(singlePassLightingProgram, frameGraph, ambientOcclusion);
+
+    uint32_t lightCount = glm::min(static_cast<uint32_t>(m_visibleLights.size()), m_singlePassLightLimit);
+    singlePassLightingProgram->SetShaderConstant(ShaderResourceReferences::lightPassShaderConstants.uiPointLightCount, lightCount);
+    if (lightCount > 0)
+    {
+        singlePassLightingProgram->SetStorageBuffer(ShaderResourceReferences::lightPassResources.LightList, m_lightBuffer);
+        SetPointShadowResources(singlePassLightingProgram);
+        singlePassLightingProgram->CommitStorageBufferBindings();
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    RenderQuad();
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void GLRenderer::RenderFramebuffers(const FrameGraph& frameGraph, const GBufferResources& gBuffer)
+{
+    SetShaderProgram(m_diagnosticProg.get());
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    if (m_displayType == RenderEnums::DISPLAY_LIGHT_CLUSTERS)
+        SetLightClusterResources(m_diagnosticProg.get());
+
+    glDepthMask(GL_FALSE);
+    RenderQuad();
+    glDepthMask(GL_TRUE);
+}
+
+void GLRenderer::UpsampleLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, const GBufferResources& lowResGBuffer, FrameGraphResource irradiance)
+{
+    using ShaderResourceReferences::fullScreenPassTextures;
+    SetShaderProgram(m_lightingUpsampleProg.get());
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_LowResDepthtex, frameGraph.GetTexture(lowResGBuffer.depth));
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_LowResNormaltex, frameGraph.GetTexture(lowResGBuffer.normal));
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_Irradiancetex, frameGraph.GetTexture(irradiance));
+
+    glDepthMask(GL_FALSE);
+    RenderQuad();
+    glDepthMask(GL_TRUE);
+}
+
+void GLRenderer::RenderPostProcessEffects(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource bloom, const DepthOfFieldResources& depthOfField, FrameGraphResource output, GLProgram* postProgram)
+{
+    SetShaderProgram(postProgram);
+    SetTexturesForFullScreenPass(frameGraph, gBuffer);
+    postProgram->SetTexture(ShaderResourceReferences::fullScreenPassTextures.u_Posttex, frameGraph.GetTexture(lighting));
+    if (bloom != FrameGraph::c_invalidResource)
+        postProgram->SetTexture(ShaderResourceReferences::bloomPassResources.u_Bloomtex, frameGraph.GetTexture(bloom));
+    if (depthOfField.nearField != FrameGraph::c_invalidResource)
+    {
+        postProgram->SetTexture(ShaderResourceReferences::depthOfFieldPassResources.u_DOFNeartex, frameGraph.GetTexture(depthOfField.nearField));
+        postProgram->SetTexture(ShaderResourceReferences::depthOfFieldPassResources.u_DOFFartex, frameGraph.GetTexture(depthOfField.farField));
+        postProgram->SetShaderConstant(ShaderResourceReferences::depthOfFieldPassShaderConstants.ufDOFFocalDistance, m_focalDistance);
+    }
+    postProgram->SetImage(ShaderResourceReferences::postProcessPassResources.u_PostOutputimg, frameGraph.GetTexture(output), GL_RGBA8);
+
+    // The output is the window's size, not the render resolution's, so every texel of it is covered.
+    const RenderTargetDesc& outputDesc = frameGraph.GetDesc(output);
+    Dispatch(postProgram, (outputDesc.width + c_postGroupSize - 1) / c_postGroupSize, (outputDesc.height + c_postGroupSize - 1) / c_postGroupSize, 1);
+}
+
+void GLRenderer::RenderQuad()
+{
+    DrawGeometry(&m_QuadGeometry);
+}
+
+void GLRenderer::SetShaderProgram(GLProgram* currentlyUsedProgram)
+{ 
+    if (!currentlyUsedProgram->IsReady())
+        currentlyUsedProgram->Finish();     // Still compiling in the background, but we need it now.
+
     m_currentProgram = currentlyUsedProgram; 
     m_currentProgram->SetActive();
 }
 
-void GLRenderer::SetTexturesForFullScreenPass()
+void GLRenderer::SetTexturesForFullScreenPass(const FrameGraph& frameGraph, const GBufferResources& gBuffer)
 {
     using ShaderResourceReferences::fullScreenPassTextures;
-    m_currentProgram->SetTexture(fullScreenPassTextures.u_Depthtex, m_depthTexture);
-    m_currentProgram->SetTexture(fullScreenPassTextures.u_Normaltex, m_normalTexture);
-    m_currentProgram->SetTexture(fullScreenPassTextures.u_Positiontex, m_positionTexture);
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_Depthtex, frameGraph.GetTexture(gBuffer.depth));
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_Normaltex, frameGraph.GetTexture(gBuffer.normal));
+    m_currentProgram->SetTexture(fullScreenPassTextures.u_Colortex, frameGraph.GetTexture(gBuffer.colour));
     m_currentProgram->SetTexture(fullScreenPassTextures.u_RandomNormaltex, m_randomNormalTexture);
     m_currentProgram->SetTexture(fullScreenPassTextures.u_RandomScalartex, m_randomScalarTexture);
 }
@@ -4,8 +4,14 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <functional>
 
 #include "Common.h"
+#include "FrameGraph.h"
+#include "LightClusterGrid.h"
+#include "LightStore.h"
+#include "ShadowAtlas.h"
+#include "ShadowCascades.h"
 #include "ShaderResourceReferences.h"
 
 struct Vertex
@@ -46,21 +52,70 @@ public:
     GLType_uint normal_tex;
     GLType_uint specular_tex;
 
+    // Visibility buffer only: where this mesh's indices start in the scene index buffer, and bindless handles to its textures.
+    uint32_t first_scene_index;
+    uint64_t diffuse_handle;
+    uint64_t normal_handle;
+
     glm::vec3 color;
     glm::mat4 modelMat;
     glm::mat4 inverseModelMat;
+    bool isDynamic;     // Moves between frames. Drawn into the shadow cascades every frame instead of into their cached depth.
 
     std::weak_ptr<VertexSpecification> vertexSpecification;
 };
 
+struct GBufferResources
+{
+    FrameGraphResource depth;
+    FrameGraphResource normal;
+    FrameGraphResource colour;
+};
+
+struct ShadowResources
+{
+    FrameGraphResource cascades;    // The directional light's.
+    FrameGraphResource pointAtlas;
+};
+
+// Mip chains for effects to sample instead of gathering wide neighbourhoods: depth as soon as the G-buffer is drawn, colour
+// once the frame is lit. Level 0 is half the render resolution.
+struct MipPyramidResources
+{
+    FrameGraphResource depth;       // Nearest and furthest linear view distance.
+    FrameGraphResource colour;
+};
+
+// Half resolution depth of field fields, blurred and ready to blend over the sharp image.
+struct DepthOfFieldResources
+{
+    FrameGraphResource nearField;   // In front of the focal plane.
+    FrameGraphResource farField;
+};
+
+class AsyncReadback;
 class Camera;
+class DynamicResolution;
 class GLProgram;
+class GLProgramVariants;
+class PassTimer;
 class ShaderConstantManager;
+class ShaderLibrary;
 struct VertexAttribute;
 class GLRenderer
 {
-    uint32_t m_height;
+public:
+    typedef std::function<void(bool hit, const glm::vec3& worldPosition)> PickCallback;     // hit is false over the background.
+    typedef std::function<void(uint32_t width, uint32_t height, const uint8_t* pixels)> CaptureCallback;    // RGBA8, rows bottom up.
+
+private:
+    uint32_t m_height;      // Internal render resolution, i.e. output size scaled by m_resolutionScale.
     uint32_t m_width;
+    uint32_t m_outputHeight;
+    uint32_t m_outputWidth;
+    uint32_t m_renderTargetWidth;   // What intermediate targets are allocated at: the render resolution at the largest scale.
+    uint32_t m_renderTargetHeight;
+    float m_resolutionScale;
 
     float m_invWidth;
     float m_invHeight;
@@ -73,18 +128,124 @@ class GLRenderer
     // Textures
     GLType_uint m_randomNormalTexture;
     GLType_uint m_randomScalarTexture;
-    GLType_uint m_depthTexture;
-    GLType_uint m_normalTexture;
-    GLType_uint m_positionTexture;
-    GLType_uint m_colorTexture;
-    GLType_uint m_postTexture;
+
+    // Declared before the programs so it outlives them; their preprocessing threads use it.
+    std::shared_ptr<ShaderLibrary> m_spShaderLibrary;
 
     // Techniques
     std::unique_ptr<GLProgram> m_passProg;
-    std::unique_ptr<GLProgram> m_pointProg;
-    std::unique_ptr<GLProgram> m_directionalProg;
+    std::unique_ptr<GLProgramVariants> m_pointProg;
+    std::unique_ptr<GLProgramVariants> m_directionalProg;
     std::unique_ptr<GLProgram> m_diagnosticProg;
-    std::unique_ptr<GLProgram> m_postProg;
+    std::unique_ptr<GLProgramVariants> m_postProg;
+    std::unique_ptr<GLProgram> m_visibilityProg;
+    std::unique_ptr<GLProgram> m_visibilityResolveProg;
+    std::unique_ptr<GLProgram> m_lightingDownsampleProg;
+    std::unique_ptr<GLProgram> m_lightingUpsampleProg;
+    std::unique_ptr<GLProgramVariants> m_tiledLightingProg;
+    std::unique_ptr<GLProgramVariants> m_clusteredLightingProg;
+    std::unique_ptr<GLProgramVariants> m_lightVolumeProg;
+    std::unique_ptr<GLProgramVariants> m_singlePassLightingProg;
+    std::unique_ptr<GLProgram> m_lightStencilProg;
+    std::unique_ptr<GLProgram> m_depthCopyProg;
+    std::unique_ptr<GLProgram> m_shadowProg;
+    std::unique_ptr<GLProgram> m_pointShadowProg;
+    std::unique_ptr<GLProgram> m_aoDownsampleProg;
+    std::unique_ptr<GLProgram> m_ambientOcclusionProg;
+    std::unique_ptr<GLProgram> m_aoBlurProg;
+    std::unique_ptr<GLProgram> m_depthPyramidProg;
+    std::unique_ptr<GLProgram> m_colourPyramidProg;
+    std::unique_ptr<GLProgram> m_dofPrepareProg;
+    std::unique_ptr<GLProgram> m_dofBlurProg;
+    std::unique_ptr<GLProgram> m_bloomDownsampleProg;
+    std::unique_ptr<GLProgram> m_bloomUpsampleProg;
+
+    // Features compiled into program variants. Picked up when the frame graph passes are set up.
+    bool m_toonEnabled;
+    bool m_DOFEnabled;
+    bool m_DOFDebug;
+    glm::vec2 m_focusPoint;     // [0, 1] across the render area from the bottom left. DOF keeps whatever is under it in focus.
+    float m_focusTarget;        // View distance last read back under m_focusPoint. Negative until the first read arrives.
+    float m_focalDistance;      // Eased towards m_focusTarget, so focus is pulled rather than snapped.
+
+    bool m_bloomEnabled;
+
+    // Point lights are accumulated at 1/m_lightingResolutionDivisor of the render resolution (1, 2 or 4), then upsampled.
+    uint32_t m_lightingResolutionDivisor;
+
+    // Anything but LIGHTING_QUADS takes precedence over m_lightingResolutionDivisor.
+    RenderEnums::LightingPath m_lightingPath;
+    bool m_scissorEnabled;      // Light volumes are also clipped to the screen rectangle around their sphere.
+    uint32_t m_singlePassLightLimit;    // LIGHTING_SINGLE_PASS loops over at most this many lights, the nearest ones.
+
+    // Directional light shadows. The cascades' static geometry depth is cached in m_staticShadowMap, a layer per cached cascade,
+    // and copied into m_shadowMap before dynamic casters are drawn over it. m_staticShadowCasters is what was last drawn into the
+    // cache; a different list throws it away.
+    glm::vec3 m_directionalLightDirection;  // World space, towards the light.
+    bool m_shadowsEnabled;      // Point light shadows too.
+    float m_shadowDistance;     // Beyond this view distance nothing is shadowed.
+    ShadowCascades m_shadowCascades;
+    GLType_uint m_shadowMap;
+    GLType_uint m_staticShadowMap;
+    GLType_uint m_shadowFramebuffers[ShadowCascades::c_cascadeCount];
+    GLType_uint m_staticShadowFramebuffers[ShadowCascades::c_cachedCascadeCount];
+    bool m_shadowLayerHasDynamicCasters[ShadowCascades::c_cascadeCount];
+    std::vector<const DrawableGeometry*> m_staticShadowCasters;
+
+    // Point light shadows, a cube of tiles per light in m_pointShadowAtlas, handed out and scheduled by m_shadowAtlas. The faces
+    // drawn this frame go to m_pointShadowFaceBuffer, and the lookups for every shadowed visible light to m_pointShadowBuffer.
+    ShadowAtlas m_shadowAtlas;
+    GLType_uint m_pointShadowAtlas;
+    GLType_uint m_pointShadowFramebuffer;
+    GLType_uint m_pointShadowFaceBuffer;
+    GLType_uint m_pointShadowBuffer;
+    std::vector<const DrawableGeometry*> m_pointShadowStaticCasters;
+    bool m_pointShadowsHadDynamicCasters;
+
+    // Ambient occlusion, at half the render resolution. m_aoHistory holds the last two frames' occlusion before the blur, one to
+    // reproject and blend with and one to write; m_aoHistoryIndex is the one written last, from m_aoHistoryViewProjection. The
+    // passes are timed by m_aoTimer, and the sample count stepped to keep them within m_aoBudget.
+    bool m_ambientOcclusionEnabled;
+    float m_aoRadius;           // View space.
+    float m_aoBudget;           // Milliseconds of GPU time. 0 -> always the most samples.
+    uint32_t m_aoSampleCount;
+    uint32_t m_aoFrameIndex;
+    GLType_uint m_aoHistory[2];
+    uint32_t m_aoHistoryWidth;
+    uint32_t m_aoHistoryHeight;
+    uint32_t m_aoHistoryIndex;
+    bool m_aoHistoryValid;
+    glm::mat4 m_aoHistoryViewProjection;
+    glm::vec2 m_aoHistoryViewportScale;
+    std::unique_ptr<PassTimer> m_aoTimer;
+
+    // Reads back to the CPU go through m_readback and come back a frame or two later, so nothing waits on the GPU: the depth under
+    // the focus point and under each pick, and back buffer captures. Picks and captures wait here until the next frame issues them.
+    std::unique_ptr<AsyncReadback> m_readback;
+    std::vector<std::pair<glm::vec2, PickCallback>> m_pendingPicks;
+    CaptureCallback m_pendingCapture;
+
+    // Visibility buffer (deferred texturing). The resolve pass reaches every material at once, which takes ARB_bindless_texture.
+    bool m_visibilityBufferSupported;
+    bool m_visibilityBufferEnabled;
+    std::vector<Vertex> m_sceneVertices;        // Every mesh concatenated; the resolve pass fetches triangles from these.
+    std::vector<uint32_t> m_sceneIndices;
+    uint32_t m_maxTrianglesPerDraw;
+    GLType_uint m_sceneVertexBuffer;
+    GLType_uint m_sceneIndexBuffer;
+    GLType_uint m_drawDataBuffer;
+    bool m_sceneBuffersDirty;
+
+    // Point lights. Culled and moved to view space on the CPU every frame, then uploaded to m_lightBuffer in one go.
+    LightStore m_lightStore;
+    std::vector<LightStore::ViewSpaceLight> m_visibleLights;
+    GLType_uint m_lightBuffer;
+
+    // Visible lights binned into froxels on the CPU, for the clustered path and its heat map. Uploaded as two storage buffers:
+    // an offset and count per cluster, and the light indices they point into.
+    LightClusterGrid m_lightClusterGrid;
+    GLType_uint m_clusterRangeBuffer;
+    GLType_uint m_clusterIndexBuffer;
     
     GLProgram* m_currentProgram;
 
@@ -95,8 +256,10 @@ class GLRenderer
 
     std::shared_ptr<const Camera> m_spRenderCam;
 
-    // FBOs
-    std::vector<GLType_uint> m_FBO;
+    // Render targets are declared every frame by the passes that use them. The frame graph aliases them and leases them from the pool.
+    std::unique_ptr<RenderTargetPool> m_renderTargetPool;
+    std::unique_ptr<FrameGraph> m_frameGraph;
+    std::unique_ptr<DynamicResolution> m_dynamicResolution;
 
     std::vector<const DrawableGeometry*> m_opaqueList;
     std::vector<const DrawableGeometry*> m_alphaMaskedList;
@@ -111,29 +274,72 @@ class GLRenderer
     ConstantBufferIndex m_perFrameConstBufIndex;
 
     void InitShaders();
+    std::unique_ptr<GLProgram> SubmitProgram(const std::vector<std::pair<std::string, RenderEnums::RenderProgramStage>>& shaderSourceFiles, 
+        const std::map<std::string, GLType_uint>& attributeBindIndices, const std::map<std::string, GLType_uint>& outputBindIndices);
+    std::unique_ptr<GLProgram> SubmitComputeProgram(const std::string& computeShaderSourceFile);
+    void PollPendingPrograms();
+    void ReloadChangedShaders(bool forceCheck);
+    GLProgram* SelectVariant(GLProgramVariants& programVariants) const;
     void InitNoise();
     void InitFramebuffers();
     void InitQuad();
     void InitSphere();
+    void InitShadowMaps();
+    void UpdateRenderResolution();
 
     void CreateBuffersAndUploadData(const Geometry& model, DrawableGeometry& out);
 
     void ClearFramebuffer(RenderEnums::ClearType clearFlags);
 
-    void DrawGeometry(const DrawableGeometry* geom);
+    void DrawGeometry(const DrawableGeometry* geom, uint32_t instanceCount = 1);
 
     void DrawOpaqueList();
+    void DrawVisibilityList();
     void DrawAlphaMaskedList();
     void DrawTransparentList();
-    void DrawLightList();
-    void drawLight(glm::vec3 pos, float strength); //TODORC
-
-    void RenderDirectionalAndAmbientLighting();
-    void RenderFramebuffers();
-    void RenderPostProcessEffects();
+    void DrawLightList(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* pointProgram);
+    void DrawClusteredLights(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* clusteredLightingProgram);
+    void DrawLightVolumes(const FrameGraph& frameGraph, const GBufferResources& gBuffer, GLProgram* lightVolumeProgram);
+    void DrawShadowCasters(const glm::mat4& viewProjection, bool dynamicCasters);
+
+    void SetDirectionalLightConstants(GLProgram* program);
+    void RenderDirectionalAndAmbientLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource ambientOcclusion, GLProgram* directionalProgram);
+    void RenderSinglePassLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource ambientOcclusion, GLProgram* singlePassLightingProgram);
+    void RenderFramebuffers(const FrameGraph& frameGraph, const GBufferResources& gBuffer);
+    void RenderShadowCascades();
+    void RenderPointLightShadows();
+    void UpsampleLighting(const FrameGraph& frameGraph, const GBufferResources& gBuffer, const GBufferResources& lowResGBuffer, FrameGraphResource irradiance);
+    void RenderPostProcessEffects(const FrameGraph& frameGraph, const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource bloom, const DepthOfFieldResources& depthOfField, FrameGraphResource output, GLProgram* postProgram);
     void ApplyPerFrameShaderConstants();
-
-    void SetTexturesForFullScreenPass();
+    void UploadVisibleLights();
+    void AssignPointLightShadows();
+    void SetPointShadowResources(GLProgram* program);
+    void UploadLightClusters();
+    void SetLightClusterResources(GLProgram* program);
+    void UploadVisibilityBuffers();
+    bool CanUseVisibilityBuffer() const;
+    void InitAmbientOcclusionHistory();
+    void SetAmbientOcclusionResources(GLProgram* program, const FrameGraph& frameGraph, FrameGraphResource ambientOcclusion);
+    void UpdateAmbientOcclusionBudget();
+
+    void SetupFrameGraph();
+    GBufferResources AddGBufferPass();
+    GBufferResources AddVisibilityPasses();
+    ShadowResources AddShadowPasses();
+    FrameGraphResource AddDepthPyramidPass(const GBufferResources& gBuffer);
+    FrameGraphResource AddAmbientOcclusionPasses(const GBufferResources& gBuffer, FrameGraphResource depthPyramid);
+    FrameGraphResource AddLightingPass(const GBufferResources& gBuffer, const ShadowResources& shadows, FrameGraphResource ambientOcclusion);
+    GBufferResources AddLightingDownsamplePasses(const GBufferResources& gBuffer);
+    FrameGraphResource AddLowResLightingPass(const GBufferResources& lowResGBuffer, FrameGraphResource pointShadowAtlas, GLProgram* pointProgram);
+    FrameGraphResource AddTiledLightingPass(const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource pointShadowAtlas);
+    void AddDepthReadbackPass(const GBufferResources& gBuffer);
+    FrameGraphResource AddColourPyramidPass(FrameGraphResource lighting);
+    DepthOfFieldResources AddDepthOfFieldPasses(const MipPyramidResources& mipPyramid);
+    FrameGraphResource AddBloomPasses(FrameGraphResource colourPyramid);
+    FrameGraphResource AddDiagnosticPass(const GBufferResources& gBuffer, FrameGraphResource backbuffer);
+    FrameGraphResource AddPostProcessPass(const GBufferResources& gBuffer, FrameGraphResource lighting, FrameGraphResource bloom, const DepthOfFieldResources& depthOfField, FrameGraphResource backbuffer);
+
+    void SetTexturesForFullScreenPass(const FrameGraph& frameGraph, const GBufferResources& gBuffer);
     void SetShaderProgram(GLProgram* currentlyUsedProgram);
     void SetVertexSpecification(const std::weak_ptr<VertexSpecification>& vertexSpec);
     void BindVertexBuffer(GLType_uint vertexBuffer);
@@ -152,7 +358,43 @@ public:
     const DrawableGeometry& GetSphereGeometry() const { return m_SphereGeometry; }
     const float GetNearPlaneDistance() const { return m_nearPlane; }
     const float GetFarPlaneDistance() const { return m_farPlane; }
+    float GetResolutionScale() const { return m_resolutionScale; }
     void SetDisplayType(RenderEnums::DisplayType displayType) { m_displayType = displayType; }
+    void SetToonEnabled(bool isToonEnabled) { m_toonEnabled = isToonEnabled; }
+    void SetDOFEnabled(bool isDOFEnabled) { m_DOFEnabled = isDOFEnabled; }
+    void SetDOFDebug(bool isDOFDebug) { m_DOFDebug = isDOFDebug; }
+    void SetFocusPoint(const glm::vec2& focusPoint) { m_focusPoint = glm::clamp(focusPoint, glm::vec2(0.0f), glm::vec2(1.0f)); }     // As m_focusPoint.
+    void SetBloomEnabled(bool isBloomEnabled) { m_bloomEnabled = isBloomEnabled; }
+    void SetVisibilityBufferEnabled(bool isVisibilityBufferEnabled) { m_visibilityBufferEnabled = isVisibilityBufferEnabled; }
+    bool IsVisibilityBufferSupported() const { return m_visibilityBufferSupported; }
+    void SetLightingResolutionDivisor(uint32_t divisor) { assert((divisor == 1) || (divisor == 2) || (divisor == 4)); m_lightingResolutionDivisor = divisor; }
+    void SetLightingPath(RenderEnums::LightingPath lightingPath) { m_lightingPath = lightingPath; }
+    void SetScissorEnabled(bool isScissorEnabled) { m_scissorEnabled = isScissorEnabled; }
+    void SetSinglePassLightLimit(uint32_t lightLimit) { m_singlePassLightLimit = lightLimit; }
+    void SetShadowsEnabled(bool isShadowsEnabled) { m_shadowsEnabled = isShadowsEnabled; }
+    void SetShadowSceneBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax) { m_shadowCascades.SetSceneBounds(boundsMin, boundsMax); }
+    void SetDirectionalLightDirection(const glm::vec3& lightDirection);
+    void SetAmbientOcclusionEnabled(bool isAmbientOcclusionEnabled) { m_ambientOcclusionEnabled = isAmbientOcclusionEnabled; }
+    void SetAmbientOcclusionBudget(float budget) { m_aoBudget = glm::max(budget, 0.0f); }     // Milliseconds of GPU time. 0 -> no limit.
+    uint32_t GetAmbientOcclusionSampleCount() const { return m_aoSampleCount; }
+    void InvalidateStaticShadows() { m_shadowCascades.InvalidateStaticDepth(); m_shadowAtlas.InvalidateAll(); }   // Static geometry moved without the list changing.
+
+    void Resize(uint32_t width, uint32_t height);
+    void SetResolutionScale(float resolutionScale);
+    void SetTargetFrameTime(float targetFrameTime);     // Milliseconds of GPU time per frame. 0 turns dynamic resolution off.
+    void SetDynamicResolutionRange(float minScale, float maxScale);
+    bool IsDynamicResolutionEnabled() const;
+    float GetGPUFrameTime() const;
+    void ReloadShaders() { ReloadChangedShaders(true); }     // Doesn't wait for the OS to report the change.
+
+    // Neither waits on the GPU; both call back from a later Render(). point is as for SetFocusPoint, and the capture is of the next
+    // frame presented.
+    void Pick(const glm::vec2& point, const PickCallback& callback);
+    void CaptureBackbuffer(const CaptureCallback& callback) { m_pendingCapture = callback; }
+
+    LightStore& GetLightStore() { return m_lightStore; }
+    uint32_t GetVisibleLightCount() const { return static_cast<uint32_t>(m_visibleLights.size()); }
+    uint32_t GetMaxLightsPerCluster() const { return m_lightClusterGrid.GetMaxLightsPerCluster(); }
 
     void AddDrawableGeometryToList(const DrawableGeometry* geometry, RenderEnums::DrawListType listType);
     void ClearLists();
@@ -160,6 +402,9 @@ public:
     void RenderQuad();
     void Render();
 
-    void SetFramebufferActive(GLType_uint fbID);
-    void EndActiveFramebuffer();
+    // Compute. Commits the program's constants, textures, storage buffers and images, then dispatches. barriersAfter is a
+    // combination of RenderEnums::MemoryBarrierType saying who consumes what the dispatch wrote.
+    void Dispatch(GLProgram* computeProgram, uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ, uint32_t barriersAfter = RenderEnums::BARRIER_NONE);
+    void DispatchIndirect(GLProgram* computeProgram, GLType_uint indirectBuffer, uint32_t offset, uint32_t barriersAfter = RenderEnums::BARRIER_NONE);
+    void IssueMemoryBarrier(uint32_t barriers);
 };
\ No newline at end of file
@@ -7,4 +7,5 @@ typedef int32_t GLType_int;
 typedef uint16_t GLType_ushort;
 typedef int16_t GLType_short;
 typedef float GLType_float;
-typedef double GLType_double;
\ No newline at end of file
+typedef double GLType_double;
+typedef struct __GLsync* GLType_sync;
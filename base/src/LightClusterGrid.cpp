@@ -0,0 +1,193 @@
+#include "LightClusterGrid.h"
+
+#include <cmath>
+#include <future>
+#include <thread>
+#include <xmmintrin.h>
+
+namespace
+{
+    // Below this many lights a frame's assignment is cheaper than starting threads for it.
+    const uint32_t c_minLightsForWorkers = 64;
+
+    float GetSliceDistance(uint32_t slice, float nearPlane, float farPlane)
+    {
+        return nearPlane * powf(farPlane / nearPlane, static_cast<float>(slice) / LightClusterGrid::c_countZ);
+    }
+}
+
+LightClusterGrid::LightClusterGrid()
+    : m_boundsNear(0.0f),
+    m_boundsFar(0.0f),
+    m_lightCount(0),
+    m_maxLightsPerCluster(0)
+{}
+
+float LightClusterGrid::GetSliceScale(float nearPlane, float farPlane)
+{
+    return c_countZ / logf(farPlane / nearPlane);
+}
+
+float LightClusterGrid::GetSliceBias(float nearPlane, float farPlane)
+{
+    return -(c_countZ * logf(nearPlane)) / logf(farPlane / nearPlane);
+}
+
+void LightClusterGrid::UpdateClusterBounds(const glm::mat4& perspective, float nearPlane, float farPlane)
+{
+    if ((m_clusterMin.size() == c_clusterCount) && (perspective == m_boundsPerspective) && (nearPlane == m_boundsNear) && (farPlane == m_boundsFar))
+        return;
+
+    m_clusterMin.resize(c_clusterCount);
+    m_clusterMax.resize(c_clusterCount);
+    m_boundsPerspective = perspective;
+    m_boundsNear = nearPlane;
+    m_boundsFar = farPlane;
+
+    // A cluster is the part of its tile's frustum between two slice distances. The projection is symmetric, so at distance d a
+    // tile edge at ndc.x sits at x = ndc.x * d / perspective[0][0]; the box spans both ends of the slice.
+    for (uint32_t slice = 0; slice < c_countZ; ++slice)
+    {
+        float sliceNear = GetSliceDistance(slice, nearPlane, farPlane);
+        float sliceFar = GetSliceDistance(slice + 1, nearPlane, farPlane);
+        for (uint32_t y = 0; y < c_countY; ++y)
+        {
+            float ndcMinY = ((2.0f * y) / c_countY) - 1.0f;
+            float ndcMaxY = ((2.0f * (y + 1)) / c_countY) - 1.0f;
+            for (uint32_t x = 0; x < c_countX; ++x)
+            {
+                float ndcMinX = ((2.0f * x) / c_countX) - 1.0f;
+                float ndcMaxX = ((2.0f * (x + 1)) / c_countX) - 1.0f;
+
+                uint32_t cluster = (((slice * c_countY) + y) * c_countX) + x;
+                m_clusterMin[cluster] = glm::vec3(glm::min(ndcMinX * sliceNear, ndcMinX * sliceFar) / perspective[0][0],
+                    glm::min(ndcMinY * sliceNear, ndcMinY * sliceFar) / perspective[1][1], -sliceFar);
+                m_clusterMax[cluster] = glm::vec3(glm::max(ndcMaxX * sliceNear, ndcMaxX * sliceFar) / perspective[0][0],
+                    glm::max(ndcMaxY * sliceNear, ndcMaxY * sliceFar) / perspective[1][1], -sliceNear);
+            }
+        }
+    }
+}
+
+void LightClusterGrid::AssignSlices(uint32_t firstSlice, uint32_t sliceStride)
+{
+    const uint32_t simdWidth = LightStore::c_simdWidth;
+    std::vector<float> candidateX, candidateY, candidateZ, candidateRadius;
+    std::vector<uint32_t> candidateLights;
+
+    for (uint32_t slice = firstSlice; slice < c_countZ; slice += sliceStride)
+    {
+        // Every cluster in a slice has the same depth range, so lights that miss it are dropped once for the whole slice.
+        uint32_t sliceFirstCluster = slice * c_countX * c_countY;
+        float sliceMinZ = m_clusterMin[sliceFirstCluster].z, sliceMaxZ = m_clusterMax[sliceFirstCluster].z;
+
+        candidateX.clear();
+        candidateY.clear();
+        candidateZ.clear();
+        candidateRadius.clear();
+        candidateLights.clear();
+        for (uint32_t light = 0; light < m_lightCount; ++light)
+        {
+            if (((m_lightZ[light] - m_lightRadius[light]) > sliceMaxZ) || ((m_lightZ[light] + m_lightRadius[light]) < sliceMinZ))
+                continue;
+
+            candidateX.push_back(m_lightX[light]);
+            candidateY.push_back(m_lightY[light]);
+            candidateZ.push_back(m_lightZ[light]);
+            candidateRadius.push_back(m_lightRadius[light]);
+            candidateLights.push_back(light);
+        }
+
+        uint32_t candidateCount = static_cast<uint32_t>(candidateLights.size());
+        uint32_t paddedCount = ((candidateCount + simdWidth - 1) / simdWidth) * simdWidth;
+        candidateX.resize(paddedCount, 0.0f);
+        candidateY.resize(paddedCount, 0.0f);
+        candidateZ.resize(paddedCount, 0.0f);
+        candidateRadius.resize(paddedCount, 0.0f);
+
+        std::vector<uint32_t>& sliceIndices = m_sliceIndices[slice];
+        sliceIndices.clear();
+        for (uint32_t cluster = sliceFirstCluster; cluster < (sliceFirstCluster + (c_countX * c_countY)); ++cluster)
+        {
+            ClusterRange& range = m_ranges[cluster];
+            range.offset = static_cast<uint32_t>(sliceIndices.size());
+
+            // Sphere against box: the squared distance from the centre to its closest point in the box, against radius squared.
+            const __m128 minX = _mm_set1_ps(m_clusterMin[cluster].x), minY = _mm_set1_ps(m_clusterMin[cluster].y), minZ = _mm_set1_ps(m_clusterMin[cluster].z);
+            const __m128 maxX = _mm_set1_ps(m_clusterMax[cluster].x), maxY = _mm_set1_ps(m_clusterMax[cluster].y), maxZ = _mm_set1_ps(m_clusterMax[cluster].z);
+            for (uint32_t first = 0; first < candidateCount; first += simdWidth)
+            {
+                __m128 x = _mm_loadu_ps(&candidateX[first]);
+                __m128 y = _mm_loadu_ps(&candidateY[first]);
+                __m128 z = _mm_loadu_ps(&candidateZ[first]);
+                __m128 radius = _mm_loadu_ps(&candidateRadius[first]);
+
+                __m128 deltaX = _mm_sub_ps(_mm_max_ps(_mm_min_ps(x, maxX), minX), x);
+                __m128 deltaY = _mm_sub_ps(_mm_max_ps(_mm_min_ps(y, maxY), minY), y);
+                __m128 deltaZ = _mm_sub_ps(_mm_max_ps(_mm_min_ps(z, maxZ), minZ), z);
+                __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY)), _mm_mul_ps(deltaZ, deltaZ));
+
+                uint32_t overlapMask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(radius, radius))));
+                if ((candidateCount - first) < simdWidth)
+                    overlapMask &= (1u << (candidateCount - first)) - 1;     // Padding lanes.
+
+                for (uint32_t lane = 0; overlapMask != 0; ++lane, overlapMask >>= 1)
+                {
+                    if (overlapMask & 1)
+                        sliceIndices.push_back(candidateLights[first + lane]);
+                }
+            }
+
+            range.count = static_cast<uint32_t>(sliceIndices.size()) - range.offset;
+        }
+    }
+}
+
+void LightClusterGrid::Build(const std::vector<LightStore::ViewSpaceLight>& lights, const glm::mat4& perspective, float nearPlane, float farPlane)
+{
+    UpdateClusterBounds(perspective, nearPlane, farPlane);
+
+    m_lightCount = static_cast<uint32_t>(lights.size());
+    m_lightX.resize(m_lightCount);
+    m_lightY.resize(m_lightCount);
+    m_lightZ.resize(m_lightCount);
+    m_lightRadius.resize(m_lightCount);
+    for (uint32_t light = 0; light < m_lightCount; ++light)
+    {
+        m_lightX[light] = lights[light].positionAndRadius.x;
+        m_lightY[light] = lights[light].positionAndRadius.y;
+        m_lightZ[light] = lights[light].positionAndRadius.z;
+        m_lightRadius[light] = lights[light].positionAndRadius.w;
+    }
+
+    m_ranges.resize(c_clusterCount);
+    m_sliceIndices.resize(c_countZ);
+
+    // Slices are dealt out round robin: near slices are thin and far ones wide, so contiguous runs would load workers unevenly.
+    uint32_t workerCount = 1;
+    if (m_lightCount >= c_minLightsForWorkers)
+        workerCount = glm::clamp(std::thread::hardware_concurrency(), 1u, static_cast<uint32_t>(c_countZ));
+
+    std::vector<std::future<void>> workers;
+    for (uint32_t worker = 1; worker < workerCount; ++worker)
+        workers.push_back(std::async(std::launch::async, [this, worker, workerCount]() { AssignSlices(worker, workerCount); }));
+    AssignSlices(0, workerCount);
+    for (auto& worker : workers)
+        worker.wait();
+
+    // Pack the slices into one list; cluster offsets were relative to their slice.
+    m_indices.clear();
+    m_maxLightsPerCluster = 0;
+    for (uint32_t slice = 0; slice < c_countZ; ++slice)
+    {
+        uint32_t sliceOffset = static_cast<uint32_t>(m_indices.size());
+        uint32_t sliceFirstCluster = slice * c_countX * c_countY;
+        for (uint32_t cluster = sliceFirstCluster; cluster < (sliceFirstCluster + (c_countX * c_countY)); ++cluster)
+        {
+            m_ranges[cluster].offset += sliceOffset;
+            m_maxLightsPerCluster = glm::max(m_maxLightsPerCluster, m_ranges[cluster].count);
+        }
+
+        m_indices.insert(m_indices.end(), m_sliceIndices[slice].begin(), m_sliceIndices[slice].end());
+    }
+}
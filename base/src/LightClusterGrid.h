@@ -0,0 +1,65 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <vector>
+
+#include "LightStore.h"
+
+// Splits the view frustum into a grid of froxels: c_countX x c_countY screen tiles, and c_countZ depth slices spaced
+// exponentially between the near and far planes. Build() assigns view space lights to every cluster their sphere touches and
+// packs the result into one index list, with an offset and count per cluster. Slices are independent, so they're shared out
+// between worker threads; each tests four lights at a time against a cluster's bounding box with SSE.
+class LightClusterGrid
+{
+public:
+    static const uint32_t c_countX = 16;
+    static const uint32_t c_countY = 9;
+    static const uint32_t c_countZ = 24;
+    static const uint32_t c_clusterCount = c_countX * c_countY * c_countZ;
+
+    // Mirrors ClusterLightRanges in ClusterCommon.glsl (std430).
+    struct ClusterRange
+    {
+        uint32_t offset;    // Into the index list.
+        uint32_t count;
+    };
+
+private:
+    // View space bounding box of every cluster, x fastest, then y, then slice. Rebuilt when the projection changes.
+    std::vector<glm::vec3> m_clusterMin;
+    std::vector<glm::vec3> m_clusterMax;
+    glm::mat4 m_boundsPerspective;
+    float m_boundsNear;
+    float m_boundsFar;
+
+    // Visible lights in SoA form. Each slice copies the ones in its depth range out of these, padded for the SIMD tests.
+    std::vector<float> m_lightX;
+    std::vector<float> m_lightY;
+    std::vector<float> m_lightZ;
+    std::vector<float> m_lightRadius;
+    uint32_t m_lightCount;
+
+    // Per slice output of the workers, with offsets relative to the slice. Packed into the lists below afterwards.
+    std::vector<std::vector<uint32_t>> m_sliceIndices;
+
+    std::vector<ClusterRange> m_ranges;
+    std::vector<uint32_t> m_indices;
+    uint32_t m_maxLightsPerCluster;
+
+    void UpdateClusterBounds(const glm::mat4& perspective, float nearPlane, float farPlane);
+    void AssignSlices(uint32_t firstSlice, uint32_t sliceStride);
+
+public:
+    LightClusterGrid();
+
+    // perspective has to be a symmetric perspective projection, like the ones Camera builds.
+    void Build(const std::vector<LightStore::ViewSpaceLight>& lights, const glm::mat4& perspective, float nearPlane, float farPlane);
+
+    const std::vector<ClusterRange>& GetRanges() const { return m_ranges; }
+    const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+    uint32_t GetMaxLightsPerCluster() const { return m_maxLightsPerCluster; }
+
+    // slice = floor(log(-z) * scale + bias) for a view space z.
+    static float GetSliceScale(float nearPlane, float farPlane);
+    static float GetSliceBias(float nearPlane, float farPlane);
+};
@@ -0,0 +1,128 @@
+#include "LightStore.h"
+
+#include <cassert>
+#include <cmath>
+#include <xmmintrin.h>
+
+LightStore::LightStore()
+    : m_count(0)
+{}
+
+uint32_t LightStore::AddLight(const glm::vec3& position, float radius, const glm::vec3& colour, float intensity)
+{
+    if (m_count == m_positionX.size())
+        Reserve(m_count + 1);
+
+    uint32_t light = m_count++;
+    m_radius[light] = radius;
+    SetPosition(light, position);
+    SetColour(light, colour, intensity);
+    return light;
+}
+
+void LightStore::SetPosition(uint32_t light, const glm::vec3& position)
+{
+    assert(light < m_count);
+    m_positionX[light] = position.x;
+    m_positionY[light] = position.y;
+    m_positionZ[light] = position.z;
+}
+
+void LightStore::SetColour(uint32_t light, const glm::vec3& colour, float intensity)
+{
+    assert(light < m_count);
+    m_colourR[light] = colour.r;
+    m_colourG[light] = colour.g;
+    m_colourB[light] = colour.b;
+    m_intensity[light] = intensity;
+}
+
+void LightStore::Reserve(uint32_t count)
+{
+    uint32_t paddedCount = ((count + c_simdWidth - 1) / c_simdWidth) * c_simdWidth;
+    if (paddedCount <= m_positionX.size())
+        return;
+
+    std::vector<float>* arrays[] = { &m_positionX, &m_positionY, &m_positionZ, &m_radius, &m_colourR, &m_colourG, &m_colourB, &m_intensity };
+    for (std::vector<float>* lightArray : arrays)
+        lightArray->resize(paddedCount, 0.0f);
+}
+
+void LightStore::Clear()
+{
+    std::vector<float>* arrays[] = { &m_positionX, &m_positionY, &m_positionZ, &m_radius, &m_colourR, &m_colourG, &m_colourB, &m_intensity };
+    for (std::vector<float>* lightArray : arrays)
+        lightArray->clear();
+    m_count = 0;
+}
+
+uint32_t LightStore::CullAndTransform(const glm::mat4& view, const glm::mat4& perspective, float nearPlane, float farPlane, std::vector<ViewSpaceLight>& visibleLights) const
+{
+    visibleLights.clear();
+
+    // The first three rows of the view matrix, each element broadcast to all lanes. glm is column major: view[column][row].
+    const __m128 m00 = _mm_set1_ps(view[0][0]), m01 = _mm_set1_ps(view[1][0]), m02 = _mm_set1_ps(view[2][0]), m03 = _mm_set1_ps(view[3][0]);
+    const __m128 m10 = _mm_set1_ps(view[0][1]), m11 = _mm_set1_ps(view[1][1]), m12 = _mm_set1_ps(view[2][1]), m13 = _mm_set1_ps(view[3][1]);
+    const __m128 m20 = _mm_set1_ps(view[0][2]), m21 = _mm_set1_ps(view[1][2]), m22 = _mm_set1_ps(view[2][2]), m23 = _mm_set1_ps(view[3][2]);
+
+    // The side planes of a symmetric frustum pass through the eye. Inside the right plane, xScale * x + z <= 0, and so on for
+    // the others. Distances to them are scaled by the length of the plane normal, so the radius is scaled to match instead.
+    const float xScale = perspective[0][0], yScale = perspective[1][1];
+    const __m128 xPlaneScale = _mm_set1_ps(xScale), yPlaneScale = _mm_set1_ps(yScale);
+    const __m128 xPlaneLength = _mm_set1_ps(sqrtf((xScale * xScale) + 1.0f)), yPlaneLength = _mm_set1_ps(sqrtf((yScale * yScale) + 1.0f));
+    const __m128 nearZ = _mm_set1_ps(-nearPlane), farZ = _mm_set1_ps(-farPlane);
+
+    for (uint32_t first = 0; first < m_count; first += c_simdWidth)
+    {
+        __m128 x = _mm_loadu_ps(&m_positionX[first]);
+        __m128 y = _mm_loadu_ps(&m_positionY[first]);
+        __m128 z = _mm_loadu_ps(&m_positionZ[first]);
+        __m128 radius = _mm_loadu_ps(&m_radius[first]);
+
+        __m128 viewX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_add_ps(_mm_mul_ps(m02, z), m03));
+        __m128 viewY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m12, z), m13));
+        __m128 viewZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_add_ps(_mm_mul_ps(m22, z), m23));
+
+        // Rejected when the whole sphere is behind the near plane, beyond the far plane or outside one of the side planes.
+        __m128 outside = _mm_cmpgt_ps(_mm_sub_ps(viewZ, radius), nearZ);
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(viewZ, radius), farZ));
+
+        __m128 xTerm = _mm_mul_ps(xPlaneScale, viewX);
+        __m128 xRadius = _mm_mul_ps(radius, xPlaneLength);
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_add_ps(viewZ, xTerm), xRadius));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_sub_ps(viewZ, xTerm), xRadius));
+
+        __m128 yTerm = _mm_mul_ps(yPlaneScale, viewY);
+        __m128 yRadius = _mm_mul_ps(radius, yPlaneLength);
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_add_ps(viewZ, yTerm), yRadius));
+        outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_sub_ps(viewZ, yTerm), yRadius));
+
+        uint32_t visibleMask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xF;
+        if ((m_count - first) < c_simdWidth)
+            visibleMask &= (1u << (m_count - first)) - 1;     // Padding lanes.
+        if (visibleMask == 0)
+            continue;
+
+        float lanesX[c_simdWidth], lanesY[c_simdWidth], lanesZ[c_simdWidth];
+        _mm_storeu_ps(lanesX, viewX);
+        _mm_storeu_ps(lanesY, viewY);
+        _mm_storeu_ps(lanesZ, viewZ);
+        for (uint32_t lane = 0; lane < c_simdWidth; ++lane)
+        {
+            if ((visibleMask & (1u << lane)) == 0)
+                continue;
+
+            uint32_t light = first + lane;
+            ViewSpaceLight visibleLight;
+            visibleLight.positionAndRadius = glm::vec4(lanesX[lane], lanesY[lane], lanesZ[lane], m_radius[light]);
+            visibleLight.colourAndIntensity = glm::vec4(m_colourR[light], m_colourG[light], m_colourB[light], m_intensity[light]);
+            visibleLight.light = light;
+            visibleLight.shadow = -1;
+            visibleLight.padding[0] = 0;
+            visibleLight.padding[1] = 0;
+            visibleLights.push_back(visibleLight);
+        }
+    }
+
+    return static_cast<uint32_t>(visibleLights.size());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <vector>
+
+// Point lights in structure-of-arrays form, so the per-frame transform to view space and the frustum test run four lights at a
+// time with SSE. Arrays are padded with zeros to a multiple of c_simdWidth; the padding lanes are masked off, never drawn.
+class LightStore
+{
+public:
+    static const uint32_t c_simdWidth = 4;
+
+    // What the GPU gets per visible light. Mirrors PointLight in LightingCommon.glsl (std430).
+    struct ViewSpaceLight
+    {
+        glm::vec4 positionAndRadius;    // View space.
+        glm::vec4 colourAndIntensity;
+        uint32_t light;                 // Index in the store.
+        int32_t shadow;                 // Index in the renderer's point shadow list, or -1 for none.
+        uint32_t padding[2];            // std430 rounds the struct up to a multiple of its vec4s.
+    };
+
+private:
+    std::vector<float> m_positionX;     // World space.
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_radius;
+    std::vector<float> m_colourR;
+    std::vector<float> m_colourG;
+    std::vector<float> m_colourB;
+    std::vector<float> m_intensity;
+    uint32_t m_count;
+
+public:
+    LightStore();
+
+    uint32_t AddLight(const glm::vec3& position, float radius, const glm::vec3& colour, float intensity);   // Returns the light's index.
+    void SetPosition(uint32_t light, const glm::vec3& position);
+    void SetColour(uint32_t light, const glm::vec3& colour, float intensity);
+    void Reserve(uint32_t count);
+    void Clear();
+
+    uint32_t GetCount() const { return m_count; }
+    glm::vec3 GetPosition(uint32_t light) const { return glm::vec3(m_positionX[light], m_positionY[light], m_positionZ[light]); }
+    float GetRadius(uint32_t light) const { return m_radius[light]; }
+
+    // Replaces visibleLights with the lights whose spheres reach into the view frustum, transformed to view space. perspective
+    // has to be a symmetric perspective projection, like the ones Camera builds. Returns the number of visible lights.
+    uint32_t CullAndTransform(const glm::mat4& view, const glm::mat4& perspective, float nearPlane, float farPlane, std::vector<ViewSpaceLight>& visibleLights) const;
+};
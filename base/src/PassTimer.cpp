@@ -0,0 +1,59 @@
+#include "PassTimer.h"
+#include "gl/glew.h"
+
+PassTimer::PassTimer()
+    : m_issuedQueries(0),
+    m_resolvedQueries(0),
+    m_queryActive(false),
+    m_lastTime(0.0f)
+{
+    glCreateQueries(GL_TIMESTAMP, c_queryCount, m_beginQueries);
+    glCreateQueries(GL_TIMESTAMP, c_queryCount, m_endQueries);
+}
+
+PassTimer::~PassTimer()
+{
+    glDeleteQueries(c_queryCount, m_beginQueries);
+    glDeleteQueries(c_queryCount, m_endQueries);
+}
+
+void PassTimer::Begin()
+{
+    assert(!m_queryActive);
+    if ((m_issuedQueries - m_resolvedQueries) >= c_queryCount)
+        return;     // The GPU is that far behind; go without a measurement rather than wait for one.
+
+    glQueryCounter(m_beginQueries[m_issuedQueries % c_queryCount], GL_TIMESTAMP);
+    m_queryActive = true;
+}
+
+bool PassTimer::End()
+{
+    if (m_queryActive)
+    {
+        glQueryCounter(m_endQueries[m_issuedQueries % c_queryCount], GL_TIMESTAMP);
+        m_queryActive = false;
+        ++m_issuedQueries;
+    }
+
+    // Results become available in submission order, and the end of a pair after its beginning, so the end query decides.
+    bool measured = false;
+    while (m_resolvedQueries != m_issuedQueries)
+    {
+        uint32_t pair = m_resolvedQueries % c_queryCount;
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(m_endQueries[pair], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+            break;
+
+        GLuint64 beginNanoseconds = 0, endNanoseconds = 0;
+        glGetQueryObjectui64v(m_beginQueries[pair], GL_QUERY_RESULT, &beginNanoseconds);
+        glGetQueryObjectui64v(m_endQueries[pair], GL_QUERY_RESULT, &endNanoseconds);
+        ++m_resolvedQueries;
+
+        m_lastTime = static_cast<float>(endNanoseconds - beginNanoseconds) * 1e-6f;
+        measured = true;
+    }
+
+    return measured;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Common.h"
+
+// Measures the GPU time of a stretch of commands with a pair of GL_TIMESTAMP queries. Unlike GL_TIME_ELAPSED, timestamps may be
+// taken while DynamicResolution's frame query is active. As there, results are read back a few frames late and only once the driver
+// says they're available, so measuring never stalls the CPU.
+class PassTimer
+{
+    static const uint32_t c_queryCount = 4;     // Measurements that can be in flight before one is skipped.
+
+    GLType_uint m_beginQueries[c_queryCount];
+    GLType_uint m_endQueries[c_queryCount];
+    uint32_t m_issuedQueries;       // Both count from the first measurement; the pair used is the count modulo c_queryCount.
+    uint32_t m_resolvedQueries;
+    bool m_queryActive;
+    float m_lastTime;
+
+public:
+    PassTimer();
+    ~PassTimer();
+
+    void Begin();
+    bool End();     // Also collects every finished measurement. True if there was at least one.
+
+    float GetLastTime() const { return m_lastTime; }    // Milliseconds.
+};
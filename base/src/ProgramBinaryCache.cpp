@@ -0,0 +1,260 @@
+#include "ProgramBinaryCache.h"
+#include "GLProgram.h"
+#include "Utility.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <Windows.h>
+#include "gl/glew.h"
+
+namespace
+{
+    const char* c_cacheDirectory = ".\\shadercache\\";
+    const uint32_t c_fileMagic = 0x42503650;    // "P6PB"
+    const uint32_t c_fileVersion = 3;           // Bump whenever the layout below or ProgramReflection changes.
+
+    std::string GetCacheFileName(uint64_t key)
+    {
+        std::ostringstream fileName;
+        fileName << c_cacheDirectory << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+        return fileName.str();
+    }
+
+    template<typename T>
+    void Write(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(std::ofstream& file, const std::string& value)
+    {
+        Write(file, static_cast<uint32_t>(value.size()));
+        file.write(value.data(), value.size());
+    }
+
+    template<typename T>
+    bool Read(std::ifstream& file, T& value)
+    {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return file.good();
+    }
+
+    bool ReadString(std::ifstream& file, std::string& value)
+    {
+        uint32_t size = 0;
+        if (!Read(file, size))
+            return false;
+
+        value.resize(size);
+        if (size)
+            file.read(&value[0], size);
+        return file.good();
+    }
+
+    uint64_t HashString(const std::string& value, uint64_t hash)
+    {
+        return Utility::HashBytes64(value.data(), value.size() + 1, hash);   // Include the terminator so "ab"+"c" != "a"+"bc".
+    }
+
+    uint64_t HashBindIndices(const std::map<std::string, GLType_uint>& bindIndices, uint64_t hash)
+    {
+        for (const auto& itr : bindIndices)
+        {
+            hash = HashString(itr.first, hash);
+            hash = Utility::HashBytes64(&itr.second, sizeof(itr.second), hash);
+        }
+
+        return hash;
+    }
+}
+
+namespace ProgramBinaryCache
+{
+    uint64_t ComputeKey(const std::vector<std::string>& preprocessedSources, const std::vector<std::string>& keywords, const std::map<std::string, GLType_uint>& attributeBindIndices,
+        const std::map<std::string, GLType_uint>& outputBindIndices)
+    {
+        uint64_t hash = Utility::HashBytes64(&c_fileVersion, sizeof(c_fileVersion));
+        for (const std::string& source : preprocessedSources)
+            hash = HashString(source, hash);
+        for (const std::string& keyword : keywords)
+            hash = HashString(keyword, hash);   // GLSL has them baked in already, SPIR-V modules don't.
+
+        hash = HashBindIndices(attributeBindIndices, hash);
+        hash = HashBindIndices(outputBindIndices, hash);
+
+        // Binaries are only valid for the exact driver that produced them.
+        const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (GLenum name : driverStrings)
+        {
+            const char* driverString = reinterpret_cast<const char*>(glGetString(name));
+            hash = HashString(driverString ? driverString : "", hash);
+        }
+
+        return hash;
+    }
+
+    bool IsSupported()
+    {
+        GLType_int numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }
+
+    bool Load(uint64_t key, GLType_uint& binaryFormat, std::vector<char>& binary, ProgramReflection& reflection)
+    {
+        std::ifstream file(GetCacheFileName(key).c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        uint32_t magic = 0, version = 0;
+        uint64_t storedKey = 0;
+        if (!Read(file, magic) || !Read(file, version) || !Read(file, storedKey))
+            return false;
+        if ((magic != c_fileMagic) || (version != c_fileVersion) || (storedKey != key))
+            return false;
+
+        uint32_t binarySize = 0;
+        if (!Read(file, binaryFormat) || !Read(file, binarySize) || (binarySize == 0))
+            return false;
+        binary.resize(binarySize);
+        file.read(&binary[0], binarySize);
+
+        uint32_t numConstantBuffers = 0;
+        if (!Read(file, numConstantBuffers))
+            return false;
+        reflection.constantBuffers.resize(numConstantBuffers);
+        for (auto& constantBuffer : reflection.constantBuffers)
+        {
+            uint32_t numSignatures = 0, numConstants = 0;
+            if (!ReadString(file, constantBuffer.name) || !Read(file, constantBuffer.size) || !Read(file, constantBuffer.bindPoint) || !Read(file, numSignatures))
+                return false;
+
+            constantBuffer.signature.resize(numSignatures);
+            for (auto& signature : constantBuffer.signature)
+            {
+                uint32_t type = 0;
+                if (!ReadString(file, signature.name) || !Read(file, type) || !Read(file, signature.size) || !Read(file, signature.offset))
+                    return false;
+                signature.type = static_cast<ShaderConstantManager::SupportedTypes>(type);
+            }
+
+            if (!Read(file, numConstants))
+                return false;
+            constantBuffer.constantNames.resize(numConstants);
+            for (auto& constantName : constantBuffer.constantNames)
+            {
+                if (!ReadString(file, constantName))
+                    return false;
+            }
+        }
+
+        uint32_t numTextures = 0;
+        if (!Read(file, reflection.fixedTextureUnits) || !Read(file, numTextures))
+            return false;
+        reflection.textures.resize(numTextures);
+        for (auto& texture : reflection.textures)
+        {
+            if (!ReadString(file, texture.first) || !Read(file, texture.second))
+                return false;
+        }
+
+        uint32_t numStorageBuffers = 0;
+        if (!Read(file, numStorageBuffers))
+            return false;
+        reflection.storageBuffers.resize(numStorageBuffers);
+        for (auto& storageBuffer : reflection.storageBuffers)
+        {
+            if (!ReadString(file, storageBuffer.first) || !Read(file, storageBuffer.second))
+                return false;
+        }
+
+        uint32_t numImages = 0;
+        if (!Read(file, numImages))
+            return false;
+        reflection.images.resize(numImages);
+        for (auto& image : reflection.images)
+        {
+            if (!ReadString(file, image.name) || !Read(file, image.unit) || !Read(file, image.access))
+                return false;
+        }
+
+        return true;
+    }
+
+    void Store(uint64_t key, GLType_uint program, const ProgramReflection& reflection)
+    {
+        GLType_int binarySize = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+        if (binarySize <= 0)
+            return;
+
+        std::vector<char> binary(binarySize);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, binarySize, nullptr, &binaryFormat, &binary[0]);
+
+        CreateDirectoryA(c_cacheDirectory, nullptr);
+        std::ofstream file(GetCacheFileName(key).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            Utility::LogMessageAndEndLine("Unable to write to the shader cache.");
+            return;
+        }
+
+        Write(file, c_fileMagic);
+        Write(file, c_fileVersion);
+        Write(file, key);
+        Write(file, static_cast<GLType_uint>(binaryFormat));
+        Write(file, static_cast<uint32_t>(binarySize));
+        file.write(&binary[0], binarySize);
+
+        Write(file, static_cast<uint32_t>(reflection.constantBuffers.size()));
+        for (const auto& constantBuffer : reflection.constantBuffers)
+        {
+            WriteString(file, constantBuffer.name);
+            Write(file, constantBuffer.size);
+            Write(file, constantBuffer.bindPoint);
+
+            Write(file, static_cast<uint32_t>(constantBuffer.signature.size()));
+            for (const auto& signature : constantBuffer.signature)
+            {
+                WriteString(file, signature.name);
+                Write(file, static_cast<uint32_t>(signature.type));
+                Write(file, signature.size);
+                Write(file, signature.offset);
+            }
+
+            Write(file, static_cast<uint32_t>(constantBuffer.constantNames.size()));
+            for (const auto& constantName : constantBuffer.constantNames)
+                WriteString(file, constantName);
+        }
+
+        Write(file, reflection.fixedTextureUnits);
+        Write(file, static_cast<uint32_t>(reflection.textures.size()));
+        for (const auto& texture : reflection.textures)
+        {
+            WriteString(file, texture.first);
+            Write(file, texture.second);
+        }
+
+        Write(file, static_cast<uint32_t>(reflection.storageBuffers.size()));
+        for (const auto& storageBuffer : reflection.storageBuffers)
+        {
+            WriteString(file, storageBuffer.first);
+            Write(file, storageBuffer.second);
+        }
+
+        Write(file, static_cast<uint32_t>(reflection.images.size()));
+        for (const auto& image : reflection.images)
+        {
+            WriteString(file, image.name);
+            Write(file, image.unit);
+            Write(file, image.access);
+        }
+    }
+
+    void Evict(uint64_t key)
+    {
+        DeleteFileA(GetCacheFileName(key).c_str());
+    }
+}
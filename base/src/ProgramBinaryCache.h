@@ -0,0 +1,23 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+struct ProgramReflection;
+
+// On-disk cache of linked program binaries and their reflection data. Entries are keyed by a hash of the fully preprocessed
+// sources (or SPIR-V modules), the keywords, the attribute/output bind locations and the driver identification strings, so a driver update or a shader edit
+// simply misses the cache. A binary the driver refuses to load is treated as a miss by the caller.
+namespace ProgramBinaryCache
+{
+    uint64_t ComputeKey(const std::vector<std::string>& preprocessedSources, const std::vector<std::string>& keywords, const std::map<std::string, GLType_uint>& attributeBindIndices,
+        const std::map<std::string, GLType_uint>& outputBindIndices);
+
+    bool IsSupported();
+    bool Load(uint64_t key, GLType_uint& binaryFormat, std::vector<char>& binary, ProgramReflection& reflection);
+    void Store(uint64_t key, GLType_uint program, const ProgramReflection& reflection);
+    void Evict(uint64_t key);
+}
@@ -0,0 +1,230 @@
+#include "RenderTargetPool.h"
+#include "Utility.h"
+#include "gl/glew.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace
+{
+    // Approximate; drivers are free to pad. Three channel formats are assumed to be stored as four.
+    uint32_t GetBytesPerPixel(GLType_uint internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_R8:
+            return 1;
+        case GL_R16F:
+        case GL_RG8:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RGB16F:
+        case GL_RGBA16:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGBA32F:
+        case GL_RGB32F:
+        case GL_RGBA32UI:
+            return 16;
+        default:
+            return 4;
+        }
+    }
+
+    uint64_t GetTextureBytes(const RenderTargetDesc& desc)
+    {
+        uint64_t bytes = 0;
+        uint32_t width = desc.width, height = desc.height;
+        for (uint32_t i = 0; i < desc.levels; ++i)
+        {
+            bytes += static_cast<uint64_t>(width) * height * GetBytesPerPixel(desc.internalFormat);
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+
+        return bytes * std::max(desc.samples, 1u);
+    }
+}
+
+RenderTargetPool::RenderTargetPool()
+    : m_frameIndex(0),
+    m_currentBytes(0),
+    m_peakBytes(0)
+{}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for (auto& itr : m_framebufferCache)
+        glDeleteFramebuffers(1, &itr.second);
+    m_framebufferCache.clear();
+
+    for (auto& itr : m_textures)
+        glDeleteTextures(1, &itr.texture);
+    m_textures.clear();
+}
+
+GLType_uint RenderTargetPool::CreateTexture(const RenderTargetDesc& desc) const
+{
+    GLType_uint texture = 0;
+    if (desc.samples > 0)
+    {
+        glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &texture);
+        glTextureStorage2DMultisample(texture, desc.samples, desc.internalFormat, desc.width, desc.height, GL_TRUE);
+    }
+    else
+    {
+        GLType_int filter = (desc.filter != 0) ? desc.filter : GL_NEAREST;
+        GLType_int minFilter = filter;
+        if (desc.levels > 1)
+            minFilter = (filter == GL_LINEAR) ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST;
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(texture, desc.levels, desc.internalFormat, desc.width, desc.height);
+    }
+    assert(texture != 0);
+
+    return texture;
+}
+
+void RenderTargetPool::DestroyTexture(PooledTexture& pooledTexture)
+{
+    // Any framebuffer built on this texture is now useless.
+    for (auto itr = m_framebufferCache.begin(); itr != m_framebufferCache.end();)
+    {
+        const std::vector<GLType_uint>& key = itr->first;
+        bool referencesTexture = false;
+        for (uint32_t i = 1; i < key.size(); i += 2)
+            referencesTexture |= (key[i] == pooledTexture.texture);
+
+        if (referencesTexture)
+        {
+            glDeleteFramebuffers(1, &itr->second);
+            itr = m_framebufferCache.erase(itr);
+        }
+        else
+            ++itr;
+    }
+
+    glDeleteTextures(1, &pooledTexture.texture);
+    m_currentBytes -= pooledTexture.bytes;
+    pooledTexture.texture = 0;
+}
+
+GLType_uint RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+    for (auto& pooledTexture : m_textures)
+    {
+        if (!pooledTexture.inUse && (pooledTexture.desc == desc))
+        {
+            pooledTexture.inUse = true;
+            pooledTexture.lastUsedFrame = m_frameIndex;
+            return pooledTexture.texture;
+        }
+    }
+
+    PooledTexture newTexture;
+    newTexture.desc = desc;
+    newTexture.texture = CreateTexture(desc);
+    newTexture.bytes = GetTextureBytes(desc);
+    newTexture.lastUsedFrame = m_frameIndex;
+    newTexture.inUse = true;
+    m_textures.push_back(newTexture);
+
+    m_currentBytes += newTexture.bytes;
+    if (m_currentBytes > m_peakBytes)
+    {
+        m_peakBytes = m_currentBytes;
+
+        std::ostringstream peakMessage;
+        peakMessage << "Render target pool peak: " << (m_peakBytes / (1024 * 1024)) << " MB in " << m_textures.size() << " textures.";
+        Utility::LogMessageAndEndLine(peakMessage.str().c_str());
+    }
+
+    return newTexture.texture;
+}
+
+void RenderTargetPool::Release(GLType_uint texture)
+{
+    for (auto& pooledTexture : m_textures)
+    {
+        if (pooledTexture.texture == texture)
+        {
+            assert(pooledTexture.inUse);    // Released twice.
+            pooledTexture.inUse = false;
+            return;
+        }
+    }
+
+    assert(false);  // Not one of ours.
+}
+
+GLType_uint RenderTargetPool::GetFramebuffer(const std::vector<std::pair<GLType_uint, GLType_uint>>& attachments)
+{
+    std::vector<GLType_uint> key;
+    for (const auto& itr : attachments)
+    {
+        key.push_back(itr.first);
+        key.push_back(itr.second);
+    }
+
+    const auto& cacheItr = m_framebufferCache.find(key);
+    if (cacheItr != m_framebufferCache.end())
+        return cacheItr->second;
+
+    GLType_uint fbo = 0;
+    glCreateFramebuffers(1, &fbo);
+
+    std::vector<GLenum> drawBuffers;
+    for (const auto& itr : attachments)
+    {
+        glNamedFramebufferTexture(fbo, itr.first, itr.second, 0);
+        if ((itr.first >= GL_COLOR_ATTACHMENT0) && (itr.first <= GL_COLOR_ATTACHMENT15))
+        {
+            // Draw buffer i is fed by fragment output location i.
+            uint32_t location = itr.first - GL_COLOR_ATTACHMENT0;
+            if (drawBuffers.size() <= location)
+                drawBuffers.resize(location + 1, GL_NONE);
+            drawBuffers[location] = itr.first;
+        }
+    }
+
+    if (drawBuffers.empty())
+        glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+    else
+        glNamedFramebufferDrawBuffers(fbo, static_cast<GLsizei>(drawBuffers.size()), &drawBuffers[0]);
+
+    GLenum FBOstatus = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER);
+    if (FBOstatus != GL_FRAMEBUFFER_COMPLETE)
+        assert(false);
+
+    m_framebufferCache[key] = fbo;
+    return fbo;
+}
+
+void RenderTargetPool::EndFrame()
+{
+    for (auto& pooledTexture : m_textures)
+    {
+        if (!pooledTexture.inUse && ((m_frameIndex - pooledTexture.lastUsedFrame) >= c_framesBeforeEviction))
+            DestroyTexture(pooledTexture);
+    }
+    m_textures.erase(std::remove_if(m_textures.begin(), m_textures.end(), [](const PooledTexture& pooledTexture) { return pooledTexture.texture == 0; }), m_textures.end());
+
+    ++m_frameIndex;
+}
+
+void RenderTargetPool::Clear()
+{
+    for (auto& pooledTexture : m_textures)
+    {
+        if (!pooledTexture.inUse)
+            DestroyTexture(pooledTexture);
+    }
+    m_textures.erase(std::remove_if(m_textures.begin(), m_textures.end(), [](const PooledTexture& pooledTexture) { return pooledTexture.texture == 0; }), m_textures.end());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Common.h"
+
+struct RenderTargetDesc
+{
+    RenderTargetDesc(uint32_t inWidth = 0, uint32_t inHeight = 0, GLType_uint inInternalFormat = 0, GLType_int inFilter = 0, uint32_t inLevels = 1)
+        : width(inWidth),
+        height(inHeight),
+        internalFormat(inInternalFormat),
+        filter(inFilter),
+        levels(inLevels),
+        samples(0)
+    {}
+
+    uint32_t width;
+    uint32_t height;
+    GLType_uint internalFormat;
+    GLType_int filter;      // Used for both minification and magnification; with more than one level, between levels too.
+    uint32_t levels;
+    uint32_t samples;       // 0 -> not multisampled.
+
+    bool operator==(const RenderTargetDesc& other) const
+    {
+        return (width == other.width) && (height == other.height) && (internalFormat == other.internalFormat) &&
+            (filter == other.filter) && (levels == other.levels) && (samples == other.samples);
+    }
+};
+
+// Owns every render target texture and the framebuffers built from them. Textures are handed out by description and returned
+// at the end of the frame; a released texture is handed out again to the next request with the same description. Textures that
+// haven't been asked for in c_framesBeforeEviction frames (e.g. because the resolution changed) are deleted along with every
+// framebuffer that references them, so a resize reallocates lazily instead of stalling on a full teardown.
+class RenderTargetPool
+{
+    struct PooledTexture
+    {
+        RenderTargetDesc desc;
+        GLType_uint texture;
+        uint64_t bytes;
+        uint64_t lastUsedFrame;
+        bool inUse;
+    };
+
+    std::vector<PooledTexture> m_textures;
+    std::map<std::vector<GLType_uint>, GLType_uint> m_framebufferCache;  // Key: (attachment point, texture) pairs flattened.
+
+    uint64_t m_frameIndex;
+    uint64_t m_currentBytes;
+    uint64_t m_peakBytes;
+
+    GLType_uint CreateTexture(const RenderTargetDesc& desc) const;
+    void DestroyTexture(PooledTexture& pooledTexture);
+
+public:
+    static const uint32_t c_framesBeforeEviction = 8;
+
+    RenderTargetPool();
+    ~RenderTargetPool();
+
+    GLType_uint Acquire(const RenderTargetDesc& desc);
+    void Release(GLType_uint texture);
+
+    // Attachments: first -> attachment point; second -> texture. Must be sorted by attachment point.
+    GLType_uint GetFramebuffer(const std::vector<std::pair<GLType_uint, GLType_uint>>& attachments);
+
+    void EndFrame();    // Evicts textures that have been idle for too long.
+    void Clear();       // Deletes everything that isn't currently in use.
+
+    uint64_t GetCurrentBytes() const { return m_currentBytes; }
+    uint64_t GetPeakBytes() const { return m_peakBytes; }
+};
@@ -0,0 +1,295 @@
+#include "ShaderLibrary.h"
+#include "Utility.h"
+
+#include <fstream>
+#include <sstream>
+#include <Windows.h>
+
+std::weak_ptr<ShaderLibrary> ShaderLibrary::singleton;
+
+namespace
+{
+    std::string GetDirectory(const std::string& path)
+    {
+        std::size_t lastSlash = path.find_last_of('/');
+        return (lastSlash != std::string::npos) ? path.substr(0, lastSlash + 1) : std::string();
+    }
+
+    bool ReadWholeFile(const std::string& path, std::string& contents)
+    {
+        std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        contents = buffer.str();
+        return true;
+    }
+
+    // Returns the include name on an #include line, or an empty string if this isn't one.
+    std::string ParseIncludeLine(const std::string& source, std::size_t lineStart, std::size_t lineEnd)
+    {
+        std::size_t first = source.find_first_not_of(" \t", lineStart);
+        if ((first == std::string::npos) || (first >= lineEnd) || (source.compare(first, 8, "#include") != 0))
+            return std::string();
+
+        std::size_t openQuote = source.find('"', first + 8);
+        std::size_t closeQuote = (openQuote != std::string::npos) ? source.find('"', openQuote + 1) : std::string::npos;
+        if ((closeQuote == std::string::npos) || (closeQuote >= lineEnd))
+        {
+            assert(false);  // Header not enclosed in quotes.
+            return std::string();
+        }
+
+        return source.substr(openQuote + 1, closeQuote - openQuote - 1);
+    }
+
+    bool IsPragmaOnceLine(const std::string& source, std::size_t lineStart, std::size_t lineEnd)
+    {
+        std::size_t first = source.find_first_not_of(" \t", lineStart);
+        return (first != std::string::npos) && (first < lineEnd) && (source.compare(first, 12, "#pragma once") == 0);
+    }
+}
+
+ShaderLibrary::ShaderLibrary()
+{}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    for (auto& itr : m_directoryWatches)
+        FindCloseChangeNotification(itr.second);
+    m_directoryWatches.clear();
+}
+
+// We want Create() to create the singular instance, and GetSingleton() to return that instance. Creation needs to be explicit.
+std::shared_ptr<ShaderLibrary> ShaderLibrary::Create()
+{
+    try
+    {
+        return std::shared_ptr<ShaderLibrary>(ShaderLibrary::GetSingleton());
+    }
+    catch (std::bad_weak_ptr&)
+    {
+        ShaderLibrary* pShaderLibrary = new ShaderLibrary;
+        std::shared_ptr<ShaderLibrary> newShaderLibrary = std::shared_ptr<ShaderLibrary>(pShaderLibrary);
+        singleton = newShaderLibrary;
+        return newShaderLibrary;
+    }
+}
+
+std::weak_ptr<ShaderLibrary>& ShaderLibrary::GetSingleton()
+{
+    return singleton;
+}
+
+std::string ShaderLibrary::NormalizePath(const std::string& path)
+{
+    // Forward slashes only, no "." segments and no "dir/.." pairs, so one file always maps to one key.
+    std::string slashed(path);
+    for (char& c : slashed)
+    {
+        if (c == '\\')
+            c = '/';
+    }
+
+    std::vector<std::string> segments;
+    std::size_t segmentStart = 0;
+    while (segmentStart <= slashed.length())
+    {
+        std::size_t segmentEnd = slashed.find('/', segmentStart);
+        if (segmentEnd == std::string::npos)
+            segmentEnd = slashed.length();
+
+        std::string segment = slashed.substr(segmentStart, segmentEnd - segmentStart);
+        if ((segment == "..") && !segments.empty() && (segments.back() != ".."))
+            segments.pop_back();
+        else if (!segment.empty() && (segment != "."))
+            segments.push_back(segment);
+
+        segmentStart = segmentEnd + 1;
+    }
+
+    std::string normalized;
+    for (uint32_t i = 0; i < segments.size(); ++i)
+    {
+        if (i > 0)
+            normalized.push_back('/');
+        normalized.append(segments[i]);
+    }
+
+    return normalized;
+}
+
+uint64_t ShaderLibrary::GetLastWriteTime(const std::string& path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+        return 0;
+
+    return (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+void ShaderLibrary::WatchDirectoryOf(const std::string& path)
+{
+    std::string directory = GetDirectory(path);
+    if (directory.empty())
+        directory = ".";
+    if (m_directoryWatches.count(directory) != 0)
+        return;
+
+    HANDLE changeNotification = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (changeNotification != INVALID_HANDLE_VALUE)
+        m_directoryWatches[directory] = changeNotification;
+}
+
+const ShaderLibrary::SourceFile& ShaderLibrary::GetSourceFile(const std::string& path)
+{
+    const auto& mapItr = m_files.find(path);
+    if (mapItr != m_files.end())
+        return mapItr->second;
+
+    SourceFile& sourceFile = m_files[path];
+    sourceFile.lastWriteTime = GetLastWriteTime(path);
+    WatchDirectoryOf(path);
+
+    std::string contents;
+    if (!ReadWholeFile(path, contents))
+    {
+        std::ostringstream debugOutput;
+        debugOutput << "Unable to open file " << path;
+        Utility::LogMessageAndEndLine(debugOutput.str().c_str());
+        sourceFile.chunks.push_back(std::string());
+        return sourceFile;
+    }
+
+    // Split into the text between #include lines. A single pass; the expanded source is stitched together from these later.
+    std::string directory = GetDirectory(path);
+    std::string currentChunk;
+    std::size_t lineStart = 0;
+    while (lineStart < contents.length())
+    {
+        std::size_t lineEnd = contents.find('\n', lineStart);
+        lineEnd = (lineEnd != std::string::npos) ? lineEnd + 1 : contents.length();
+
+        std::string includeName = ParseIncludeLine(contents, lineStart, lineEnd);
+        if (!includeName.empty())
+        {
+            sourceFile.chunks.push_back(currentChunk);
+            sourceFile.includes.push_back(NormalizePath(directory + includeName));
+            currentChunk.clear();
+        }
+        else if (!IsPragmaOnceLine(contents, lineStart, lineEnd))
+            currentChunk.append(contents, lineStart, lineEnd - lineStart);
+
+        lineStart = lineEnd;
+    }
+    sourceFile.chunks.push_back(currentChunk);
+
+    return sourceFile;
+}
+
+void ShaderLibrary::ExpandInto(const std::string& path, Expansion& expansion)
+{
+    if (!expansion.dependencies.insert(path).second)
+        return; // Already pasted in once.
+
+    const SourceFile& sourceFile = GetSourceFile(path);
+    for (uint32_t i = 0; i < sourceFile.chunks.size(); ++i)
+    {
+        expansion.source.append(sourceFile.chunks[i]);
+        if (i < sourceFile.includes.size())
+        {
+            ExpandInto(sourceFile.includes[i], expansion);
+            if (!expansion.source.empty() && (expansion.source.back() != '\n'))
+                expansion.source.push_back('\n');
+        }
+    }
+}
+
+std::string ShaderLibrary::GetPreprocessedSource(const std::string& path)
+{
+    std::string normalizedPath = NormalizePath(path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto& mapItr = m_expansions.find(normalizedPath);
+    if (mapItr != m_expansions.end())
+        return mapItr->second.source;
+
+    Expansion& expansion = m_expansions[normalizedPath];
+    ExpandInto(normalizedPath, expansion);
+    return expansion.source;
+}
+
+bool ShaderLibrary::DependsOn(const std::string& rootPath, const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto& mapItr = m_expansions.find(NormalizePath(rootPath));
+    if (mapItr == m_expansions.end())
+        return true;    // Never expanded, or already invalidated. Either way it has to be rebuilt.
+
+    return mapItr->second.dependencies.count(NormalizePath(path)) != 0;
+}
+
+uint64_t ShaderLibrary::GetLatestWriteTime(const std::string& rootPath)
+{
+    std::string normalizedPath = NormalizePath(rootPath);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto mapItr = m_expansions.find(normalizedPath);
+    if (mapItr == m_expansions.end())
+    {
+        ExpandInto(normalizedPath, m_expansions[normalizedPath]);
+        mapItr = m_expansions.find(normalizedPath);
+    }
+
+    uint64_t latestWriteTime = 0;
+    for (const std::string& dependency : mapItr->second.dependencies)
+    {
+        if (m_files[dependency].lastWriteTime > latestWriteTime)
+            latestWriteTime = m_files[dependency].lastWriteTime;
+    }
+
+    return latestWriteTime;
+}
+
+std::vector<std::string> ShaderLibrary::PollChangedFiles(bool forceCheck)
+{
+    std::vector<std::string> changedFiles;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    bool anyNotification = forceCheck;
+    for (auto& itr : m_directoryWatches)
+    {
+        if (WaitForSingleObject(itr.second, 0) == WAIT_OBJECT_0)
+        {
+            anyNotification = true;
+            FindNextChangeNotification(itr.second);
+        }
+    }
+
+    if (!anyNotification)
+        return changedFiles;
+
+    // The notification only says something in the directory changed; timestamps say what.
+    for (const auto& itr : m_files)
+    {
+        if (GetLastWriteTime(itr.first) != itr.second.lastWriteTime)
+            changedFiles.push_back(itr.first);
+    }
+
+    for (const std::string& changedFile : changedFiles)
+    {
+        m_files.erase(changedFile);
+        for (auto itr = m_expansions.begin(); itr != m_expansions.end();)
+        {
+            if (itr->second.dependencies.count(changedFile) != 0)
+                itr = m_expansions.erase(itr);
+            else
+                ++itr;
+        }
+    }
+
+    return changedFiles;
+}
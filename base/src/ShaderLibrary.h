@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+// Loads shader source files once, keeps the #include graph between them and memoizes the fully expanded source of every file
+// that has been asked for. Every include behaves as if the included file had #pragma once, so a header pulled in through two
+// paths is only pasted once. Files are watched for changes; a change invalidates only the expansions that transitively include
+// the file. Safe to call from the worker threads that preprocess programs.
+class ShaderLibrary
+{
+    struct SourceFile
+    {
+        std::vector<std::string> chunks;        // Text between #include lines. chunks.size() == includes.size() + 1.
+        std::vector<std::string> includes;      // Resolved paths, in order of appearance.
+        uint64_t lastWriteTime;
+    };
+
+    struct Expansion
+    {
+        std::string source;
+        std::set<std::string> dependencies;     // Every file that went into source, including the root itself.
+    };
+
+    std::map<std::string, SourceFile> m_files;
+    std::map<std::string, Expansion> m_expansions;
+    std::map<std::string, void*> m_directoryWatches;    // Key: directory. Value: change notification handle.
+    mutable std::mutex m_mutex;
+
+    static std::weak_ptr<ShaderLibrary> singleton;
+
+    ShaderLibrary();
+    const SourceFile& GetSourceFile(const std::string& path);
+    void ExpandInto(const std::string& path, Expansion& expansion);
+    void WatchDirectoryOf(const std::string& path);
+
+public:
+    ~ShaderLibrary();
+
+    static std::shared_ptr<ShaderLibrary> Create(); // Caller gets the owning reference.
+    static std::weak_ptr<ShaderLibrary>& GetSingleton();
+
+    std::string GetPreprocessedSource(const std::string& path);
+    bool DependsOn(const std::string& rootPath, const std::string& path) const;
+    uint64_t GetLatestWriteTime(const std::string& rootPath);   // Newest timestamp among rootPath and everything it includes.
+
+    // Returns the files that changed on disk since the last call and drops everything derived from them. Cheap unless the OS
+    // reported a change in one of the watched directories; forceCheck compares every timestamp regardless.
+    std::vector<std::string> PollChangedFiles(bool forceCheck = false);
+
+    static std::string NormalizePath(const std::string& path);
+    static uint64_t GetLastWriteTime(const std::string& path);
+};
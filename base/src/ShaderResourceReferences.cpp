@@ -8,9 +8,22 @@ namespace ShaderResourceReferences
     PerFrameShaderConstantReferences perFrameShaderConstants;
     GeometryPassShaderConstantReferences geometryPassShaderConstants;
     LightPassShaderConstantReferences lightPassShaderConstants;
+    LightPassResourceReferences lightPassResources;
+    ShadowPassShaderConstantReferences shadowPassShaderConstants;
+    ShadowPassResourceReferences shadowPassResources;
+    AmbientOcclusionPassShaderConstantReferences ambientOcclusionPassShaderConstants;
+    AmbientOcclusionPassResourceReferences ambientOcclusionPassResources;
+    MipPyramidPassResourceReferences mipPyramidPassResources;
+    DepthOfFieldPassShaderConstantReferences depthOfFieldPassShaderConstants;
+    DepthOfFieldPassResourceReferences depthOfFieldPassResources;
+    BloomPassShaderConstantReferences bloomPassShaderConstants;
+    BloomPassResourceReferences bloomPassResources;
+    PostProcessPassResourceReferences postProcessPassResources;
+    VisibilityPassShaderConstantReferences visibilityPassShaderConstants;
 
     GeometryPassTextureReferences geometryPassTextures;
     FullScreenPassTextureReferences fullScreenPassTextures;
+    VisibilityPassResourceReferences visibilityPassResources;
 
     void Initialize()
     {
@@ -20,24 +33,95 @@ namespace ShaderResourceReferences
         perFrameShaderConstants.uiScreenWidth = Utility::HashCString("uiScreenWidth");
         perFrameShaderConstants.ufInvScrHeight = Utility::HashCString("ufInvScrHeight");
         perFrameShaderConstants.ufInvScrWidth = Utility::HashCString("ufInvScrWidth");
+        perFrameShaderConstants.ufViewportScaleX = Utility::HashCString("ufViewportScaleX");
+        perFrameShaderConstants.ufViewportScaleY = Utility::HashCString("ufViewportScaleY");
+        perFrameShaderConstants.ufMouseTexX = Utility::HashCString("ufMouseTexX");
+        perFrameShaderConstants.ufMouseTexY = Utility::HashCString("ufMouseTexY");
         perFrameShaderConstants.um4View = Utility::HashCString("um4View");
         perFrameShaderConstants.um4Persp = Utility::HashCString("um4Persp");
+        perFrameShaderConstants.um4InvPersp = Utility::HashCString("um4InvPersp");
         perFrameShaderConstants.ufGlowmask = Utility::HashCString("ufGlowmask");
-        perFrameShaderConstants.ubBloomOn = Utility::HashCString("ubBloomOn");
-        perFrameShaderConstants.ubToonOn = Utility::HashCString("ubToonOn");
-        perFrameShaderConstants.ubDOFOn = Utility::HashCString("ubDOFOn");
-        perFrameShaderConstants.ubDOFDebug = Utility::HashCString("ubDOFDebug");
         perFrameShaderConstants.uiDisplayType = Utility::HashCString("uiDisplayType");
         
         geometryPassShaderConstants.um4Model = Utility::HashCString("um4Model");
         geometryPassShaderConstants.um4InvTrans = Utility::HashCString("um4InvTrans");
         geometryPassShaderConstants.uf3Color = Utility::HashCString("uf3Color");
 
-        lightPassShaderConstants.uf4Light = Utility::HashCString("uf4Light");
-        lightPassShaderConstants.uf3LightCol = Utility::HashCString("uf3LightCol");
         lightPassShaderConstants.uf4DirecLightDir = Utility::HashCString("uf4DirecLightDir");
         lightPassShaderConstants.uf3AmbientContrib = Utility::HashCString("uf3AmbientContrib");
-        lightPassShaderConstants.ufLightIl = Utility::HashCString("ufLightIl");
+        lightPassShaderConstants.uiPointLightCount = Utility::HashCString("uiPointLightCount");
+        lightPassShaderConstants.uiClusterCountX = Utility::HashCString("uiClusterCountX");
+        lightPassShaderConstants.uiClusterCountY = Utility::HashCString("uiClusterCountY");
+        lightPassShaderConstants.uiClusterCountZ = Utility::HashCString("uiClusterCountZ");
+        lightPassShaderConstants.ufClusterSliceScale = Utility::HashCString("ufClusterSliceScale");
+        lightPassShaderConstants.ufClusterSliceBias = Utility::HashCString("ufClusterSliceBias");
+        lightPassShaderConstants.uiLightIndex = Utility::HashCString("uiLightIndex");
+        lightPassResources.LightList = Utility::HashCString("LightList");
+        lightPassResources.u_Lightingimg = Utility::HashCString("u_Lightingimg");
+        lightPassResources.ClusterLightRanges = Utility::HashCString("ClusterLightRanges");
+        lightPassResources.ClusterLightIndices = Utility::HashCString("ClusterLightIndices");
+        lightPassResources.u_ShadowMaptex = Utility::HashCString("u_ShadowMaptex");
+        lightPassResources.PointShadowList = Utility::HashCString("PointShadowList");
+        lightPassResources.u_PointShadowAtlastex = Utility::HashCString("u_PointShadowAtlastex");
+
+        shadowPassShaderConstants.um4ShadowModelViewProj = Utility::HashCString("um4ShadowModelViewProj");
+        shadowPassShaderConstants.um4ViewToShadow0 = Utility::HashCString("um4ViewToShadow0");
+        shadowPassShaderConstants.um4ViewToShadow1 = Utility::HashCString("um4ViewToShadow1");
+        shadowPassShaderConstants.um4ViewToShadow2 = Utility::HashCString("um4ViewToShadow2");
+        shadowPassShaderConstants.um4ViewToShadow3 = Utility::HashCString("um4ViewToShadow3");
+        shadowPassShaderConstants.uf4ShadowSplits = Utility::HashCString("uf4ShadowSplits");
+        shadowPassShaderConstants.uf4ShadowTexelSizes = Utility::HashCString("uf4ShadowTexelSizes");
+        shadowPassShaderConstants.ubShadowsOn = Utility::HashCString("ubShadowsOn");
+        shadowPassShaderConstants.um4PointShadowModel = Utility::HashCString("um4PointShadowModel");
+        shadowPassShaderConstants.uiFirstShadowFace = Utility::HashCString("uiFirstShadowFace");
+
+        shadowPassResources.PointShadowFaces = Utility::HashCString("PointShadowFaces");
+
+        ambientOcclusionPassShaderConstants.um4ViewToPreviousClip = Utility::HashCString("um4ViewToPreviousClip");
+        ambientOcclusionPassShaderConstants.ufAORadius = Utility::HashCString("ufAORadius");
+        ambientOcclusionPassShaderConstants.ufAOHistoryWeight = Utility::HashCString("ufAOHistoryWeight");
+        ambientOcclusionPassShaderConstants.uiAOSampleCount = Utility::HashCString("uiAOSampleCount");
+        ambientOcclusionPassShaderConstants.uiAOFrameIndex = Utility::HashCString("uiAOFrameIndex");
+        ambientOcclusionPassShaderConstants.uiAOBlurAxis = Utility::HashCString("uiAOBlurAxis");
+        ambientOcclusionPassShaderConstants.ubAmbientOcclusionOn = Utility::HashCString("ubAmbientOcclusionOn");
+        ambientOcclusionPassResources.u_AONormalimg = Utility::HashCString("u_AONormalimg");
+        ambientOcclusionPassResources.u_AOimg = Utility::HashCString("u_AOimg");
+        ambientOcclusionPassResources.u_AODepthtex = Utility::HashCString("u_AODepthtex");
+        ambientOcclusionPassResources.u_AONormaltex = Utility::HashCString("u_AONormaltex");
+        ambientOcclusionPassResources.u_AOHistorytex = Utility::HashCString("u_AOHistorytex");
+        ambientOcclusionPassResources.u_AOSourcetex = Utility::HashCString("u_AOSourcetex");
+        ambientOcclusionPassResources.u_AmbientOcclusiontex = Utility::HashCString("u_AmbientOcclusiontex");
+
+        mipPyramidPassResources.u_DepthPyramid0img = Utility::HashCString("u_DepthPyramid0img");
+        mipPyramidPassResources.u_DepthPyramid1img = Utility::HashCString("u_DepthPyramid1img");
+        mipPyramidPassResources.u_DepthPyramid2img = Utility::HashCString("u_DepthPyramid2img");
+        mipPyramidPassResources.u_DepthPyramid3img = Utility::HashCString("u_DepthPyramid3img");
+        mipPyramidPassResources.u_ColourPyramid0img = Utility::HashCString("u_ColourPyramid0img");
+        mipPyramidPassResources.u_ColourPyramid1img = Utility::HashCString("u_ColourPyramid1img");
+        mipPyramidPassResources.u_ColourPyramid2img = Utility::HashCString("u_ColourPyramid2img");
+        mipPyramidPassResources.u_ColourPyramid3img = Utility::HashCString("u_ColourPyramid3img");
+        mipPyramidPassResources.u_DepthPyramidtex = Utility::HashCString("u_DepthPyramidtex");
+        mipPyramidPassResources.u_ColourPyramidtex = Utility::HashCString("u_ColourPyramidtex");
+
+        depthOfFieldPassShaderConstants.uiDOFBlurAxis = Utility::HashCString("uiDOFBlurAxis");
+        depthOfFieldPassShaderConstants.ufDOFFocalDistance = Utility::HashCString("ufDOFFocalDistance");
+        depthOfFieldPassResources.u_DOFNearimg = Utility::HashCString("u_DOFNearimg");
+        depthOfFieldPassResources.u_DOFFarimg = Utility::HashCString("u_DOFFarimg");
+        depthOfFieldPassResources.u_DOFNeartex = Utility::HashCString("u_DOFNeartex");
+        depthOfFieldPassResources.u_DOFFartex = Utility::HashCString("u_DOFFartex");
+
+        bloomPassShaderConstants.ufBloomThreshold = Utility::HashCString("ufBloomThreshold");
+        bloomPassShaderConstants.ufBloomKnee = Utility::HashCString("ufBloomKnee");
+        bloomPassShaderConstants.ufBloomScale = Utility::HashCString("ufBloomScale");
+        bloomPassShaderConstants.ubBloomPrefilter = Utility::HashCString("ubBloomPrefilter");
+        bloomPassResources.u_Bloomimg = Utility::HashCString("u_Bloomimg");
+        bloomPassResources.u_BloomSourcetex = Utility::HashCString("u_BloomSourcetex");
+        bloomPassResources.u_BloomBasetex = Utility::HashCString("u_BloomBasetex");
+        bloomPassResources.u_Bloomtex = Utility::HashCString("u_Bloomtex");
+
+        postProcessPassResources.u_PostOutputimg = Utility::HashCString("u_PostOutputimg");
+
+        visibilityPassShaderConstants.uiDrawID = Utility::HashCString("uiDrawID");
 
         geometryPassTextures.t2DDiffuse = Utility::HashCString("t2DDiffuse");
         geometryPassTextures.t2DNormal = Utility::HashCString("t2DNormal");
@@ -46,9 +130,16 @@ namespace ShaderResourceReferences
         fullScreenPassTextures.u_Depthtex = Utility::HashCString("u_Depthtex");
         fullScreenPassTextures.u_Colortex = Utility::HashCString("u_Colortex");
         fullScreenPassTextures.u_Normaltex = Utility::HashCString("u_Normaltex");
-        fullScreenPassTextures.u_Positiontex = Utility::HashCString("u_Positiontex");
         fullScreenPassTextures.u_RandomNormaltex = Utility::HashCString("u_RandomNormaltex");
         fullScreenPassTextures.u_RandomScalartex = Utility::HashCString("u_RandomScalartex");
         fullScreenPassTextures.u_Posttex = Utility::HashCString("u_Posttex");
+        fullScreenPassTextures.u_LowResDepthtex = Utility::HashCString("u_LowResDepthtex");
+        fullScreenPassTextures.u_LowResNormaltex = Utility::HashCString("u_LowResNormaltex");
+        fullScreenPassTextures.u_Irradiancetex = Utility::HashCString("u_Irradiancetex");
+
+        visibilityPassResources.u_Visibilitytex = Utility::HashCString("u_Visibilitytex");
+        visibilityPassResources.DrawDataList = Utility::HashCString("DrawDataList");
+        visibilityPassResources.SceneVertices = Utility::HashCString("SceneVertices");
+        visibilityPassResources.SceneIndices = Utility::HashCString("SceneIndices");
     }
 }
\ No newline at end of file
@@ -26,6 +26,30 @@ public:
     }
 };
 
+class StorageBufferReference
+{
+    uint32_t m_storageBufferName;
+
+public:
+    StorageBufferReference(uint32_t storageBufferName = 0) { m_storageBufferName = storageBufferName; }
+    operator const uint32_t&() const
+    {
+        return m_storageBufferName;
+    }
+};
+
+class ImageReference
+{
+    uint32_t m_imageName;
+
+public:
+    ImageReference(uint32_t imageName = 0) { m_imageName = imageName; }
+    operator const uint32_t&() const
+    {
+        return m_imageName;
+    }
+};
+
 class ConstantBufferIndex
 {
     uint32_t m_constantBufferIndex;
@@ -48,13 +72,14 @@ namespace ShaderResourceReferences
         ShaderConstantReference uiScreenWidth;
         ShaderConstantReference ufInvScrHeight;
         ShaderConstantReference ufInvScrWidth;
+        ShaderConstantReference ufViewportScaleX;
+        ShaderConstantReference ufViewportScaleY;
+        ShaderConstantReference ufMouseTexX;
+        ShaderConstantReference ufMouseTexY;
         ShaderConstantReference um4View;
         ShaderConstantReference um4Persp;
+        ShaderConstantReference um4InvPersp;
         ShaderConstantReference ufGlowmask;
-        ShaderConstantReference ubBloomOn;
-        ShaderConstantReference ubToonOn;
-        ShaderConstantReference ubDOFOn;
-        ShaderConstantReference ubDOFDebug;
         ShaderConstantReference uiDisplayType;
     };
     extern PerFrameShaderConstantReferences perFrameShaderConstants;
@@ -69,14 +94,136 @@ namespace ShaderResourceReferences
 
     struct LightPassShaderConstantReferences
     {
-        ShaderConstantReference uf4Light;
-        ShaderConstantReference uf3LightCol;
         ShaderConstantReference uf4DirecLightDir;
         ShaderConstantReference uf3AmbientContrib;
-        ShaderConstantReference ufLightIl;
+        ShaderConstantReference uiPointLightCount;
+        ShaderConstantReference uiClusterCountX;
+        ShaderConstantReference uiClusterCountY;
+        ShaderConstantReference uiClusterCountZ;
+        ShaderConstantReference ufClusterSliceScale;
+        ShaderConstantReference ufClusterSliceBias;
+        ShaderConstantReference uiLightIndex;
     };
     extern LightPassShaderConstantReferences lightPassShaderConstants;
 
+    struct LightPassResourceReferences
+    {
+        StorageBufferReference LightList;
+        ImageReference u_Lightingimg;
+        StorageBufferReference ClusterLightRanges;
+        StorageBufferReference ClusterLightIndices;
+        TextureReference u_ShadowMaptex;
+        StorageBufferReference PointShadowList;
+        TextureReference u_PointShadowAtlastex;
+    };
+    extern LightPassResourceReferences lightPassResources;
+
+    struct ShadowPassShaderConstantReferences
+    {
+        ShaderConstantReference um4ShadowModelViewProj;
+        ShaderConstantReference um4ViewToShadow0;
+        ShaderConstantReference um4ViewToShadow1;
+        ShaderConstantReference um4ViewToShadow2;
+        ShaderConstantReference um4ViewToShadow3;
+        ShaderConstantReference uf4ShadowSplits;
+        ShaderConstantReference uf4ShadowTexelSizes;
+        ShaderConstantReference ubShadowsOn;
+        ShaderConstantReference um4PointShadowModel;
+        ShaderConstantReference uiFirstShadowFace;
+    };
+    extern ShadowPassShaderConstantReferences shadowPassShaderConstants;
+
+    struct ShadowPassResourceReferences
+    {
+        StorageBufferReference PointShadowFaces;
+    };
+    extern ShadowPassResourceReferences shadowPassResources;
+
+    struct AmbientOcclusionPassShaderConstantReferences
+    {
+        ShaderConstantReference um4ViewToPreviousClip;
+        ShaderConstantReference ufAORadius;
+        ShaderConstantReference ufAOHistoryWeight;
+        ShaderConstantReference uiAOSampleCount;
+        ShaderConstantReference uiAOFrameIndex;
+        ShaderConstantReference uiAOBlurAxis;
+        ShaderConstantReference ubAmbientOcclusionOn;
+    };
+    extern AmbientOcclusionPassShaderConstantReferences ambientOcclusionPassShaderConstants;
+
+    struct AmbientOcclusionPassResourceReferences
+    {
+        ImageReference u_AONormalimg;
+        ImageReference u_AOimg;
+        TextureReference u_AODepthtex;
+        TextureReference u_AONormaltex;
+        TextureReference u_AOHistorytex;
+        TextureReference u_AOSourcetex;
+        TextureReference u_AmbientOcclusiontex;
+    };
+    extern AmbientOcclusionPassResourceReferences ambientOcclusionPassResources;
+
+    struct MipPyramidPassResourceReferences
+    {
+        ImageReference u_DepthPyramid0img;
+        ImageReference u_DepthPyramid1img;
+        ImageReference u_DepthPyramid2img;
+        ImageReference u_DepthPyramid3img;
+        ImageReference u_ColourPyramid0img;
+        ImageReference u_ColourPyramid1img;
+        ImageReference u_ColourPyramid2img;
+        ImageReference u_ColourPyramid3img;
+        TextureReference u_DepthPyramidtex;
+        TextureReference u_ColourPyramidtex;
+    };
+    extern MipPyramidPassResourceReferences mipPyramidPassResources;
+
+    struct DepthOfFieldPassShaderConstantReferences
+    {
+        ShaderConstantReference uiDOFBlurAxis;
+        ShaderConstantReference ufDOFFocalDistance;
+    };
+    extern DepthOfFieldPassShaderConstantReferences depthOfFieldPassShaderConstants;
+
+    struct DepthOfFieldPassResourceReferences
+    {
+        ImageReference u_DOFNearimg;
+        ImageReference u_DOFFarimg;
+        TextureReference u_DOFNeartex;
+        TextureReference u_DOFFartex;
+    };
+    extern DepthOfFieldPassResourceReferences depthOfFieldPassResources;
+
+    struct BloomPassShaderConstantReferences
+    {
+        ShaderConstantReference ufBloomThreshold;
+        ShaderConstantReference ufBloomKnee;
+        ShaderConstantReference ufBloomScale;
+        ShaderConstantReference ubBloomPrefilter;
+    };
+    extern BloomPassShaderConstantReferences bloomPassShaderConstants;
+
+    struct BloomPassResourceReferences
+    {
+        ImageReference u_Bloomimg;
+        TextureReference u_BloomSourcetex;
+        TextureReference u_BloomBasetex;
+        TextureReference u_Bloomtex;
+    };
+    extern BloomPassResourceReferences bloomPassResources;
+
+    struct PostProcessPassResourceReferences
+    {
+        ImageReference u_PostOutputimg;
+    };
+    extern PostProcessPassResourceReferences postProcessPassResources;
+
+    struct VisibilityPassShaderConstantReferences
+    {
+        ShaderConstantReference uiDrawID;
+    };
+    extern VisibilityPassShaderConstantReferences visibilityPassShaderConstants;
+
     struct GeometryPassTextureReferences
     {
         TextureReference t2DDiffuse;
@@ -90,12 +237,23 @@ namespace ShaderResourceReferences
         TextureReference u_Depthtex;
         TextureReference u_Colortex;
         TextureReference u_Normaltex;
-        TextureReference u_Positiontex;
         TextureReference u_RandomNormaltex;
         TextureReference u_RandomScalartex;
         TextureReference u_Posttex;
+        TextureReference u_LowResDepthtex;
+        TextureReference u_LowResNormaltex;
+        TextureReference u_Irradiancetex;
     };
     extern FullScreenPassTextureReferences fullScreenPassTextures;
 
+    struct VisibilityPassResourceReferences
+    {
+        TextureReference u_Visibilitytex;
+        StorageBufferReference DrawDataList;
+        StorageBufferReference SceneVertices;
+        StorageBufferReference SceneIndices;
+    };
+    extern VisibilityPassResourceReferences visibilityPassResources;
+
     void Initialize();
 }
\ No newline at end of file
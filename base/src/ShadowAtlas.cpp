@@ -0,0 +1,335 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace
+{
+    // Node count of a quadtree from c_size down to c_minTileSize: 1 + 4 + 16 + ... per level.
+    uint32_t GetNodeCount()
+    {
+        uint32_t count = 0, levelCount = 1;
+        for (uint32_t size = ShadowAtlas::c_size; size >= ShadowAtlas::c_minTileSize; size /= 2, levelCount *= 4)
+            count += levelCount;
+        return count;
+    }
+
+    // A light keeps its requested tile size until its coverage is this far past the boundary, so one hovering at it doesn't flip
+    // every frame.
+    const float c_resizeHysteresis = 1.25f;
+
+    // Depth drawn from further away than this, in radii, is of somewhere else entirely; the light is unshadowed until redrawn.
+    const float c_maxStaleMovement = 0.25f;
+
+    // How much each frame since a light was last drawn adds to its priority, so small lights that keep changing still get a turn.
+    const float c_agePriority = 0.1f;
+
+    const float c_nearPlaneFraction = 0.01f;    // Of the light's radius.
+
+    struct UpdateCandidate
+    {
+        uint32_t light;
+        float priority;
+        bool hasDepth;
+    };
+}
+
+ShadowAtlas::ShadowAtlas()
+    : m_nodes(GetNodeCount(), NODE_FREE),
+    m_frame(0)
+{}
+
+bool ShadowAtlas::AllocateNode(uint32_t node, uint32_t nodeSize, uint32_t x, uint32_t y, uint32_t size, bool packOnly, Tile& tile)
+{
+    if (m_nodes[node] == NODE_USED)
+        return false;
+
+    if (nodeSize == size)
+    {
+        if (m_nodes[node] != NODE_FREE)
+            return false;
+
+        m_nodes[node] = NODE_USED;
+        tile.x = x;
+        tile.y = y;
+        tile.size = size;
+        return true;
+    }
+
+    // The packing pass only goes into nodes that are already split, so whole free blocks stay whole for larger tiles.
+    if ((m_nodes[node] == NODE_FREE) && packOnly)
+        return false;
+
+    // A free node's children are all free, so splitting it only takes marking it.
+    NodeState previousState = m_nodes[node];
+    m_nodes[node] = NODE_SPLIT;
+    uint32_t halfSize = nodeSize / 2;
+    for (uint32_t child = 0; child < 4; ++child)
+    {
+        if (AllocateNode((4 * node) + 1 + child, halfSize, x + ((child & 1) * halfSize), y + ((child >> 1) * halfSize), size, packOnly, tile))
+            return true;
+    }
+
+    m_nodes[node] = previousState;
+    return false;
+}
+
+bool ShadowAtlas::AllocateTile(uint32_t size, Tile& tile)
+{
+    return AllocateNode(0, c_size, 0, 0, size, true, tile) || AllocateNode(0, c_size, 0, 0, size, false, tile);
+}
+
+void ShadowAtlas::FreeTile(const Tile& tile)
+{
+    uint32_t node = 0, nodeSize = c_size, x = 0, y = 0;
+    while (nodeSize > tile.size)
+    {
+        nodeSize /= 2;
+        uint32_t child = ((tile.x >= (x + nodeSize)) ? 1 : 0) + ((tile.y >= (y + nodeSize)) ? 2 : 0);
+        x += (child & 1) * nodeSize;
+        y += (child >> 1) * nodeSize;
+        node = (4 * node) + 1 + child;
+    }
+    assert(m_nodes[node] == NODE_USED);
+    m_nodes[node] = NODE_FREE;
+
+    // Merge back up while all four siblings are free.
+    while (node != 0)
+    {
+        uint32_t parent = (node - 1) / 4;
+        uint32_t firstChild = (4 * parent) + 1;
+        for (uint32_t child = firstChild; child < (firstChild + 4); ++child)
+        {
+            if (m_nodes[child] != NODE_FREE)
+                return;
+        }
+
+        m_nodes[parent] = NODE_FREE;
+        node = parent;
+    }
+}
+
+bool ShadowAtlas::AllocateFaces(uint32_t size, Tile* faces)
+{
+    for (uint32_t face = 0; face < c_faceCount; ++face)
+    {
+        if (!AllocateTile(size, faces[face]))
+        {
+            FreeFaces(faces, face);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ShadowAtlas::FreeFaces(const Tile* faces, uint32_t faceCount)
+{
+    for (uint32_t face = 0; face < faceCount; ++face)
+        FreeTile(faces[face]);
+}
+
+bool ShadowAtlas::EvictLeastRecentlyUsed()
+{
+    // Only lights this frame didn't ask for; Schedule() marks the rest used before allocating anything, so a visible light that's
+    // further down the list keeps its tiles.
+    auto evicted = m_slots.end();
+    for (auto it = m_slots.begin(); it != m_slots.end(); ++it)
+    {
+        const Slot& slot = it->second;
+        if (slot.lastUsedFrame >= m_frame)
+            continue;
+
+        if ((evicted == m_slots.end()) || (slot.lastUsedFrame < evicted->second.lastUsedFrame) ||
+            ((slot.lastUsedFrame == evicted->second.lastUsedFrame) && (slot.importance < evicted->second.importance)))
+            evicted = it;
+    }
+
+    if (evicted == m_slots.end())
+        return false;
+
+    FreeFaces(evicted->second.faces, c_faceCount);
+    m_slots.erase(evicted);
+    return true;
+}
+
+void ShadowAtlas::Schedule(std::vector<Request>& requests, bool castersChanged)
+{
+    ++m_frame;
+    m_updates.clear();
+    for (auto& slot : m_slots)
+    {
+        slot.second.updating = false;
+        slot.second.castersChanged = slot.second.castersChanged || castersChanged;
+    }
+
+    std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.importance > b.importance; });
+    if (requests.size() > c_maxShadowedLights)
+        requests.resize(c_maxShadowedLights);
+
+    for (const Request& request : requests)
+    {
+        auto it = m_slots.find(request.light);
+        if (it != m_slots.end())
+            it->second.lastUsedFrame = m_frame;
+    }
+
+    std::vector<UpdateCandidate> candidates;
+    for (const Request& request : requests)
+    {
+        auto it = m_slots.find(request.light);
+        if (it != m_slots.end())
+        {
+            Slot& slot = it->second;
+            if ((GetTileSize(request.screenCoverage * c_resizeHysteresis) < slot.requestedSize) || (GetTileSize(request.screenCoverage / c_resizeHysteresis) > slot.requestedSize))
+                slot.requestedSize = GetTileSize(request.screenCoverage);
+
+            // Shrinking always fits in the space it frees. Growing only happens once the larger tiles fit as things are: a light
+            // that had to settle for smaller ones keeps them, and their depth, rather than being reallocated every frame.
+            Tile faces[c_faceCount];
+            if (slot.requestedSize < slot.faces[0].size)
+            {
+                FreeFaces(slot.faces, c_faceCount);
+                m_slots.erase(it);
+                it = m_slots.end();
+            }
+            else if ((slot.requestedSize > slot.faces[0].size) && AllocateFaces(slot.requestedSize, faces))
+            {
+                FreeFaces(slot.faces, c_faceCount);
+                std::copy(faces, faces + c_faceCount, slot.faces);
+                slot.hasDepth = false;
+            }
+        }
+
+        if (it == m_slots.end())
+        {
+            // Out of room: free the tiles of lights this frame didn't request, and once there are none left, settle for smaller tiles.
+            Slot slot;
+            bool allocated = false;
+            uint32_t size = GetTileSize(request.screenCoverage);
+            while (!allocated && (size >= c_minTileSize))
+            {
+                allocated = AllocateFaces(size, slot.faces);
+                if (!allocated && !EvictLeastRecentlyUsed())
+                    size /= 2;
+            }
+            if (!allocated)
+                continue;
+
+            slot.requestedSize = GetTileSize(request.screenCoverage);
+            slot.renderedPositionAndRadius = request.positionAndRadius;
+            slot.lastRenderedFrame = 0;
+            slot.hasDepth = false;
+            slot.castersChanged = false;
+            slot.updating = false;
+            it = m_slots.insert(std::make_pair(request.light, slot)).first;
+        }
+
+        Slot& slot = it->second;
+        slot.positionAndRadius = request.positionAndRadius;
+        slot.importance = request.importance;
+        slot.lastUsedFrame = m_frame;
+
+        float radius = request.positionAndRadius.w;
+        float movement = glm::length(glm::vec3(request.positionAndRadius - slot.renderedPositionAndRadius)) + glm::abs(radius - slot.renderedPositionAndRadius.w);
+        if (movement > (c_maxStaleMovement * radius))
+            slot.hasDepth = false;
+        if (slot.hasDepth && (movement == 0.0f) && !slot.castersChanged)
+            continue;
+
+        // How much changed, in radii moved plus one for the casters, weighted by how much of the screen it'll show on.
+        float change = glm::min(movement / radius, 1.0f) + (slot.castersChanged ? 1.0f : 0.0f);
+        float age = static_cast<float>(m_frame - slot.lastRenderedFrame);
+        UpdateCandidate candidate;
+        candidate.light = request.light;
+        candidate.priority = request.screenCoverage * (change + (c_agePriority * age));
+        candidate.hasDepth = slot.hasDepth;
+        candidates.push_back(candidate);
+    }
+
+    // Lights with nothing to show go first; the rest keep sampling their old depth a little longer.
+    uint32_t updateCount = glm::min(static_cast<uint32_t>(candidates.size()), c_maxUpdatesPerFrame);
+    std::partial_sort(candidates.begin(), candidates.begin() + updateCount, candidates.end(),
+        [](const UpdateCandidate& a, const UpdateCandidate& b)
+        {
+            return (a.hasDepth != b.hasDepth) ? !a.hasDepth : (a.priority > b.priority);
+        });
+
+    for (uint32_t update = 0; update < updateCount; ++update)
+    {
+        m_slots[candidates[update].light].updating = true;
+        m_updates.push_back(candidates[update].light);
+    }
+}
+
+void ShadowAtlas::InvalidateAll()
+{
+    for (auto& slot : m_slots)
+        slot.second.castersChanged = true;
+}
+
+void ShadowAtlas::Clear()
+{
+    std::fill(m_nodes.begin(), m_nodes.end(), NODE_FREE);
+    m_slots.clear();
+    m_updates.clear();
+}
+
+void ShadowAtlas::MarkRendered(uint32_t light)
+{
+    auto it = m_slots.find(light);
+    if (it == m_slots.end())
+    {
+        assert(false); // Only lights from GetUpdates() are drawn.
+        return;
+    }
+
+    Slot& slot = it->second;
+    slot.renderedPositionAndRadius = slot.positionAndRadius;
+    slot.lastRenderedFrame = m_frame;
+    slot.hasDepth = true;
+    slot.castersChanged = false;
+}
+
+const ShadowAtlas::Slot* ShadowAtlas::FindUsableSlot(uint32_t light) const
+{
+    auto it = m_slots.find(light);
+    if ((it == m_slots.end()) || (it->second.lastUsedFrame != m_frame) || (!it->second.hasDepth && !it->second.updating))
+        return nullptr;
+
+    return &it->second;
+}
+
+uint32_t ShadowAtlas::GetTileSize(float screenCoverage)
+{
+    // A light as tall as the screen gets the largest tiles, and every halving of its size halves theirs.
+    uint32_t size = c_minTileSize;
+    while ((size < c_maxTileSize) && (static_cast<float>(size * 2) <= (screenCoverage * c_maxTileSize)))
+        size *= 2;
+    return size;
+}
+
+glm::mat4 ShadowAtlas::GetFaceViewProjection(const glm::vec4& positionAndRadius, uint32_t face)
+{
+    // Any orientation does, as long as drawing and sampling use the same one; these are the usual cube map ones.
+    static const glm::vec3 directions[c_faceCount] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+    static const glm::vec3 ups[c_faceCount] = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+    // A 90 degree square frustum, out to the light's radius.
+    glm::vec3 position(positionAndRadius);
+    float nearPlane = positionAndRadius.w * c_nearPlaneFraction;
+    glm::mat4 projection = glm::frustum(-nearPlane, nearPlane, -nearPlane, nearPlane, nearPlane, positionAndRadius.w);
+    return projection * glm::lookAt(position, position + directions[face], ups[face]);
+}
+
+glm::mat4 ShadowAtlas::GetTileTransform(const Tile& tile)
+{
+    // Scales and moves the face's [-1, 1] square onto the tile's part of the atlas. Affine in x and y, so it works before the divide.
+    float scale = static_cast<float>(tile.size) / c_size;
+    glm::vec2 centre = ((glm::vec2(static_cast<float>(tile.x), static_cast<float>(tile.y)) + (0.5f * tile.size)) / static_cast<float>(c_size));
+    glm::mat4 transform = glm::translate(glm::mat4(), glm::vec3((2.0f * centre) - 1.0f, 0.0f));
+    return glm::scale(transform, glm::vec3(scale, scale, 1.0f));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <map>
+#include <vector>
+
+// Packs point light shadow maps into one square depth atlas. A shadowed light gets a cube's worth of square tiles, one per face,
+// from a quadtree over the atlas: nodes are split into quarters down to c_minTileSize, and freeing a tile merges its siblings
+// back up, so lights of any size come and go without the atlas fragmenting for good.
+//
+// Each frame the visible lights are ranked by importance, and the first c_maxShadowedLights keep or get tiles, sized by how much
+// of the screen the light covers. Tiles outlive the frame: a light that hasn't moved, with casters that haven't changed, keeps its
+// depth and costs nothing. At most c_maxUpdatesPerFrame lights are redrawn per frame, the most changed and largest first. When the
+// atlas is full, lights that weren't requested this frame lose their tiles, least recently used and least important first; once
+// there are none left, new lights settle for smaller tiles.
+class ShadowAtlas
+{
+public:
+    static const uint32_t c_size = 4096;
+    static const uint32_t c_minTileSize = 64;
+    static const uint32_t c_maxTileSize = 512;
+    static const uint32_t c_faceCount = 6;          // +X, -X, +Y, -Y, +Z, -Z.
+    static const uint32_t c_maxShadowedLights = 32;
+    static const uint32_t c_maxUpdatesPerFrame = 4;
+
+    struct Tile
+    {
+        uint32_t x;     // Texels, from the atlas origin.
+        uint32_t y;
+        uint32_t size;
+    };
+
+    struct Request
+    {
+        uint32_t light;                 // LightStore index.
+        glm::vec4 positionAndRadius;    // World space.
+        float screenCoverage;           // Projected diameter over the screen height.
+        float importance;
+    };
+
+    struct Slot
+    {
+        Tile faces[c_faceCount];
+        uint32_t requestedSize;     // What the light's coverage calls for. The faces are smaller while the atlas has no room for it.
+        glm::vec4 positionAndRadius;            // Where the light is this frame.
+        glm::vec4 renderedPositionAndRadius;    // Where it was when the faces were drawn.
+        float importance;           // When last requested.
+        uint64_t lastUsedFrame;
+        uint64_t lastRenderedFrame;
+        bool hasDepth;          // The faces hold this light's depth, maybe out of date.
+        bool castersChanged;    // Since the faces were drawn.
+        bool updating;          // Scheduled to be drawn this frame.
+    };
+
+private:
+    enum NodeState : uint8_t
+    {
+        NODE_FREE,
+        NODE_SPLIT,
+        NODE_USED,
+    };
+
+    // Implicit quadtree: node 0 is the whole atlas, and node n's children are 4n + 1 to 4n + 4.
+    std::vector<NodeState> m_nodes;
+    std::map<uint32_t, Slot> m_slots;       // By light.
+    std::vector<uint32_t> m_updates;
+    uint64_t m_frame;
+
+    bool AllocateNode(uint32_t node, uint32_t nodeSize, uint32_t x, uint32_t y, uint32_t size, bool packOnly, Tile& tile);
+    bool AllocateTile(uint32_t size, Tile& tile);
+    void FreeTile(const Tile& tile);
+    bool AllocateFaces(uint32_t size, Tile* faces);
+    void FreeFaces(const Tile* faces, uint32_t faceCount);
+    bool EvictLeastRecentlyUsed();
+
+public:
+    ShadowAtlas();
+
+    // Assigns tiles for this frame's requests and picks the lights to draw. castersChanged says the shadow casters moved since
+    // last frame, which leaves every light's depth out of date.
+    void Schedule(std::vector<Request>& requests, bool castersChanged);
+    void InvalidateAll();   // The casters changed; keeps the tiles, redraws them in turn.
+    void Clear();           // The lights were replaced; frees everything.
+
+    // Lights to draw this frame, in priority order, and marking them drawn once they have been.
+    const std::vector<uint32_t>& GetUpdates() const { return m_updates; }
+    void MarkRendered(uint32_t light);
+
+    // The light's tiles if they can be sampled this frame: they hold its depth or are about to. nullptr otherwise.
+    const Slot* FindUsableSlot(uint32_t light) const;
+
+    static uint32_t GetTileSize(float screenCoverage);
+    static glm::mat4 GetFaceViewProjection(const glm::vec4& positionAndRadius, uint32_t face);     // World space -> face clip space.
+    static glm::mat4 GetTileTransform(const Tile& tile);    // Face clip space -> atlas clip space.
+};
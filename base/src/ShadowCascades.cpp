@@ -0,0 +1,139 @@
+#include "ShadowCascades.h"
+
+#include <cfloat>
+#include <cmath>
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace
+{
+    // Blend between uniform (0) and logarithmic (1) split distances. Logarithmic alone leaves the far cascades too long.
+    const float c_splitLambda = 0.75f;
+
+    // Cached cascades cover this much more than their slice, so the camera can move a little before one has to be refitted.
+    const float c_cachedCascadeMargin = 1.25f;
+
+    // Radii are rounded up to this step, so float noise in the fit can't change the texel size between frames.
+    const float c_radiusStep = 1.0f / 16.0f;
+}
+
+ShadowCascades::ShadowCascades()
+    : m_lightDirection(0.0f, 1.0f, 0.0f),
+    m_sceneBoundsMin(0.0f),
+    m_sceneBoundsMax(-1.0f),
+    m_nextRefit(0)
+{
+    for (Cascade& cascade : m_cascades)
+    {
+        cascade.lightSpaceCentre = glm::vec3(0.0f);
+        cascade.radius = 0.0f;
+        cascade.splitFar = 0.0f;
+    }
+    InvalidateStaticDepth();
+}
+
+glm::mat4 ShadowCascades::GetLightView() const
+{
+    glm::vec3 up = (std::abs(m_lightDirection.y) > 0.99f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), -m_lightDirection, up);
+}
+
+void ShadowCascades::SetLightDirection(const glm::vec3& lightDirection)
+{
+    glm::vec3 direction = glm::normalize(lightDirection);
+    if (direction == m_lightDirection)
+        return;
+
+    m_lightDirection = direction;
+    InvalidateStaticDepth();
+}
+
+void ShadowCascades::SetSceneBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    if ((boundsMin == m_sceneBoundsMin) && (boundsMax == m_sceneBoundsMax))
+        return;
+
+    m_sceneBoundsMin = boundsMin;
+    m_sceneBoundsMax = boundsMax;
+    InvalidateStaticDepth();
+}
+
+void ShadowCascades::InvalidateStaticDepth()
+{
+    for (Cascade& cascade : m_cascades)
+    {
+        cascade.fitted = false;
+        cascade.staticDepthStale = true;
+    }
+}
+
+void ShadowCascades::Update(const glm::mat4& inverseView, const glm::mat4& perspective, float nearPlane, float shadowDistance)
+{
+    glm::mat4 lightView = GetLightView();
+    glm::mat4 viewToLight = lightView * inverseView;
+    const float tanHalfFovX = 1.0f / perspective[0][0], tanHalfFovY = 1.0f / perspective[1][1];
+
+    // Casters have to fall between the near and far planes, so the depth range spans the whole scene, not just the slice.
+    bool hasSceneBounds = glm::all(glm::lessThanEqual(m_sceneBoundsMin, m_sceneBoundsMax));
+    float sceneMinZ = 0.0f, sceneMaxZ = 0.0f;
+    if (hasSceneBounds)
+    {
+        sceneMinZ = FLT_MAX;
+        sceneMaxZ = -FLT_MAX;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            glm::vec4 corner(((i & 1) != 0) ? m_sceneBoundsMax.x : m_sceneBoundsMin.x, ((i & 2) != 0) ? m_sceneBoundsMax.y : m_sceneBoundsMin.y,
+                ((i & 4) != 0) ? m_sceneBoundsMax.z : m_sceneBoundsMin.z, 1.0f);
+            float z = (lightView * corner).z;
+            sceneMinZ = glm::min(sceneMinZ, z);
+            sceneMaxZ = glm::max(sceneMaxZ, z);
+        }
+    }
+
+    uint32_t refitCascade = c_firstCachedCascade + m_nextRefit;
+    m_nextRefit = (m_nextRefit + 1) % c_cachedCascadeCount;
+
+    float splitNear = nearPlane;
+    for (uint32_t cascade = 0; cascade < c_cascadeCount; ++cascade)
+    {
+        Cascade& thisCascade = m_cascades[cascade];
+        float t = static_cast<float>(cascade + 1) / c_cascadeCount;
+        float splitFar = glm::mix(nearPlane + ((shadowDistance - nearPlane) * t), nearPlane * powf(shadowDistance / nearPlane, t), c_splitLambda);
+        thisCascade.splitFar = splitFar;
+
+        // The slice's corners are symmetric about the view axis, so its centroid is on it. The distance to the corners doesn't
+        // depend on where the camera looks, which is what keeps the texel size fixed.
+        glm::vec3 viewCentre(0.0f, 0.0f, -0.5f * (splitNear + splitFar));
+        float nearCornerDistance = glm::length(glm::vec3(splitNear * tanHalfFovX, splitNear * tanHalfFovY, -splitNear) - viewCentre);
+        float farCornerDistance = glm::length(glm::vec3(splitFar * tanHalfFovX, splitFar * tanHalfFovY, -splitFar) - viewCentre);
+        float sliceRadius = glm::max(nearCornerDistance, farCornerDistance);
+        glm::vec3 lightSpaceCentre = glm::vec3(viewToLight * glm::vec4(viewCentre, 1.0f));
+        splitNear = splitFar;
+
+        if (IsCached(cascade) && thisCascade.fitted && (cascade != refitCascade))
+        {
+            // Still inside the margin: keep the cached depth.
+            float drift = glm::length(glm::vec2(lightSpaceCentre) - glm::vec2(thisCascade.lightSpaceCentre));
+            if ((drift + sliceRadius) <= thisCascade.radius)
+                continue;
+        }
+
+        float radius = sliceRadius * (IsCached(cascade) ? c_cachedCascadeMargin : 1.0f);
+        radius = std::ceil(radius / c_radiusStep) * c_radiusStep;
+        float texelSize = (2.0f * radius) / c_resolution;
+        lightSpaceCentre.x = std::floor(lightSpaceCentre.x / texelSize) * texelSize;
+        lightSpaceCentre.y = std::floor(lightSpaceCentre.y / texelSize) * texelSize;
+
+        float minZ = hasSceneBounds ? sceneMinZ : (lightSpaceCentre.z - radius);
+        float maxZ = hasSceneBounds ? sceneMaxZ : (lightSpaceCentre.z + radius);
+        glm::mat4 projection = glm::ortho(lightSpaceCentre.x - radius, lightSpaceCentre.x + radius, lightSpaceCentre.y - radius, lightSpaceCentre.y + radius, -maxZ, -minZ);
+        glm::mat4 viewProjection = projection * lightView;
+
+        if (!thisCascade.fitted || (viewProjection != thisCascade.viewProjection))
+            thisCascade.staticDepthStale = true;
+
+        thisCascade.viewProjection = viewProjection;
+        thisCascade.lightSpaceCentre = lightSpaceCentre;
+        thisCascade.radius = radius;
+        thisCascade.fitted = true;
+    }
+}
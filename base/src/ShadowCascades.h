@@ -0,0 +1,54 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+// Fits cascaded shadow maps for the directional light. The view frustum, up to the shadow distance, is cut into c_cascadeCount
+// slices, and each cascade is an orthographic projection around the bounding sphere of its slice. The sphere's radius doesn't
+// change as the camera turns, and its centre is snapped to whole shadow map texels, so a static scene's shadows don't shimmer.
+//
+// Cascade 0 follows the camera every frame. The others are cached: their static geometry's depth is kept from the last time they
+// were fitted, and only dynamic casters are drawn over it each frame. They're fitted with some margin, and refitted one per frame
+// in turn, or straight away once the camera has moved out of the margin. A refit that lands on the same texel-snapped position
+// keeps the cached depth, so a camera that stands still costs nothing but the near cascade and the dynamic casters.
+class ShadowCascades
+{
+public:
+    static const uint32_t c_cascadeCount = 4;
+    static const uint32_t c_firstCachedCascade = 1;
+    static const uint32_t c_cachedCascadeCount = c_cascadeCount - c_firstCachedCascade;
+    static const uint32_t c_resolution = 1024;      // Of each cascade's square shadow map.
+
+    struct Cascade
+    {
+        glm::mat4 viewProjection;   // World space -> light clip space.
+        glm::vec3 lightSpaceCentre;
+        float radius;               // World units covered either side of the centre.
+        float splitFar;             // View distance this cascade ends at.
+        bool fitted;
+        bool staticDepthStale;      // The matrix changed since static geometry was last drawn with it.
+    };
+
+private:
+    Cascade m_cascades[c_cascadeCount];
+    glm::vec3 m_lightDirection;     // World space, towards the light.
+    glm::vec3 m_sceneBoundsMin;
+    glm::vec3 m_sceneBoundsMax;
+    uint32_t m_nextRefit;           // Which cached cascade gets refitted next, counted from c_firstCachedCascade.
+
+    glm::mat4 GetLightView() const;
+
+public:
+    ShadowCascades();
+
+    // Either of these changing moves every cascade, so all cached depth is thrown away.
+    void SetLightDirection(const glm::vec3& lightDirection);
+    void SetSceneBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax);    // Every caster has to be inside.
+    void InvalidateStaticDepth();   // The static geometry changed.
+
+    // perspective has to be a symmetric perspective projection, like the ones Camera builds.
+    void Update(const glm::mat4& inverseView, const glm::mat4& perspective, float nearPlane, float shadowDistance);
+    void MarkStaticDepthRendered(uint32_t cascade) { m_cascades[cascade].staticDepthStale = false; }
+
+    const Cascade& GetCascade(uint32_t cascade) const { return m_cascades[cascade]; }
+    static bool IsCached(uint32_t cascade) { return cascade >= c_firstCachedCascade; }
+};
@@ -0,0 +1,278 @@
+#include "SpirvReflection.h"
+#include "GLProgram.h"
+#include "gl/glew.h"
+
+namespace
+{
+    const uint32_t c_spirvMagic = 0x07230203;
+    const uint32_t c_headerWords = 5;
+
+    // Opcodes, decorations and storage classes from the SPIR-V specification. Just the ones we look at.
+    enum Op
+    {
+        OpName = 5,
+        OpMemberName = 6,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampledImage = 27,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpSpecConstantTrue = 48,
+        OpSpecConstantFalse = 49,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72
+    };
+
+    enum Decoration
+    {
+        DecorationSpecId = 1,
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationNonWritable = 24,
+        DecorationNonReadable = 25,
+        DecorationBinding = 33,
+        DecorationOffset = 35
+    };
+
+    enum StorageClass
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassUniform = 2,
+        StorageClassStorageBuffer = 12
+    };
+
+    struct TypeInfo
+    {
+        uint32_t opcode;
+        uint32_t componentType;     // Vectors and matrices: component/column type. Pointers: pointee.
+        uint32_t count;             // Vectors: components. Matrices: columns. Ints: signedness.
+        std::vector<uint32_t> members;
+    };
+
+    std::string ReadLiteralString(const uint32_t* words, uint32_t numWords)
+    {
+        const char* characters = reinterpret_cast<const char*>(words);
+        std::string literal;
+        for (uint32_t i = 0; (i < numWords * 4) && characters[i]; ++i)
+            literal.push_back(characters[i]);
+        return literal;
+    }
+
+    bool GetConstantType(const std::map<uint32_t, TypeInfo>& types, uint32_t typeId, ShaderConstantManager::SupportedTypes& type)
+    {
+        const auto& typeItr = types.find(typeId);
+        if (typeItr == types.end())
+            return false;
+
+        const TypeInfo& typeInfo = typeItr->second;
+        switch (typeInfo.opcode)
+        {
+        case OpTypeFloat:
+            type = ShaderConstantManager::FLOAT;
+            return true;
+        case OpTypeInt:
+            // glslang lowers bool block members to uint, and bools are the only unsigned constants we have.
+            type = typeInfo.count ? ShaderConstantManager::INT : ShaderConstantManager::BOOL;
+            return true;
+        case OpTypeVector:
+            type = (typeInfo.count == 3) ? ShaderConstantManager::VEC3 : ShaderConstantManager::VEC4;
+            return (typeInfo.count == 3) || (typeInfo.count == 4);
+        case OpTypeMatrix:
+            type = ShaderConstantManager::MAT4;
+            return typeInfo.count == 4;
+        default:
+            return false;
+        }
+    }
+}
+
+namespace SpirvReflection
+{
+    bool IsModule(const std::string& module)
+    {
+        return (module.size() >= c_headerWords * 4) && ((module.size() % 4) == 0) && (*reinterpret_cast<const uint32_t*>(module.data()) == c_spirvMagic);
+    }
+
+    bool Reflect(const std::string& module, ProgramReflection& reflection, std::map<std::string, uint32_t>& specializationConstants)
+    {
+        if (!IsModule(module))
+            return false;
+
+        std::map<uint32_t, std::string> names;
+        std::map<std::pair<uint32_t, uint32_t>, std::string> memberNames;
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> decorations;             // Key: (id, decoration). Value: first operand.
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> memberOffsets;           // Key: (struct id, member).
+        std::map<uint32_t, TypeInfo> types;
+        std::vector<std::pair<uint32_t, uint32_t>> variables;                      // First -> id; second -> pointer type.
+        std::vector<uint32_t> specConstants;
+
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(module.data());
+        const uint32_t numWords = static_cast<uint32_t>(module.size() / 4);
+        for (uint32_t position = c_headerWords; position < numWords;)
+        {
+            const uint32_t opcode = words[position] & 0xFFFF;
+            const uint32_t wordCount = words[position] >> 16;
+            if ((wordCount == 0) || (position + wordCount > numWords))
+                return false;
+
+            const uint32_t* operands = words + position + 1;
+            const uint32_t numOperands = wordCount - 1;
+            switch (opcode)
+            {
+            case OpName:
+                names[operands[0]] = ReadLiteralString(operands + 1, numOperands - 1);
+                break;
+            case OpMemberName:
+                memberNames[std::make_pair(operands[0], operands[1])] = ReadLiteralString(operands + 2, numOperands - 2);
+                break;
+            case OpDecorate:
+                decorations[std::make_pair(operands[0], operands[1])] = (numOperands > 2) ? operands[2] : 0;
+                break;
+            case OpMemberDecorate:
+                if (operands[2] == DecorationOffset)
+                    memberOffsets[std::make_pair(operands[0], operands[1])] = operands[3];
+                break;
+            case OpTypeBool:
+            case OpTypeFloat:
+            case OpTypeImage:
+            case OpTypeSampledImage:
+                types[operands[0]].opcode = opcode;
+                break;
+            case OpTypeInt:
+                types[operands[0]].opcode = opcode;
+                types[operands[0]].count = operands[2];
+                break;
+            case OpTypeVector:
+            case OpTypeMatrix:
+                types[operands[0]].opcode = opcode;
+                types[operands[0]].componentType = operands[1];
+                types[operands[0]].count = operands[2];
+                break;
+            case OpTypeStruct:
+                types[operands[0]].opcode = opcode;
+                types[operands[0]].members.assign(operands + 1, operands + numOperands);
+                break;
+            case OpTypePointer:
+                types[operands[0]].opcode = opcode;
+                types[operands[0]].count = operands[1];     // Storage class.
+                types[operands[0]].componentType = operands[2];
+                break;
+            case OpSpecConstantTrue:
+            case OpSpecConstantFalse:
+                specConstants.push_back(operands[1]);
+                break;
+            case OpVariable:
+                variables.push_back(std::make_pair(operands[1], operands[0]));
+                break;
+            default:
+                break;
+            }
+
+            position += wordCount;
+        }
+
+        for (uint32_t specConstant : specConstants)
+        {
+            const auto& specIdItr = decorations.find(std::make_pair(specConstant, static_cast<uint32_t>(DecorationSpecId)));
+            if ((specIdItr != decorations.end()) && (names.count(specConstant) != 0))
+                specializationConstants[names[specConstant]] = specIdItr->second;
+        }
+
+        for (const auto& variable : variables)
+        {
+            const TypeInfo& pointerType = types[variable.second];
+            if (pointerType.opcode != OpTypePointer)
+                continue;
+
+            const uint32_t pointeeId = pointerType.componentType;
+            const TypeInfo& pointee = types[pointeeId];
+            const auto& bindingItr = decorations.find(std::make_pair(variable.first, static_cast<uint32_t>(DecorationBinding)));
+            if (bindingItr == decorations.end())
+                continue;   // Without a binding there's nothing we can bind to.
+
+            const bool isStorageBlock = (pointee.opcode == OpTypeStruct) &&
+                (((pointerType.count == StorageClassUniform) && (decorations.count(std::make_pair(pointeeId, static_cast<uint32_t>(DecorationBufferBlock))) != 0)) ||
+                ((pointerType.count == StorageClassStorageBuffer) && (decorations.count(std::make_pair(pointeeId, static_cast<uint32_t>(DecorationBlock))) != 0)));
+
+            if (isStorageBlock)
+            {
+                const std::string& storageBufferName = names[pointeeId];
+                bool alreadyReflected = false;
+                for (const auto& itr : reflection.storageBuffers)
+                    alreadyReflected |= (itr.first == storageBufferName);
+
+                if (!alreadyReflected)
+                    reflection.storageBuffers.push_back(std::make_pair(storageBufferName, static_cast<GLType_int>(bindingItr->second)));
+            }
+            else if ((pointerType.count == StorageClassUniformConstant) && (pointee.opcode == OpTypeImage))
+            {
+                ProgramReflection::ImageBinding image;
+                image.name = names[variable.first];
+                image.unit = static_cast<GLType_int>(bindingItr->second);
+                image.access = GL_READ_WRITE;
+                if (decorations.count(std::make_pair(variable.first, static_cast<uint32_t>(DecorationNonWritable))) != 0)
+                    image.access = GL_READ_ONLY;
+                else if (decorations.count(std::make_pair(variable.first, static_cast<uint32_t>(DecorationNonReadable))) != 0)
+                    image.access = GL_WRITE_ONLY;
+
+                bool alreadyReflected = false;
+                for (const auto& itr : reflection.images)
+                    alreadyReflected |= (itr.name == image.name);
+
+                if (!alreadyReflected)
+                    reflection.images.push_back(image);
+            }
+            else if ((pointerType.count == StorageClassUniformConstant) && (pointee.opcode == OpTypeSampledImage))
+            {
+                const std::string& textureName = names[variable.first];
+                bool alreadyReflected = false;
+                for (const auto& itr : reflection.textures)
+                    alreadyReflected |= (itr.first == textureName);
+
+                if (!alreadyReflected)
+                    reflection.textures.push_back(std::make_pair(textureName, static_cast<GLType_int>(bindingItr->second)));
+            }
+            else if ((pointerType.count == StorageClassUniform) && (pointee.opcode == OpTypeStruct) && (decorations.count(std::make_pair(pointeeId, static_cast<uint32_t>(DecorationBlock))) != 0))
+            {
+                ProgramReflection::ConstantBufferBinding binding;
+                binding.name = names[pointeeId];    // The block name; the variable carries the (usually empty) instance name.
+                binding.bindPoint = static_cast<int32_t>(bindingItr->second);
+
+                bool alreadyReflected = false;
+                for (const auto& itr : reflection.constantBuffers)
+                    alreadyReflected |= (itr.name == binding.name);
+                if (alreadyReflected)
+                    continue;
+
+                uint32_t blockEnd = 0;
+                for (uint32_t member = 0; member < pointee.members.size(); ++member)
+                {
+                    ShaderConstantSignature signature;
+                    signature.name = memberNames[std::make_pair(pointeeId, member)];
+                    signature.size = 1; // Array uniforms are not supported.
+                    signature.offset = memberOffsets[std::make_pair(pointeeId, member)];
+                    if (!GetConstantType(types, pointee.members[member], signature.type))
+                        return false;
+
+                    binding.signature.push_back(signature);
+                    binding.constantNames.push_back(signature.name);
+
+                    uint32_t memberEnd = signature.offset + ShaderConstantManager::GetSizeForType(signature.type);
+                    if (memberEnd > blockEnd)
+                        blockEnd = memberEnd;
+                }
+
+                binding.size = static_cast<int32_t>((blockEnd + 15) & ~15u);    // std140 rounds blocks up to a vec4.
+                reflection.constantBuffers.push_back(binding);
+            }
+        }
+
+        reflection.fixedTextureUnits = true;
+        return true;
+    }
+}
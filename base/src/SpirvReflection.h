@@ -0,0 +1,20 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+struct ProgramReflection;
+
+// Reads what GLProgram needs straight out of a SPIR-V module: uniform blocks with their member layout, samplers, images and
+// storage blocks with their bindings, and the names and ids of the specialization constants. No GL involved, so it can run on the preprocessing thread.
+// Only what the shaders in res/shaders use is understood.
+namespace SpirvReflection
+{
+    bool IsModule(const std::string& module);
+
+    // Appends to reflection; blocks and samplers already in there (from another stage) are skipped. False if the module is malformed.
+    bool Reflect(const std::string& module, ProgramReflection& reflection, std::map<std::string, uint32_t>& specializationConstants);
+}
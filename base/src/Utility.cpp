@@ -95,61 +95,160 @@ namespace Utility
 		}
 	}
 
-    shaders_t createShaders(const std::string& vs_source, const std::string& fs_source)
+    shaders_t submitShaders(const std::string& vs_source, const std::string& fs_source)
     {
-		GLuint f, v;
+        shaders_t out;
+        out.vertex = glCreateShader(GL_VERTEX_SHADER);
+        out.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        out.compute = 0;
 
-		v = glCreateShader(GL_VERTEX_SHADER);
-		f = glCreateShader(GL_FRAGMENT_SHADER);	
-
-		// load shaders & get length of each
-		GLint vlen = vs_source.length();
+        GLint vlen = vs_source.length();
         GLint flen = fs_source.length();
         const char* vs = vs_source.c_str();
         const char* fs = fs_source.c_str();
 
-		glShaderSource(v, 1, &vs, &vlen);
-		glShaderSource(f, 1, &fs, &flen);
+        glShaderSource(out.vertex, 1, &vs, &vlen);
+        glShaderSource(out.fragment, 1, &fs, &flen);
 
-		GLint compiled;
+        // No status queries here: with KHR_parallel_shader_compile the driver compiles in the background until somebody asks.
+        glCompileShader(out.vertex);
+        glCompileShader(out.fragment);
 
-		glCompileShader(v);
-		glGetShaderiv(v, GL_COMPILE_STATUS, &compiled);
-		if (!compiled)
-		{
-            LogMessage("Vertex shader not compiled.\n");
-			printShaderInfoLog(v);
-            assert(false);
-		} 
-
-		glCompileShader(f);
-		glGetShaderiv(f, GL_COMPILE_STATUS, &compiled);
-		if (!compiled)
-		{
-            LogMessage("Fragment shader not compiled.\n"); 
-            printShaderInfoLog(f);
-            assert(false);
-		} 
-		shaders_t out; out.vertex = v; out.fragment = f;
+        return out;
+    }
 
-		return out;
-	}
+    bool checkShaders(shaders_t shaders)
+    {
+        GLint compiled;
+        bool allCompiled = true;
+
+        if (shaders.vertex)
+        {
+            glGetShaderiv(shaders.vertex, GL_COMPILE_STATUS, &compiled);
+            if (!compiled)
+            {
+                LogMessage("Vertex shader not compiled.\n");
+                printShaderInfoLog(shaders.vertex);
+                allCompiled = false;
+            }
+        }
+
+        if (shaders.fragment)
+        {
+            glGetShaderiv(shaders.fragment, GL_COMPILE_STATUS, &compiled);
+            if (!compiled)
+            {
+                LogMessage("Fragment shader not compiled.\n");
+                printShaderInfoLog(shaders.fragment);
+                allCompiled = false;
+            }
+        }
+
+        if (shaders.compute)
+        {
+            glGetShaderiv(shaders.compute, GL_COMPILE_STATUS, &compiled);
+            if (!compiled)
+            {
+                LogMessage("Compute shader not compiled.\n");
+                printShaderInfoLog(shaders.compute);
+                allCompiled = false;
+            }
+        }
 
-    void attachAndLinkProgram(GLType_uint program, shaders_t shaders)
+        return allCompiled;
+    }
+
+    void loadSpirvShader(GLuint shader, const std::string& module, const std::vector<GLType_uint>& constantIndices, const std::vector<GLType_uint>& constantValues)
     {
-		glAttachShader(program, shaders.vertex);
-		glAttachShader(program, shaders.fragment);
+        glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, module.data(), static_cast<GLsizei>(module.size()));
+
+        // Specializing is what compiles a SPIR-V shader; afterwards GL_COMPILE_STATUS says whether it worked, same as GLSL.
+        GLuint numConstants = static_cast<GLuint>(constantIndices.size());
+        const GLuint* indices = numConstants ? &constantIndices[0] : nullptr;
+        const GLuint* values = numConstants ? &constantValues[0] : nullptr;
+        if (GLEW_VERSION_4_6)
+            glSpecializeShader(shader, "main", numConstants, indices, values);
+        else
+            glSpecializeShaderARB(shader, "main", numConstants, indices, values);
+    }
 
-		glLinkProgram(program);
-		GLint linked;
-		glGetProgramiv(program,GL_LINK_STATUS, &linked);
-		if (!linked) 
-		{
+    shaders_t submitSpirvShaders(const std::string& vs_module, const std::string& fs_module, const std::vector<GLType_uint>& constantIndices, const std::vector<GLType_uint>& constantValues)
+    {
+        shaders_t out;
+        out.vertex = glCreateShader(GL_VERTEX_SHADER);
+        out.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        out.compute = 0;
+
+        loadSpirvShader(out.vertex, vs_module, constantIndices, constantValues);
+        loadSpirvShader(out.fragment, fs_module, constantIndices, constantValues);
+
+        return out;
+    }
+
+    shaders_t submitComputeShader(const std::string& cs_source)
+    {
+        shaders_t out;
+        out.vertex = 0;
+        out.fragment = 0;
+        out.compute = glCreateShader(GL_COMPUTE_SHADER);
+
+        GLint clen = cs_source.length();
+        const char* cs = cs_source.c_str();
+        glShaderSource(out.compute, 1, &cs, &clen);
+        glCompileShader(out.compute);
+
+        return out;
+    }
+
+    shaders_t submitSpirvComputeShader(const std::string& cs_module, const std::vector<GLType_uint>& constantIndices, const std::vector<GLType_uint>& constantValues)
+    {
+        shaders_t out;
+        out.vertex = 0;
+        out.fragment = 0;
+        out.compute = glCreateShader(GL_COMPUTE_SHADER);
+
+        loadSpirvShader(out.compute, cs_module, constantIndices, constantValues);
+
+        return out;
+    }
+
+    void submitLink(GLType_uint program, shaders_t shaders)
+    {
+        GLuint stages[] = { shaders.vertex, shaders.fragment, shaders.compute };
+        for (GLuint shader : stages)
+        {
+            if (shader)
+                glAttachShader(program, shader);
+        }
+        glLinkProgram(program);
+    }
+
+    void deleteShaders(GLType_uint program, shaders_t shaders)
+    {
+        GLuint stages[] = { shaders.vertex, shaders.fragment, shaders.compute };
+        for (GLuint shader : stages)
+        {
+            if (shader)
+            {
+                glDetachShader(program, shader);
+                glDeleteShader(shader);
+            }
+        }
+    }
+
+    bool checkLink(GLType_uint program)
+    {
+        GLint linked;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
             LogMessage("Program did not link.\n");
-			printLinkInfoLog(program);
-            assert(false);
-		}
-	}
+            printLinkInfoLog(program);
+            return false;
+        }
+
+        return true;
+    }
 
     void LogHelper(const char* inMessage, const char* filename = nullptr, bool endLine = false)
     {
@@ -223,4 +322,17 @@ namespace Utility
 
         return hash;
     }
+
+    uint64_t HashBytes64(const void* data, size_t size, uint64_t hash)
+    {
+        // 64 bit FNV-1a.
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
 }
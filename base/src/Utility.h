@@ -4,6 +4,7 @@
 #include "Common.h"
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 namespace Utility 
 {
@@ -11,11 +12,18 @@ namespace Utility
     {
 		GLType_uint vertex;
         GLType_uint fragment;
+        GLType_uint compute;    // Compute programs have only this one; render programs leave it 0.
 	} shaders_t;
 
-    shaders_t createShaders(const std::string& vs_source, const std::string& fs_source);
-
-    void attachAndLinkProgram(GLType_uint program, shaders_t shaders);
+    // Non-blocking compilation and linking. Submit first, then check once the driver reports completion; checking earlier stalls.
+    shaders_t submitShaders(const std::string& vs_source, const std::string& fs_source);
+    bool checkShaders(shaders_t shaders);
+    shaders_t submitSpirvShaders(const std::string& vs_module, const std::string& fs_module, const std::vector<GLType_uint>& constantIndices, const std::vector<GLType_uint>& constantValues);
+    shaders_t submitComputeShader(const std::string& cs_source);
+    shaders_t submitSpirvComputeShader(const std::string& cs_module, const std::vector<GLType_uint>& constantIndices, const std::vector<GLType_uint>& constantValues);
+    void submitLink(GLType_uint program, shaders_t shaders);
+    bool checkLink(GLType_uint program);
+    void deleteShaders(GLType_uint program, shaders_t shaders);    // Detaches and deletes every stage that was created.
 
     char* loadFile(const char *fname, GLType_int &fSize);
 
@@ -35,6 +43,7 @@ namespace Utility
     void LogMessageAndEndLine(const char* logMessage);
 
     uint32_t HashCString(const char* cString);
+    uint64_t HashBytes64(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);   // Pass the previous result as hash to chain calls.
 }
  
 #endif